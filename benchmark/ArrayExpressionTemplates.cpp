@@ -2,13 +2,21 @@
 
 #include "clad/Differentiator/Differentiator.h"
 
+#if defined(__SSE2__) || defined(__AVX__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
 // Benchmark the expression x*y + y*z + z*x between clad arrays,
 // this is to compare the performance of expression templates.
-// We will evaluate the expression on using four different methods:
-// 1. Using operations on clad arrays - this will use expression templates.
+// We will evaluate the expression on using five different methods:
+// 1. Using operations on clad arrays - this will use expression templates,
+//    which are evaluated with the vector registers of the target, see
+//    ArraySimd.h.
 // 2. Using clad arrays but creating temporaries manually.
 // 3. Using loops on clad arrays.
 // 4. Using loops on native arrays.
+// 5. Using hand-written intrinsics on native arrays, which the expression
+//    templates should match.
 
 // Benchmark expression templates.
 static void BM_ExpressionTemplates(benchmark::State& state) {
@@ -100,5 +108,65 @@ static void BM_LoopsOnNativeArrays(benchmark::State& state) {
 }
 BENCHMARK(BM_LoopsOnNativeArrays);
 
+// Benchmark hand-written intrinsics on native arrays, of the widest vector
+// registers the benchmark is built for.
+static void BM_HandWrittenIntrinsics(benchmark::State& state) {
+  constexpr int n = 1000;
+  double* x = new double[n];
+  double* y = new double[n];
+  double* z = new double[n];
+  for (int i = 0; i < n; ++i) {
+    x[i] = i + 1;
+    y[i] = i + 2;
+    z[i] = i + 3;
+  }
+
+  double* res = new double[n];
+  for (auto _ : state) {
+    int i = 0;
+#if defined(__AVX512F__)
+    for (; i + 8 <= n; i += 8) {
+      __m512d vx = _mm512_loadu_pd(x + i);
+      __m512d vy = _mm512_loadu_pd(y + i);
+      __m512d vz = _mm512_loadu_pd(z + i);
+      __m512d xy = _mm512_mul_pd(vx, vy);
+      __m512d yz = _mm512_mul_pd(vy, vz);
+      __m512d zx = _mm512_mul_pd(vz, vx);
+      _mm512_storeu_pd(res + i, _mm512_add_pd(_mm512_add_pd(xy, yz), zx));
+    }
+#elif defined(__AVX__)
+    for (; i + 4 <= n; i += 4) {
+      __m256d vx = _mm256_loadu_pd(x + i);
+      __m256d vy = _mm256_loadu_pd(y + i);
+      __m256d vz = _mm256_loadu_pd(z + i);
+      __m256d xy = _mm256_mul_pd(vx, vy);
+      __m256d yz = _mm256_mul_pd(vy, vz);
+      __m256d zx = _mm256_mul_pd(vz, vx);
+      _mm256_storeu_pd(res + i, _mm256_add_pd(_mm256_add_pd(xy, yz), zx));
+    }
+#elif defined(__SSE2__)
+    for (; i + 2 <= n; i += 2) {
+      __m128d vx = _mm_loadu_pd(x + i);
+      __m128d vy = _mm_loadu_pd(y + i);
+      __m128d vz = _mm_loadu_pd(z + i);
+      __m128d xy = _mm_mul_pd(vx, vy);
+      __m128d yz = _mm_mul_pd(vy, vz);
+      __m128d zx = _mm_mul_pd(vz, vx);
+      _mm_storeu_pd(res + i, _mm_add_pd(_mm_add_pd(xy, yz), zx));
+    }
+#endif
+    for (; i < n; ++i)
+      res[i] = x[i] * y[i] + y[i] * z[i] + z[i] * x[i];
+    benchmark::DoNotOptimize(res);
+    benchmark::ClobberMemory();
+  }
+
+  delete[] x;
+  delete[] y;
+  delete[] z;
+  delete[] res;
+}
+BENCHMARK(BM_HandWrittenIntrinsics);
+
 // Define our main.
 BENCHMARK_MAIN();
\ No newline at end of file
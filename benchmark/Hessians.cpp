@@ -1,9 +1,12 @@
 #include "benchmark/benchmark.h"
 
 #include "clad/Differentiator/Differentiator.h"
+#include "clad/Differentiator/Parallel.h"
 
 #include "BenchmarkedFunctions.h"
 
+#include <vector>
+
 // Benchmark Hessian diagonal sum computation, by computing the
 // entire computation.
 static void BM_HessianCompleteComputation(benchmark::State& state) {
@@ -43,5 +46,67 @@ static void BM_HessianDiagonalComputation(benchmark::State& state) {
 }
 BENCHMARK(BM_HessianDiagonalComputation);
 
+// Benchmark Hessian-vector product computation, by computing the entire
+// Hessian and multiplying it with the vector.
+static void BM_HessianVectorProductFromHessian(benchmark::State& state) {
+  auto dfdx2 = clad::hessian(weightedSum, "p[0:1],w[0:1]");
+  double p[] = {1, 2};
+  double w[] = {3, 4};
+  double v[] = {1, 2, 3, 4};
+  double hessianMatrix[16] = {};
+  double hvp[4] = {};
+  for (auto _ : state) {
+    for (unsigned i = 0; i < 16; i++)
+      hessianMatrix[i] = 0.0;
+    dfdx2.execute(p, w, 2, hessianMatrix);
+    for (int i = 0; i < 4; i++) {
+      hvp[i] = 0;
+      for (int j = 0; j < 4; j++)
+        hvp[i] += hessianMatrix[i * 4 + j] * v[j];
+    }
+    benchmark::DoNotOptimize(hvp);
+  }
+}
+BENCHMARK(BM_HessianVectorProductFromHessian);
+
+// Benchmark Hessian-vector product computation without forming the Hessian.
+static void BM_HessianVectorProduct(benchmark::State& state) {
+  auto dfdx2 = clad::hessian_vector_product(weightedSum, "p[0:1],w[0:1]");
+  double p[] = {1, 2};
+  double w[] = {3, 4};
+  double v[] = {1, 2, 3, 4};
+  double hvp[4] = {};
+  for (auto _ : state) {
+    for (unsigned i = 0; i < 4; i++)
+      hvp[i] = 0.0;
+    dfdx2.execute(p, w, 2, v, v + 2, 0, hvp);
+    benchmark::DoNotOptimize(hvp);
+  }
+}
+BENCHMARK(BM_HessianVectorProduct);
+
+// Benchmark the scaling of parallel Hessian computation with the number of
+// threads. Each of the 16 columns sweeps over all the n elements.
+static void BM_HessianParallelComputation(benchmark::State& state) {
+  auto dfdx2 =
+      clad::hessian<clad::opts::parallel>(weightedSum, "p[0:7],w[0:7]");
+  clad::set_num_threads(state.range(0));
+  const int n = 1 << 14;
+  std::vector<double> p(n, 1);
+  std::vector<double> w(n, 2);
+  double hessianMatrix[256] = {};
+  for (auto _ : state) {
+    for (unsigned i = 0; i < 256; i++)
+      hessianMatrix[i] = 0.0;
+    dfdx2.execute(p.data(), w.data(), n, hessianMatrix);
+    benchmark::DoNotOptimize(hessianMatrix);
+  }
+  clad::set_num_threads(0);
+}
+BENCHMARK(BM_HessianParallelComputation)
+    ->RangeMultiplier(2)
+    ->Range(1, 8)
+    ->UseRealTime();
+
 // Define our main.
 BENCHMARK_MAIN();
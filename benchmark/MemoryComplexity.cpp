@@ -131,6 +131,24 @@ BENCHMARK_TEMPLATE(BM_Multilayer_Storage, 64, 1024)
     ->Range(0, 4096)
     ->Name("BM_Multilayer_Storage/SBO_64_SLAB_1024_DISK");
 
+// Creates the short-lived arrays of the vector forward mode: the seeds, the
+// derivative of an expression and the one returned with a pushforward. Arrays
+// of up to CLAD_ARRAY_SBO_BYTES bytes do not allocate and the returned ones
+// are moved rather than copied.
+static void BM_ArrayMemory(benchmark::State& state) {
+  std::size_t n = state.range(0);
+  AddBMCounterRAII MemCounters(*mm, state);
+  for (auto _ : state) {
+    clad::array<double> _d_vector_x = clad::one_hot_vector<double>(n, 0);
+    clad::array<double> _d_vector_y = clad::one_hot_vector<double>(n, n - 1);
+    clad::array<double> _d_vector_z(_d_vector_x * 2. + _d_vector_y * 3.);
+    clad::ValueAndPushforward<double, clad::array<double>> res = {
+        1., std::move(_d_vector_z)};
+    benchmark::DoNotOptimize(res.pushforward[0]);
+  }
+}
+BENCHMARK(BM_ArrayMemory)->RangeMultiplier(2)->Range(2, 64);
+
 #include "BenchmarkedFunctions.h"
 static void BM_ReverseGausMemoryP(benchmark::State& state) {
   auto dfdp_grad = clad::gradient(gaus, "p");
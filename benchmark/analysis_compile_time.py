@@ -0,0 +1,116 @@
+"""Measures the compile-time cost of the TBR, varied and useful analyses.
+
+Generates a synthetic function with many statements spread over nested loops
+and branches, differentiates it in reverse mode and reports the time clang
+needs with each combination of analyses, e.g.:
+
+  python3 analysis_compile_time.py --clang=clang++ \\
+      --clad=build/lib/clad.so --include=include --statements=10000
+"""
+import argparse
+import os
+import random
+import subprocess
+import tempfile
+import time
+
+CONFIGS = [
+    ("no analyses", ["-disable-tbr"]),
+    ("tbr", ["-enable-tbr"]),
+    ("tbr+va", ["-enable-tbr", "-enable-va"]),
+    ("tbr+va+ua", ["-enable-tbr", "-enable-va", "-enable-ua"]),
+]
+
+
+def generate(statements, num_vars, depth, seed):
+    rng = random.Random(seed)
+    lines = ["#include \"clad/Differentiator/Differentiator.h\"", ""]
+    lines.append("double f(double* x, double y) {")
+    for v in range(num_vars):
+        lines.append(f"  double a{v} = x[{v % 4}] * y;")
+
+    def expr():
+        a, b = rng.randrange(num_vars), rng.randrange(num_vars)
+        op = rng.choice(["+", "-", "*"])
+        return f"a{a} {op} a{b} * {rng.randint(1, 9)}"
+
+    emitted = 0
+    loop = 0
+    while emitted < statements:
+        indent = "  "
+        nest = rng.randint(1, depth)
+        for _ in range(nest):
+            lines.append(f"{indent}for (int i{loop} = 0; i{loop} < 3; ++i{loop}) {{")
+            loop += 1
+            indent += "  "
+        for _ in range(min(20, statements - emitted)):
+            target = rng.randrange(num_vars)
+            if rng.random() < 0.2:
+                lines.append(f"{indent}if (a{target} > 1)")
+                lines.append(f"{indent}  a{target} = {expr()};")
+                lines.append(f"{indent}else")
+                lines.append(f"{indent}  a{target} *= a{rng.randrange(num_vars)};")
+            else:
+                lines.append(f"{indent}a{target} = {expr()};")
+            emitted += 1
+        for _ in range(nest):
+            indent = indent[:-2]
+            lines.append(f"{indent}}}")
+    result = " + ".join(f"a{v}" for v in range(num_vars))
+    lines.append(f"  return {result};")
+    lines.append("}")
+    lines.append("")
+    lines.append("int main() { clad::gradient(f, \"x, y\"); }")
+    return "\n".join(lines) + "\n"
+
+
+def compile_time(args, source, options):
+    cmd = [args.clang, "-std=c++17", "-fsyntax-only", f"-I{args.include}",
+           "-Xclang", "-add-plugin", "-Xclang", "clad",
+           "-Xclang", "-load", "-Xclang", args.clad]
+    for option in options:
+        cmd += ["-Xclang", "-plugin-arg-clad", "-Xclang", option]
+    cmd.append(source)
+    best = None
+    for _ in range(args.repeat):
+        start = time.perf_counter()
+        subprocess.run(cmd, check=True)
+        elapsed = time.perf_counter() - start
+        best = elapsed if best is None else min(best, elapsed)
+    return best
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--clang", default="clang++", help="The clang driver")
+    parser.add_argument("--clad", required=True, help="The clad plugin")
+    parser.add_argument("--include", required=True,
+                        help="The include directory of clad")
+    parser.add_argument("--statements", type=int, default=10000,
+                        help="The number of statements of the function")
+    parser.add_argument("--vars", type=int, default=64,
+                        help="The number of local variables")
+    parser.add_argument("--depth", type=int, default=3,
+                        help="The maximal depth of the loop nests")
+    parser.add_argument("--repeat", type=int, default=3,
+                        help="The number of runs, the fastest one is reported")
+    parser.add_argument("--seed", type=int, default=42)
+    args = parser.parse_args()
+
+    code = generate(args.statements, args.vars, args.depth, args.seed)
+    with tempfile.TemporaryDirectory() as tmp:
+        source = os.path.join(tmp, "synthetic.cpp")
+        with open(source, "w") as f:
+            f.write(code)
+        baseline = None
+        print(f"{args.statements} statements, {args.vars} variables")
+        for name, options in CONFIGS:
+            seconds = compile_time(args, source, options)
+            if baseline is None:
+                baseline = seconds
+            print(f"{name:>12}: {seconds:8.3f} s "
+                  f"(analyses {seconds - baseline:+8.3f} s)")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,26 @@
+//--------------------------------------------------------------------*- C++ -*-
+// clad - The C++ Clang-based Automatic Differentiator
+//
+// The function demoted by the MixedPrecision demo, see README.md.
+//----------------------------------------------------------------------------//
+
+#ifndef CLAD_DEMOS_MIXED_PRECISION_KERNEL_H
+#define CLAD_DEMOS_MIXED_PRECISION_KERNEL_H
+
+// Necessary for clad to work include
+#include "clad/Differentiator/Differentiator.h"
+
+// The sum of squares carries most of the result and needs double precision,
+// the small correction term does not.
+double kernel(double* x, int n) {
+  double sum = 0;
+  double correction = 0;
+  for (int i = 0; i < n; i++) {
+    double t = x[i] * x[i];
+    sum += t;
+    correction += 1e-8 * t;
+  }
+  return sum + correction;
+}
+
+#endif // CLAD_DEMOS_MIXED_PRECISION_KERNEL_H
@@ -0,0 +1,307 @@
+"""Demotes the variables of a function to lower precision guided by clad.
+
+Estimates the floating-point error of every variable of a function with
+clad::estimate_error<clad::opts::accumulate_errors>, writes a copy of the
+function where the double variables whose error stays below a tolerance are
+declared as float (or as a half precision type) and benchmarks both versions:
+
+  python3 demote.py --function=kernel --inputs="x, 64" \\
+      --setup="double x[64]; for (int i = 0; i < 64; ++i) x[i] = i;" \\
+      --tolerance=1e-6 Kernel.h -- clang++ -std=c++17 -Iclad/include \\
+      -Xclang -add-plugin -Xclang clad -Xclang -load -Xclang clad.so
+
+The error of a variable is the estimate of clad's default model, which
+assumes the variable is stored in single precision. For half precision it is
+scaled by the ratio of the machine epsilons. The source file must not define
+main; the demoted copy is named <function>_mixed.
+"""
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+# The machine epsilon of half precision over the one of single precision.
+HALF_ERROR_SCALE = 2.0 ** 13
+
+ESTIMATE_TEMPLATE = """\
+#include "{source}"
+#include "clad/Differentiator/ErrorAccumulator.h"
+
+#include <cstdio>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+template <std::size_t I, typename F> struct clad_demote_param;
+template <std::size_t I, typename R, typename... Args>
+struct clad_demote_param<I, R (*)(Args...)> {{
+  using type = typename std::tuple_element<I, std::tuple<Args...>>::type;
+}};
+
+// The storage of the adjoint of a parameter of type T.
+template <typename T> struct clad_demote_adjoint {{
+  typename std::remove_cv<typename std::remove_reference<T>::type>::type
+      value{{}};
+  decltype(&value) get() {{ return &value; }}
+}};
+template <typename T> struct clad_demote_adjoint<T*> {{
+  std::vector<typename std::remove_cv<T>::type> value =
+      std::vector<typename std::remove_cv<T>::type>({array_size});
+  typename std::remove_cv<T>::type* get() {{ return value.data(); }}
+}};
+
+int main() {{
+  {setup}
+  clad::error_accumulator acc;
+  auto df = clad::estimate_error<clad::opts::accumulate_errors>({function});
+{adjoints}
+  df.execute({inputs}, {adjoint_args}acc);
+  for (std::size_t i = 0, e = acc.size(); i < e; ++i)
+    printf("%s %.17g\\n", acc.name(i).c_str(), acc.at(i));
+}}
+"""
+
+BENCHMARK_TEMPLATE = """\
+#include "{output}"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+template <typename F> double clad_demote_time(F f, long iterations) {{
+  // Warm up the caches before timing.
+  f();
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < iterations; ++i)
+    f();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}}
+
+int main() {{
+  {setup}
+  volatile double original = 0, mixed = 0;
+  double t_original =
+      clad_demote_time([&]() {{ {original_call} }}, {iterations});
+  double t_mixed = clad_demote_time([&]() {{ {mixed_call} }}, {iterations});
+  printf("original: %.6f s\\n", t_original);
+  printf("mixed: %.6f s\\n", t_mixed);
+  printf("speedup: %.2fx\\n", t_original / t_mixed);
+  if ({has_result}) {{
+    double diff = std::fabs(original - mixed);
+    double scale = std::fabs(original);
+    printf("relative difference: %.3g\\n", scale ? diff / scale : diff);
+  }}
+}}
+"""
+
+
+def run(cmd, **kwargs):
+    result = subprocess.run(cmd, stdout=subprocess.PIPE, text=True, **kwargs)
+    if result.returncode != 0:
+        sys.exit(f"demote.py: error: '{' '.join(cmd)}' failed")
+    return result.stdout
+
+
+def load_json_objects(text):
+    """Parses the JSON objects printed one after the other by -ast-dump."""
+    decoder = json.JSONDecoder()
+    objects = []
+    pos = text.find("{")
+    while pos != -1:
+        try:
+            obj, end = decoder.raw_decode(text, pos)
+        except json.JSONDecodeError:
+            end = pos + 1
+        else:
+            objects.append(obj)
+        pos = text.find("{", end)
+    return objects
+
+
+def find_function(objects, name, source):
+    """Returns the definition of the free function called name in source."""
+    for obj in objects:
+        if obj.get("kind") != "FunctionDecl" or obj.get("name") != name:
+            continue
+        inner = obj.get("inner", [])
+        if not any(n.get("kind") == "CompoundStmt" for n in inner):
+            continue
+        loc = obj.get("loc", {})
+        offset = loc.get("offset")
+        if offset is None or "spellingLoc" in loc:
+            continue
+        if source[offset:offset + len(name)] == name.encode():
+            return obj
+    return None
+
+
+def collect_decls(node, decls):
+    """Collects the parameters and the variables declared in a function."""
+    for child in node.get("inner", []):
+        if child.get("kind") in ("ParmVarDecl", "VarDecl") and \
+                not child.get("isImplicit"):
+            decls.append(child)
+        collect_decls(child, decls)
+    return decls
+
+
+def demotable(decl, source):
+    """Returns the offset of the double keyword of a scalar declaration."""
+    if decl["type"]["qualType"] not in ("double", "const double"):
+        return None
+    begin = decl["range"]["begin"].get("offset")
+    end = decl["loc"].get("offset")
+    if begin is None or end is None:
+        return None
+    match = re.search(rb"\bdouble\b", source[begin:end])
+    return begin + match.start() if match else None
+
+
+def estimate_errors(args, compiler, source_path, params, tmp):
+    adjoints = "\n".join(
+        f"  clad_demote_adjoint<clad_demote_param<{i}, "
+        f"decltype(&{args.function})>::type> _d_{i};"
+        for i in range(len(params)))
+    adjoint_args = "".join(f"_d_{i}.get(), " for i in range(len(params)))
+    driver = os.path.join(tmp, "estimate.cpp")
+    with open(driver, "w") as f:
+        f.write(ESTIMATE_TEMPLATE.format(
+            source=source_path, setup=args.setup, function=args.function,
+            array_size=args.array_size, adjoints=adjoints,
+            inputs=args.inputs, adjoint_args=adjoint_args))
+    binary = os.path.join(tmp, "estimate")
+    run(compiler + [driver, "-o", binary])
+    errors = {}
+    for line in run([binary]).splitlines():
+        name, error = line.rsplit(" ", 1)
+        errors[name] = float(error)
+    return errors
+
+
+def benchmark(args, compiler, output, returns_void, tmp):
+    def call(fn, result):
+        invocation = f"{fn}({args.inputs});"
+        return invocation if returns_void else f"{result} += {invocation}"
+
+    driver = os.path.join(tmp, "benchmark.cpp")
+    with open(driver, "w") as f:
+        f.write(BENCHMARK_TEMPLATE.format(
+            output=os.path.abspath(output), setup=args.setup,
+            original_call=call(args.function, "original"),
+            mixed_call=call(args.function + "_mixed", "mixed"),
+            iterations=args.iterations,
+            has_result="false" if returns_void else "true"))
+    binary = os.path.join(tmp, "benchmark")
+    run(compiler + ["-O2", driver, "-o", binary])
+    sys.stdout.write(run([binary]))
+
+
+def main():
+    argv = sys.argv[1:]
+    if "--" not in argv:
+        sys.exit("demote.py: error: the compiler command must follow '--'")
+    split = argv.index("--")
+    argv, compiler = argv[:split], argv[split + 1:]
+
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("source", help="The file defining the function")
+    parser.add_argument("--function", required=True,
+                        help="The name of the function to demote")
+    parser.add_argument("--inputs", required=True,
+                        help="The arguments of the calls, as C++ code")
+    parser.add_argument("--setup", default="",
+                        help="C++ statements declaring the arguments")
+    parser.add_argument("--tolerance", type=float, required=True,
+                        help="The largest error a demoted variable may add")
+    parser.add_argument("--precision", choices=["float", "half"],
+                        default="float", help="The type to demote to")
+    parser.add_argument("--half-type", default="_Float16",
+                        help="The half precision type, e.g. a custom class")
+    parser.add_argument("--half-include", default=None,
+                        help="The header declaring the half precision type")
+    parser.add_argument("--array-size", type=int, default=4096,
+                        help="The length of the adjoints of array arguments")
+    parser.add_argument("--iterations", type=int, default=100000,
+                        help="The number of calls timed by the benchmark")
+    parser.add_argument("--output", default=None,
+                        help="The file receiving the demoted copy")
+    parser.add_argument("--no-benchmark", action="store_true",
+                        help="Only write the demoted copy")
+    args = parser.parse_args(argv)
+
+    source_path = os.path.abspath(args.source)
+    with open(source_path, "rb") as f:
+        source = f.read()
+    dump = run(compiler + ["-fsyntax-only", "-Xclang", "-ast-dump=json",
+                           "-Xclang", f"-ast-dump-filter={args.function}",
+                           source_path])
+    fn = find_function(load_json_objects(dump), args.function, source)
+    if not fn:
+        sys.exit(f"demote.py: error: no definition of '{args.function}' "
+                 f"in {args.source}")
+    decls = collect_decls(fn, [])
+    params = [d for d in decls if d["kind"] == "ParmVarDecl"]
+
+    with tempfile.TemporaryDirectory() as tmp:
+        errors = estimate_errors(args, compiler, source_path, params, tmp)
+        scale = HALF_ERROR_SCALE if args.precision == "half" else 1.0
+        target = args.half_type if args.precision == "half" else "float"
+
+        # Variables of the same name share their estimate, and declarations
+        # like `double a, b;` share their type, so they are demoted together.
+        by_name = {}
+        for decl in decls:
+            by_name.setdefault(decl.get("name"), []).append(decl)
+        safe = {}
+        for name, group in by_name.items():
+            offsets = [demotable(d, source) for d in group]
+            safe[name] = name in errors and None not in offsets and \
+                errors[name] * scale <= args.tolerance
+        by_offset = {}
+        for decl in decls:
+            offset = demotable(decl, source)
+            if offset is not None:
+                by_offset.setdefault(offset, []).append(decl.get("name"))
+
+        print(f"{'variable':<20} {'error':>12}  decision")
+        for name in by_name:
+            if name not in errors:
+                continue
+            decision = f"demoted to {target}" if safe[name] else "kept"
+            print(f"{name:<20} {errors[name] * scale:>12.4g}  {decision}")
+
+        begin = fn["range"]["begin"]["offset"]
+        end = fn["range"]["end"]["offset"] + fn["range"]["end"]["tokLen"]
+        # Replace from the end so that the earlier offsets stay valid.
+        edits = [(fn["loc"]["offset"], len(args.function),
+                  f"{args.function}_mixed")]
+        for offset, names in by_offset.items():
+            if all(safe.get(name) for name in names):
+                edits.append((offset, len("double"), target))
+        copy = source[begin:end]
+        for offset, length, text in sorted(edits, reverse=True):
+            offset -= begin
+            copy = copy[:offset] + text.encode() + copy[offset + length:]
+
+        output = args.output or \
+            os.path.splitext(os.path.basename(args.source))[0] + ".mixed.h"
+        with open(output, "w") as f:
+            f.write(f"// The copy of {args.function} demoted by demote.py.\n")
+            f.write(f"#include \"{source_path}\"\n")
+            if args.precision == "half" and args.half_include:
+                f.write(f"#include \"{args.half_include}\"\n")
+            f.write("\n" + copy.decode() + "\n")
+        print(f"wrote {output}")
+
+        if not args.no_benchmark:
+            returns_void = fn["type"]["qualType"].startswith("void ")
+            benchmark(args, compiler, output, returns_void, tmp)
+
+
+if __name__ == "__main__":
+    main()
@@ -1,6 +1,8 @@
 #ifndef CLAD_DIFFERENTIATOR_ARRAYEXPRESSION_H
 #define CLAD_DIFFERENTIATOR_ARRAYEXPRESSION_H
 
+#include "clad/Differentiator/ArraySimd.h"
+
 #include <algorithm>
 #include <type_traits>
 
@@ -81,6 +83,10 @@ public:
   }
 
   std::size_t size() const { return std::max(get_size(l), get_size(r)); }
+
+  // The operands, for the vectorized evaluation in ArraySimd.h.
+  const LeftExp& left() const { return l; }
+  const RightExp& right() const { return r; }
 };
 
 // A template class to determine whether a given type is array_expression, array
@@ -61,8 +61,7 @@ public:
   CUDA_HOST_DEVICE array_ref<T>&
   operator=(const array_expression<L, BinaryOp, R>& arr_exp) {
     assert(arr_exp.size() == m_size);
-    for (std::size_t i = 0; i < m_size; i++)
-      m_arr[i] = arr_exp[i];
+    simd::apply<BinaryAssign>(m_arr, m_size, arr_exp);
     return *this;
   }
   /// Returns the size of the underlying array
@@ -133,8 +132,7 @@ public:
   CUDA_HOST_DEVICE array_ref<T>&
   operator*=(const array_expression<L, BinaryOp, R>& arr_exp) {
     assert(arr_exp.size() == m_size);
-    for (std::size_t i = 0; i < m_size; i++)
-      m_arr[i] *= arr_exp[i];
+    simd::apply<BinaryMul>(m_arr, m_size, arr_exp);
     return *this;
   }
   /// Adds the elements of the array_ref by elements of the array
@@ -142,8 +140,7 @@ public:
   CUDA_HOST_DEVICE array_ref<T>&
   operator+=(const array_expression<L, BinaryOp, R>& arr_exp) {
     assert(arr_exp.size() == m_size);
-    for (std::size_t i = 0; i < m_size; i++)
-      m_arr[i] += arr_exp[i];
+    simd::apply<BinaryAdd>(m_arr, m_size, arr_exp);
     return *this;
   }
   /// Subtracts the elements of the array_ref by elements of the array
@@ -151,8 +148,7 @@ public:
   CUDA_HOST_DEVICE array_ref<T>&
   operator-=(const array_expression<L, BinaryOp, R>& arr_exp) {
     assert(arr_exp.size() == m_size);
-    for (std::size_t i = 0; i < m_size; i++)
-      m_arr[i] -= arr_exp[i];
+    simd::apply<BinarySub>(m_arr, m_size, arr_exp);
     return *this;
   }
   /// Divides the elements of the array_ref by elements of the array
@@ -160,8 +156,7 @@ public:
   CUDA_HOST_DEVICE array_ref<T>&
   operator/=(const array_expression<L, BinaryOp, R>& arr_exp) {
     assert(arr_exp.size() == m_size);
-    for (std::size_t i = 0; i < m_size; i++)
-      m_arr[i] /= arr_exp[i];
+    simd::apply<BinaryDiv>(m_arr, m_size, arr_exp);
     return *this;
   }
   /// Multiplies the elements of the array_ref by elements of the array
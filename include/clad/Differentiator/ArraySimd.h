@@ -0,0 +1,218 @@
+#ifndef CLAD_DIFFERENTIATOR_ARRAYSIMD_H
+#define CLAD_DIFFERENTIATOR_ARRAYSIMD_H
+
+#include "clad/Differentiator/CladConfig.h"
+
+#include <cstddef>
+#include <type_traits>
+
+// Explicitly vectorized evaluation of the clad::array expression templates.
+// The width is picked at compile time from the instruction set the translation
+// unit is built for, AVX-512, AVX or SSE2, with the element-wise loop as the
+// fallback. Define CLAD_NO_SIMD to always use the loop.
+#if !defined(CLAD_NO_SIMD) && !defined(__CUDACC__) && !defined(__CUDA__) &&  \
+    !defined(__HIP__)
+#if defined(__AVX512F__)
+#define CLAD_SIMD_BYTES 64
+#elif defined(__AVX__)
+#define CLAD_SIMD_BYTES 32
+#elif defined(__SSE2__) || defined(_M_X64) ||                                  \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CLAD_SIMD_BYTES 16
+#endif
+#endif
+
+#ifdef CLAD_SIMD_BYTES
+#include <immintrin.h>
+#endif
+
+// NOLINTBEGIN(*-pointer-arithmetic)
+namespace clad {
+template <typename T> class array;
+template <typename T> class array_ref;
+template <typename LeftExp, typename BinaryOp, typename RightExp>
+class array_expression;
+struct BinaryAdd;
+struct BinaryMul;
+struct BinaryDiv;
+struct BinarySub;
+
+// Operator to assign an element, used to evaluate `a = expression`.
+struct BinaryAssign {
+  template <typename T, typename U>
+  CUDA_HOST_DEVICE static const U& apply(const T& /*t*/, const U& u) {
+    return u;
+  }
+};
+
+namespace simd {
+/// The number of elements of type T evaluated at once, 1 if T has no
+/// vectorized evaluation.
+template <typename T> struct width : std::integral_constant<std::size_t, 1> {};
+
+/// A register holding W elements of type T. Its arithmetic operators let the
+/// Binary* operators of the expression templates apply to whole registers.
+template <typename T, std::size_t W> struct pack;
+
+#ifdef CLAD_SIMD_BYTES
+template <>
+struct width<double>
+    : std::integral_constant<std::size_t, CLAD_SIMD_BYTES / sizeof(double)> {};
+template <>
+struct width<float>
+    : std::integral_constant<std::size_t, CLAD_SIMD_BYTES / sizeof(float)> {};
+
+// The intrinsics are named after the register width and the element type,
+// e.g. _mm256_add_pd, so every pack is generated from the two.
+#define CLAD_SIMD_PACK(T, W, Reg, Prefix, Kind)                                \
+  template <> struct pack<T, W> {                                              \
+    Reg v;                                                                     \
+    static pack load(const T* p) { return {Prefix##_loadu_##Kind(p)}; }        \
+    static pack broadcast(T t) { return {Prefix##_set1_##Kind(t)}; }           \
+    void store(T* p) const { Prefix##_storeu_##Kind(p, v); }                   \
+    friend pack operator+(pack a, pack b) {                                    \
+      return {Prefix##_add_##Kind(a.v, b.v)};                                  \
+    }                                                                          \
+    friend pack operator-(pack a, pack b) {                                    \
+      return {Prefix##_sub_##Kind(a.v, b.v)};                                  \
+    }                                                                          \
+    friend pack operator*(pack a, pack b) {                                    \
+      return {Prefix##_mul_##Kind(a.v, b.v)};                                  \
+    }                                                                          \
+    friend pack operator/(pack a, pack b) {                                    \
+      return {Prefix##_div_##Kind(a.v, b.v)};                                  \
+    }                                                                          \
+  };
+
+#if CLAD_SIMD_BYTES == 64
+CLAD_SIMD_PACK(double, 8, __m512d, _mm512, pd)
+CLAD_SIMD_PACK(float, 16, __m512, _mm512, ps)
+#elif CLAD_SIMD_BYTES == 32
+CLAD_SIMD_PACK(double, 4, __m256d, _mm256, pd)
+CLAD_SIMD_PACK(float, 8, __m256, _mm256, ps)
+#else
+CLAD_SIMD_PACK(double, 2, __m128d, _mm, pd)
+CLAD_SIMD_PACK(float, 4, __m128, _mm, ps)
+#endif
+#undef CLAD_SIMD_PACK
+#endif // CLAD_SIMD_BYTES
+
+template <typename T>
+using remove_cvref_t =
+    typename std::remove_cv<typename std::remove_reference<T>::type>::type;
+
+template <typename Op> struct is_simd_op : std::false_type {};
+template <> struct is_simd_op<BinaryAdd> : std::true_type {};
+template <> struct is_simd_op<BinaryMul> : std::true_type {};
+template <> struct is_simd_op<BinaryDiv> : std::true_type {};
+template <> struct is_simd_op<BinarySub> : std::true_type {};
+
+/// Whether the operand E of an expression assigned to elements of type T can
+/// be evaluated a register at a time with the same result as the loop. That
+/// is the case for clad::array<T> and clad::array_ref<T>, read with unit
+/// stride, for scalars converted to T by the usual arithmetic conversions and
+/// for expressions of those.
+template <typename T, typename E, bool = std::is_arithmetic<E>::value>
+struct is_simd_operand : std::false_type {};
+template <typename T, typename E>
+struct is_simd_operand<T, E, true>
+    : std::is_same<typename std::common_type<T, E>::type, T> {};
+template <typename T>
+struct is_simd_operand<T, array<T>, false> : std::true_type {};
+template <typename T>
+struct is_simd_operand<T, array_ref<T>, false> : std::true_type {};
+template <typename T, typename L, typename BinaryOp, typename R>
+struct is_simd_operand<T, array_expression<L, BinaryOp, R>, false>
+    : std::integral_constant<bool,
+                             is_simd_op<BinaryOp>::value &&
+                                 is_simd_operand<T, remove_cvref_t<L>>::value &&
+                                 is_simd_operand<T, remove_cvref_t<R>>::value> {
+};
+
+/// An operand of an expression bound to raw pointers and registers before the
+/// loop. The unaligned stores may alias anything, so operands read through the
+/// references of the expression would be reloaded at every iteration.
+/// The primary template is a scalar, broadcast to all the elements.
+template <typename T, std::size_t W, typename E> struct operand {
+  pack<T, W> v;
+  static operand bind(const E& e) {
+    return {pack<T, W>::broadcast(static_cast<T>(e))};
+  }
+  pack<T, W> load(std::size_t /*i*/) const { return v; }
+};
+
+template <typename T, std::size_t W> struct operand<T, W, array<T>> {
+  const T* p;
+  static operand bind(const array<T>& a) { return {a.ptr()}; }
+  pack<T, W> load(std::size_t i) const { return pack<T, W>::load(p + i); }
+};
+
+template <typename T, std::size_t W> struct operand<T, W, array_ref<T>> {
+  const T* p;
+  static operand bind(const array_ref<T>& a) { return {a.ptr()}; }
+  pack<T, W> load(std::size_t i) const { return pack<T, W>::load(p + i); }
+};
+
+template <typename T, std::size_t W, typename L, typename BinaryOp,
+          typename R>
+struct operand<T, W, array_expression<L, BinaryOp, R>> {
+  using left_t = operand<T, W, remove_cvref_t<L>>;
+  using right_t = operand<T, W, remove_cvref_t<R>>;
+  left_t l;
+  right_t r;
+  static operand bind(const array_expression<L, BinaryOp, R>& e) {
+    return {left_t::bind(e.left()), right_t::bind(e.right())};
+  }
+  pack<T, W> load(std::size_t i) const {
+    return BinaryOp::apply(l.load(i), r.load(i));
+  }
+};
+
+/// Computes `*p op= v` for a register of elements.
+template <typename BinaryOp> struct updater {
+  template <typename T, std::size_t W>
+  static void update(T* p, const pack<T, W>& v) {
+    BinaryOp::apply(pack<T, W>::load(p), v).store(p);
+  }
+};
+template <> struct updater<BinaryAssign> {
+  template <typename T, std::size_t W>
+  static void update(T* p, const pack<T, W>& v) {
+    v.store(p);
+  }
+};
+
+template <typename BinaryOp, typename T, typename E>
+CUDA_HOST_DEVICE std::size_t apply_packs(T* /*dst*/, std::size_t /*n*/,
+                                         const E& /*e*/, std::false_type) {
+  return 0;
+}
+
+template <typename BinaryOp, typename T, typename E>
+std::size_t apply_packs(T* dst, std::size_t n, const E& e, std::true_type) {
+  constexpr std::size_t W = width<T>::value;
+  const auto op = operand<T, W, E>::bind(e);
+  std::size_t i = 0;
+  for (; i + W <= n; i += W)
+    updater<BinaryOp>::update(dst + i, op.load(i));
+  return i;
+}
+
+/// Computes `dst[i] = BinaryOp::apply(dst[i], e[i])` for the first \p n
+/// elements, i.e. `dst[i] op= e[i]`, a register at a time when the types
+/// allow it. Like the loop, the evaluation assumes that \p dst does not
+/// partially overlap the arrays read by \p e.
+template <typename BinaryOp, typename T, typename E>
+CUDA_HOST_DEVICE void apply(T* dst, std::size_t n, const E& e) {
+  using vectorize =
+      std::integral_constant<bool, (width<T>::value > 1) &&
+                                       is_simd_operand<T, E>::value>;
+  std::size_t i = apply_packs<BinaryOp>(dst, n, e, vectorize());
+  for (; i < n; ++i)
+    dst[i] = BinaryOp::apply(dst[i], e[i]);
+}
+} // namespace simd
+} // namespace clad
+// NOLINTEND(*-pointer-arithmetic)
+
+#endif // CLAD_DIFFERENTIATOR_ARRAYSIMD_H
@@ -11,6 +11,7 @@
 
 #include <cstdlib>
 #include <memory>
+#include <type_traits>
 
 namespace clad {
 // The aim is to have a single unsigned integer for storing both, the
@@ -43,8 +44,27 @@ enum opts : unsigned {
   // Specifying whether we only want the diagonal of the hessian.
   diagonal_only = 1 << (ORDER_BITS + 4),
 
+  // Specifying that only the upper triangle of the hessian is computed and
+  // stored in packed (LAPACK 'U') format.
+  packed = 1 << (ORDER_BITS + 13),
+
   // Specify that we need a constexpr-enabled CladFunction
   immediate_mode = 1 << (ORDER_BITS + 7),
+
+  // Specifying that the derivative is used to compute a sparse jacobian or
+  // hessian from compressed evaluations.
+  sparse = 1 << (ORDER_BITS + 8),
+
+  // Specifying that the columns of the hessian are computed concurrently.
+  parallel = 1 << (ORDER_BITS + 12),
+
+  // Specifying that the jacobian picks forward or reverse mode depending on
+  // the number of independent and output variables.
+  auto_mode = 1 << (ORDER_BITS + 14),
+
+  // Specifying that the error estimates are recorded per variable into a
+  // clad::error_accumulator instead of being summed into a double.
+  accumulate_errors = 1 << (ORDER_BITS + 15),
 }; // enum opts
 
 constexpr unsigned GetDerivativeOrder(const unsigned bitmasked_opts) {
@@ -62,6 +82,10 @@ constexpr unsigned GetBitmaskedOpts(const unsigned first, Opts... opts) {
   return first | GetBitmaskedOpts(opts...);
 }
 
+/// Repairs an object whose bytes were copied to another address, e.g. written
+/// to disk and read back. Overloaded for the types that point into themselves.
+template <typename T> void relocated(T& /*obj*/) {}
+
 } // namespace clad
 
 // Define CUDA_HOST_DEVICE attribute for adding CUDA support to
@@ -368,7 +368,7 @@ namespace clad {
         clang::Sema& S, const clang::FunctionDecl* FD, DiffMode mode,
         llvm::ArrayRef<const clang::ValueDecl*> diffParams,
         bool forCustomDerv = false, bool shouldUseRestoreTracker = false,
-        bool isForErrorEstimation = false);
+        bool isForErrorEstimation = false, bool useErrorAccumulator = false);
     /// Find declaration of clad::class templated type
     ///
     /// \param[in] className name of the class to be found
@@ -412,6 +412,8 @@ namespace clad {
                                                clang::QualType Type);
 
     clang::QualType GetRestoreTrackerType(clang::Sema& S);
+    /// Returns type clad::error_accumulator
+    clang::QualType GetErrorAccumulatorType(clang::Sema& S);
 
     void SetSwitchCaseSubStmt(clang::SwitchCase* SC, clang::Stmt* subStmt);
 
@@ -95,6 +95,9 @@ struct DerivativeAndOverload {
     /// A flag to keep track of whether error diagnostics are requested by user
     /// for numerical differentiation.
     bool m_PrintNumericalDiffErrorDiag = false;
+    /// Whether numerical differentiation of functions templated on their
+    /// scalar type may use the complex step instead of central differences.
+    bool m_NumDiffComplexStep = false;
     DeclWithContext cloneFunction(const clang::FunctionDecl* FD,
                                   clad::VisitorBase& VB, clang::DeclContext* DC,
                                   clang::SourceLocation& noLoc,
@@ -169,6 +172,14 @@ struct DerivativeAndOverload {
     /// \returns The flag  that controls printing of error information for
     /// numerical differentiation.
     bool shouldPrintNumDiffErrs() { return m_PrintNumericalDiffErrorDiag; }
+    /// Function to allow the complex-step method in numerical
+    /// differentiation.
+    ///
+    /// \param[in] \c value The new value to be set.
+    void setNumDiffComplexStep(bool value) { m_NumDiffComplexStep = value; }
+    /// \returns true if numerical differentiation may use the complex-step
+    /// method.
+    bool shouldUseNumDiffComplexStep() { return m_NumDiffComplexStep; }
     ///\brief Produces the derivative of a given function
     /// according to a given plan.
     ///
@@ -0,0 +1,69 @@
+#ifndef CLAD_DIFFERENTIATOR_DERIVATIVECACHE_H
+#define CLAD_DIFFERENTIATOR_DERIVATIVECACHE_H
+
+#include "llvm/ADT/StringRef.h"
+
+#include <string>
+
+namespace clang {
+class ASTContext;
+class FunctionDecl;
+} // namespace clang
+
+namespace clad {
+struct DiffRequest;
+class DerivedFnCollector;
+
+/// Stores the source code of generated derivatives on disk so that later
+/// compilations can re-parse them instead of deriving them again. Entries are
+/// keyed by the ODR hash of the differentiated function, the ODR hashes of the
+/// functions it calls, transitively, and of the records and variables they
+/// use, the signatures of the custom derivatives, the options of the request
+/// and the version of clad. Edits elsewhere in the translation unit keep the
+/// entries valid.
+class DerivativeCache {
+  /// The directory holding one <key>.cpp file per derivative.
+  std::string m_Path;
+  /// The hash of the custom derivatives, computed by the first key.
+  std::string m_CustomDerivativesDigest;
+  unsigned m_NumHits = 0;
+  unsigned m_NumMisses = 0;
+  unsigned m_NumStores = 0;
+  unsigned m_NumDiscarded = 0;
+
+  const std::string& getCustomDerivativesDigest(clang::ASTContext& C);
+
+public:
+  DerivativeCache(llvm::StringRef Path) : m_Path(Path.str()) {}
+
+  /// \returns true if the derivative of the request can be re-parsed from its
+  /// source code at the translation unit scope.
+  static bool isCacheable(const DiffRequest& request);
+
+  /// \returns true if the derivative only refers to declarations that exist
+  /// before clad runs, i.e. it does not call other generated derivatives.
+  static bool isSelfContained(const clang::FunctionDecl* derivative,
+                              const DerivedFnCollector& DFC);
+
+  /// \returns the key of the derivative of the request.
+  std::string getKey(const DiffRequest& request);
+
+  /// Reads the cached source of the derivative with the given key.
+  /// \returns true if an entry was found.
+  bool lookup(llvm::StringRef key, std::string& source);
+
+  /// Writes the source of the derivative with the given key.
+  void store(llvm::StringRef key, llvm::StringRef source);
+
+  /// Removes the entry with the given key, e.g. if it failed to parse. The
+  /// lookup of the entry is then counted as a miss.
+  void erase(llvm::StringRef key);
+
+  unsigned getNumHits() const { return m_NumHits; }
+  unsigned getNumMisses() const { return m_NumMisses; }
+  unsigned getNumStores() const { return m_NumStores; }
+  unsigned getNumDiscarded() const { return m_NumDiscarded; }
+};
+} // namespace clad
+
+#endif // CLAD_DIFFERENTIATOR_DERIVATIVECACHE_H
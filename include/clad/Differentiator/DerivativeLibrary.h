@@ -0,0 +1,64 @@
+#ifndef CLAD_DIFFERENTIATOR_DERIVATIVELIBRARY_H
+#define CLAD_DIFFERENTIATOR_DERIVATIVELIBRARY_H
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <string>
+
+namespace clang {
+class FunctionDecl;
+class SourceManager;
+} // namespace clang
+
+namespace clad {
+struct DiffRequest;
+class DerivedFnCollector;
+
+/// Collects the derivatives of a translation unit and writes them to a source
+/// file which can be compiled and optimized on its own, without the plugin.
+/// The file registers the derivatives requested through clad::differentiate,
+/// clad::gradient, clad::hessian and clad::jacobian so that builds defining
+/// CLAD_DERIVATIVE_LIBRARY find them at runtime, see DerivativeRegistry.h.
+class DerivativeLibrary {
+  /// A derivative looked up by the calls to the clad interfaces.
+  struct Entry {
+    const clang::FunctionDecl* Function;
+    /// The mode of the request, see DiffModeToString.
+    std::string Mode;
+    /// The options and the order of the call, see DiffRequest::BitMaskedOpts.
+    unsigned Opts;
+    /// The independent parameters as spelled in the request.
+    std::string Args;
+    /// The index of the independent parameter, -1 if given by name.
+    int ArgIndex;
+    /// The function the call is updated with, the derivative or its overload.
+    const clang::FunctionDecl* Derivative;
+    /// The code printed by CladFunction::dump.
+    std::string Code;
+  };
+
+  /// The derivatives in the order of their generation.
+  llvm::SmallVector<const clang::FunctionDecl*, 16> m_Derivatives;
+  llvm::SmallVector<Entry, 8> m_Entries;
+
+public:
+  /// Adds a generated derivative, or an overload of it, to the library.
+  void addDerivative(const clang::FunctionDecl* FD);
+
+  /// Registers the derivative the call of \p request is updated with.
+  /// Like the derivative cache, only first order derivatives of functions at
+  /// the translation unit scope are registered.
+  void addEntry(const DiffRequest& request,
+                const clang::FunctionDecl* derivative,
+                const clang::FunctionDecl* overload);
+
+  /// Writes the library. The declarations the derivatives refer to are
+  /// re-declared if they come from the main file and included otherwise.
+  void print(llvm::raw_ostream& Out, const clang::SourceManager& SM,
+             const DerivedFnCollector& DFC) const;
+};
+} // namespace clad
+
+#endif // CLAD_DIFFERENTIATOR_DERIVATIVELIBRARY_H
@@ -0,0 +1,131 @@
+#ifndef CLAD_DIFFERENTIATOR_DERIVATIVEREGISTRY_H
+#define CLAD_DIFFERENTIATOR_DERIVATIVEREGISTRY_H
+
+#include <cstring>
+#include <type_traits>
+
+// Builds which do not load the clad plugin can take the derivatives from a
+// library produced with -fderivative-library. The calls to clad::gradient and
+// friends then look up the precompiled derivative instead of having it
+// inserted by the plugin.
+#if defined(CLAD_DERIVATIVE_LIBRARY) && !defined(__CLAD__) &&                 \
+    !defined(__CUDA_ARCH__)
+#define CLAD_USE_DERIVATIVE_REGISTRY 1
+#endif
+
+namespace clad {
+namespace registry {
+/// The type-erased pointer to a function or to its derivative.
+using FnPtr = void (*)();
+
+/// A derivative compiled ahead of time, registered by the code generated with
+/// -fderivative-library.
+struct Entry {
+  /// The differentiated function.
+  FnPtr Function;
+  /// The mode of the request, as printed by DiffModeToString.
+  const char* Mode;
+  /// The options and the derivative order the interface was called with, see
+  /// GetBitmaskedOpts. They change the derivative and its type.
+  unsigned Opts;
+  /// The independent parameters as spelled in the request, or nullptr if they
+  /// were given by index.
+  const char* Args;
+  /// The index of the independent parameter if Args is nullptr.
+  int ArgIndex;
+  /// The derivative, to be cast back to the type of the derived function.
+  FnPtr Derivative;
+  /// The source code of the derivative, see CladFunction::dump.
+  const char* Code;
+  Entry* Next;
+};
+
+/// \returns the head of the list of registered entries. The list is built
+/// during static initialization and does not depend on the C++ runtime.
+inline Entry*& head() {
+  static Entry* Head = nullptr;
+  return Head;
+}
+
+/// Adds an entry to the registry when the derivative library is loaded.
+struct Registrar {
+  explicit Registrar(Entry& E) {
+    E.Next = head();
+    head() = &E;
+  }
+};
+
+inline bool matches(const Entry* E, FnPtr Fn, const char* Mode,
+                    unsigned Opts) {
+  return E->Function == Fn && !strcmp(E->Mode, Mode) && E->Opts == Opts;
+}
+
+inline const Entry* find(FnPtr Fn, const char* Mode, unsigned Opts,
+                         const char* Args) {
+  for (const Entry* E = head(); E; E = E->Next)
+    if (matches(E, Fn, Mode, Opts) && E->Args &&
+        !strcmp(E->Args, Args ? Args : ""))
+      return E;
+  return nullptr;
+}
+
+inline const Entry* find(FnPtr Fn, const char* Mode, unsigned Opts,
+                         int ArgIndex) {
+  for (const Entry* E = head(); E; E = E->Next)
+    if (matches(E, Fn, Mode, Opts) && !E->Args && E->ArgIndex == ArgIndex)
+      return E;
+  return nullptr;
+}
+
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value, const Entry*>::type
+find(FnPtr Fn, const char* Mode, unsigned Opts, T ArgIndex) {
+  return find(Fn, Mode, Opts, static_cast<int>(ArgIndex));
+}
+
+/// Requests with other kinds of independent parameters are not registered.
+template <typename T>
+typename std::enable_if<!std::is_integral<T>::value &&
+                            !std::is_convertible<T, const char*>::value,
+                        const Entry*>::type
+find(FnPtr, const char*, unsigned, const T&) {
+  return nullptr;
+}
+
+/// \returns the type-erased pointer to a free function, nullptr for anything
+/// else, e.g. member functions which are never registered.
+template <typename F>
+typename std::enable_if<
+    std::is_function<typename std::remove_pointer<F>::type>::value,
+    FnPtr>::type
+toFnPtr(F f) {
+  return reinterpret_cast<FnPtr>(f);
+}
+
+template <typename F>
+typename std::enable_if<
+    !std::is_function<typename std::remove_pointer<F>::type>::value,
+    FnPtr>::type
+toFnPtr(F) {
+  return nullptr;
+}
+
+/// Sets \p derivedFn and \p code to the precompiled derivative of \p f, if
+/// the derivative library has registered one for the request. Otherwise
+/// \p derivedFn stays null and the CladFunction is invalid.
+template <typename F, typename ArgSpec, typename DerivedFnType>
+void lookup(F f, const char* Mode, unsigned Opts, ArgSpec args,
+            DerivedFnType& derivedFn, const char*& code) {
+  if (derivedFn)
+    return;
+  FnPtr Fn = toFnPtr(f);
+  const Entry* E = Fn ? find(Fn, Mode, Opts, args) : nullptr;
+  if (!E)
+    return;
+  derivedFn = reinterpret_cast<DerivedFnType>(E->Derivative);
+  code = E->Code;
+}
+} // namespace registry
+} // namespace clad
+
+#endif // CLAD_DIFFERENTIATOR_DERIVATIVEREGISTRY_H
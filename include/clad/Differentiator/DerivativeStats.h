@@ -0,0 +1,49 @@
+#ifndef CLAD_DIFFERENTIATOR_DERIVATIVESTATS_H
+#define CLAD_DIFFERENTIATOR_DERIVATIVESTATS_H
+
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstddef>
+#include <string>
+
+namespace clang {
+class FunctionDecl;
+} // namespace clang
+
+namespace clad {
+struct DiffRequest;
+class DerivedFnCollector;
+
+/// Describes the code generated for one derivative and the cost of producing
+/// it, as reported by -stats.
+struct DerivativeStats {
+  /// The printed request the derivative was produced for.
+  std::string Request;
+  /// The name of the derivative.
+  std::string Name;
+  /// The number of statements in the body, expressions excluded.
+  unsigned NumStmts = 0;
+  /// The number of expressions in the body.
+  unsigned NumExprs = 0;
+  /// The number of clad::tape variables.
+  unsigned NumTapes = 0;
+  /// The number of calls to clad::push.
+  unsigned NumTapePushes = 0;
+  /// The number of calls to other derivatives, e.g. pullbacks.
+  unsigned NumDerivativeCalls = 0;
+  /// The number of stores skipped thanks to the TBR analysis.
+  unsigned NumTbrEliminatedStores = 0;
+  /// The wall time spent producing the derivative, in seconds.
+  double WallTime = 0;
+  /// The memory allocated in the ASTContext while producing the derivative.
+  std::size_t Memory = 0;
+
+  /// Collects the statistics of the generated derivative \p FD of \p request.
+  void collect(const DiffRequest& request, const clang::FunctionDecl* FD,
+               const DerivedFnCollector& DFC);
+
+  void print(llvm::raw_ostream& Out) const;
+};
+} // namespace clad
+
+#endif // CLAD_DIFFERENTIATOR_DERIVATIVESTATS_H
@@ -5,21 +5,23 @@
 
 #include "clang/AST/Decl.h"
 
-#include "llvm/ADT/DenseMap.h"
-#include "llvm/ADT/SmallSet.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SmallVector.h"
 
+#include <cstddef>
+#include <unordered_map>
+
 namespace clad {
 /// This class is designed to store collection of `DerivedFnInfo` objects.
 /// It's purpose is to avoid repeated generation of same derivatives by
 /// making it possible to reuse previously computed derivatives.
 class DerivedFnCollector {
-  using DerivedFns = llvm::SmallVector<DerivedFnInfo, 16>;
-  using DerivativeSet = llvm::SmallSet<const clang::FunctionDecl*, 16>;
-  /// Mapping to efficiently find out information about all the derivatives of
-  /// a function.
-  llvm::DenseMap<const clang::FunctionDecl*, DerivedFns>
-      m_DerivedFnInfoCollection;
+  using DerivedFns = llvm::SmallVector<DerivedFnInfo, 1>;
+  using DerivativeSet = llvm::DenseSet<const clang::FunctionDecl*>;
+  /// Mapping to efficiently find the derivatives satisfying a request. The
+  /// derivatives are bucketed by the hash of the function, the mode and the
+  /// independent variables, see DerivedFnInfo::Hash.
+  std::unordered_map<std::size_t, DerivedFns> m_DerivedFnInfoCollection;
   /// Set to keep track of all the functions that are derivatives
   /// functions produced by Clad.
   DerivativeSet m_DerivativeSet;
@@ -5,6 +5,9 @@
 #include "clad/Differentiator/DiffMode.h"
 #include "clad/Differentiator/ParseDiffArgsTypes.h"
 
+#include <cstddef>
+#include <vector>
+
 namespace clad {
 struct DiffRequest;
 
@@ -18,6 +21,11 @@ struct DerivedFnInfo {
   DiffInputVarsInfo m_DiffVarsInfo;
   std::vector<size_t> m_CUDAGlobalArgsIndexes;
   bool m_UsesEnzyme = false;
+  bool m_CompressedJacobian = false;
+  bool m_ParallelColumns = false;
+  bool m_ReverseJacobian = false;
+  bool m_AutoJacobian = false;
+  bool m_UseErrorAccumulator = false;
   bool m_DeclarationOnly = false;
 
   DerivedFnInfo() = default;
@@ -39,6 +47,13 @@ struct DerivedFnInfo {
   }
   bool DeclarationOnly() const { return m_DeclarationOnly; }
 
+  /// Returns the hash of the properties of the derivative that distinguish it
+  /// the most from the other derivatives: the function, the mode and the
+  /// independent variables. Equal for a request and the derivatives that
+  /// satisfy it.
+  std::size_t Hash() const;
+  static std::size_t Hash(const DiffRequest& request);
+
   /// Returns true if `lhs` and `rhs` represents same derivative.
   /// Here derivative is any function derived by clad.
   static bool RepresentsSameDerivative(const DerivedFnInfo& lhs,
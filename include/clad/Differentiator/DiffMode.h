@@ -12,6 +12,10 @@ enum class DiffMode {
   reverse,
   hessian,
   hessian_diagonal,
+  hessian_vector_product,
+  hessian_packed,
+  jvp,
+  vjp,
   jacobian,
   reverse_mode_forward_pass
 };
@@ -35,6 +39,14 @@ inline const char* DiffModeToString(DiffMode mode) {
     return "hessian";
   case DiffMode::hessian_diagonal:
     return "hessian_diagonal";
+  case DiffMode::hessian_vector_product:
+    return "hessian_vector_product";
+  case DiffMode::hessian_packed:
+    return "hessian_packed";
+  case DiffMode::jvp:
+    return "jvp";
+  case DiffMode::vjp:
+    return "vjp";
   case DiffMode::jacobian:
     return "jacobian";
   case DiffMode::reverse_mode_forward_pass:
@@ -14,6 +14,7 @@
 #include "clang/Analysis/AnalysisDeclContext.h"
 #include "clang/Basic/SourceLocation.h"
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Compiler.h"
@@ -25,6 +26,8 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <tuple>
+#include <vector>
 
 namespace clang {
 class CallExpr;
@@ -52,6 +55,11 @@ private:
     std::set<const clang::Stmt*> ToBeRecorded;
     ParamInfo m_ModifiedParams;
     ParamInfo m_UsedParams;
+    /// The parameters whose values the pullbacks of the callees read, see
+    /// EnableTBRSummaries.
+    ParamInfo m_NonLinearParams;
+    /// The stores the analysis allowed the derivative to skip.
+    std::set<const clang::Stmt*> NotRecorded;
     bool HasAnalysisRun = false;
   } m_TbrRunInfo;
 
@@ -76,6 +84,9 @@ public:
   unsigned CurrentDerivativeOrder = 1;
   /// Highest requested derivative order.
   unsigned RequestedDerivativeOrder = 1;
+  /// The options and the order the clad interface was instantiated with, see
+  /// GetBitmaskedOpts.
+  unsigned BitMaskedOpts = 0;
   /// Context in which the function is being called, or a call to
   /// clad::gradient/differentiate, where function is the first arg.
   clang::Expr* CallContext = nullptr;
@@ -92,6 +103,9 @@ public:
   bool VerboseDiags = false;
   /// A flag to enable TBR analysis during reverse-mode differentiation.
   bool EnableTBRAnalysis = false;
+  /// A flag to summarize the parameters the pullbacks of the callees read, so
+  /// that TBR analysis does not store arguments only used linearly.
+  bool EnableTBRSummaries = false;
   /// A flag to enable varied analysis during reverse-mode differentiation.
   bool EnableVariedAnalysis = false;
   /// A flag to enable useful analysis during reverse-mode differentiation.
@@ -105,6 +119,22 @@ public:
   /// A flag specifying whether this differentiation is to be used
   /// for error estimation.
   bool EnableErrorEstimation = false;
+  /// A flag specifying that the error estimates are recorded per variable
+  /// into a clad::error_accumulator, see opts::accumulate_errors.
+  bool UseErrorAccumulator = false;
+  /// A flag specifying that the jacobian is seeded with the matrices provided
+  /// by the caller instead of the identity, i.e. it computes the compressed
+  /// jacobian J * S used to recover sparse jacobians.
+  bool CompressedJacobian = false;
+  /// A flag specifying that the columns of the hessian are dispatched across
+  /// threads, each column writing a disjoint slice of the hessian matrix.
+  bool ParallelColumns = false;
+  /// A flag specifying that the jacobian is computed row by row with the
+  /// pullback of the function, see clad::reverse_jacobian.
+  bool ReverseJacobian = false;
+  /// A flag specifying that the jacobian picks the forward or the reverse mode
+  /// at runtime from the sizes of its parameters, see clad::auto_jacobian.
+  bool AutoJacobian = false;
   /// Puts the derived function and its code in the diff call
   void updateCall(clang::FunctionDecl* FD, clang::FunctionDecl* OverloadedFD,
                   clang::Sema& SemaRef);
@@ -181,9 +211,15 @@ public:
            RequestedDerivativeOrder == other.RequestedDerivativeOrder &&
            Args == other.Args && Mode == other.Mode &&
            EnableTBRAnalysis == other.EnableTBRAnalysis &&
+           EnableTBRSummaries == other.EnableTBRSummaries &&
            EnableVariedAnalysis == other.EnableVariedAnalysis &&
            EnableUsefulAnalysis == other.EnableUsefulAnalysis &&
            DVI == other.DVI && use_enzyme == other.use_enzyme &&
+           CompressedJacobian == other.CompressedJacobian &&
+           ParallelColumns == other.ParallelColumns &&
+           ReverseJacobian == other.ReverseJacobian &&
+           AutoJacobian == other.AutoJacobian &&
+           UseErrorAccumulator == other.UseErrorAccumulator &&
            DeclarationOnly == other.DeclarationOnly && Global == other.Global &&
            CUDAGlobalArgsIndexes == other.CUDAGlobalArgsIndexes;
   }
@@ -200,7 +236,11 @@ public:
   void print(llvm::raw_ostream& Out) const;
   LLVM_DUMP_METHOD void dump() const { print(llvm::errs()); }
 
+  /// \returns true if the derivative has to store the value overwritten by
+  /// \p S. A store skipped this way counts as eliminated by the TBR analysis.
   bool shouldBeRecorded(const clang::Stmt* S) const;
+  /// Like shouldBeRecorded, for queries which do not decide on a store.
+  bool isToBeRecorded(const clang::Stmt* S) const;
   bool shouldHaveAdjoint(const clang::Stmt* S) const;
   bool shouldHaveAdjoint(const clang::VarDecl* VD) const;
   bool shouldHaveAdjointForw(const clang::VarDecl* VD) const;
@@ -222,6 +262,13 @@ public:
                              const ParamSet& params) {
     m_TbrRunInfo.m_UsedParams[FD] = params;
   }
+  ParamInfo& getNonLinearParams() const {
+    return m_TbrRunInfo.m_NonLinearParams;
+  }
+  void addFunctionNonLinearParams(const clang::FunctionDecl* FD,
+                                  const ParamSet& params) {
+    m_TbrRunInfo.m_NonLinearParams[FD] = params;
+  }
   void addVariedDecl(const clang::VarDecl* init) {
     m_ActivityRunInfo.VariedDecls.insert(init);
   }
@@ -240,6 +287,70 @@ public:
     return m_UsefulRunInfo.UsefulDecls;
   }
   bool HasTbrAnalysisRun() const { return m_TbrRunInfo.HasAnalysisRun; }
+  unsigned getNumTbrEliminatedStores() const {
+    return m_TbrRunInfo.NotRecorded.size();
+  }
+};
+
+/// Owns the analysis contexts of the differentiated functions and memoizes
+/// the results of the analyses. A function needed as a pullback from many
+/// call sites, or in several modes, builds its CFG and runs each analysis
+/// once per set of inputs.
+class AnalysisManager {
+public:
+  enum class AnalysisKind { TBR, Varied, Useful };
+
+private:
+  /// Essentially needed for prolonging the lifetime of
+  /// unique_ptr<clang::AnalysisDeclContext>.
+  OwnedAnalysisContexts m_AllAnalysisDC;
+  llvm::DenseMap<const clang::FunctionDecl*, clang::AnalysisDeclContext*>
+      m_AnalysisDCs;
+
+  /// What an analysis adds to the request, see DiffRequest.
+  struct AnalysisResult {
+    /// The statements to be recorded or the varied statements.
+    std::set<const clang::Stmt*> Stmts;
+    /// The varied or the useful declarations.
+    std::set<const clang::VarDecl*> Decls;
+    ParamSet ModifiedParams;
+    ParamSet UsedParams;
+    ParamSet NonLinearParams;
+  };
+  /// The analyzed function, the varied declarations the analysis starts from
+  /// (empty for analyses which do not depend on them), the independent
+  /// parameters of the request, the analysis options of the request, see
+  /// getAnalysisOptions, and the kind of the analysis.
+  using AnalysisKey =
+      std::tuple<const clang::FunctionDecl*, std::vector<const clang::VarDecl*>,
+                 std::vector<bool>, unsigned, AnalysisKind>;
+  std::map<AnalysisKey, AnalysisResult> m_Results;
+  unsigned m_NumHits = 0;
+  unsigned m_NumMisses = 0;
+
+  /// \returns the key of the analysis of the function of the request.
+  static AnalysisKey getKey(const DiffRequest& request,
+                            std::vector<const clang::VarDecl*> Seeds,
+                            AnalysisKind Kind);
+  /// \returns the cached result for the key, or creates an empty one.
+  AnalysisResult& getResult(const AnalysisKey& Key, bool& Found);
+
+public:
+  /// \returns the analysis context of the function, created on first use.
+  clang::AnalysisDeclContext* getAnalysisDC(const clang::FunctionDecl* FD);
+
+  /// Runs the varied analysis of the function of the request unless it was
+  /// already run for the same varied parameters.
+  void runVariedAnalysis(DiffRequest& request);
+  /// Runs the useful analysis of the function of the request.
+  void runUsefulAnalysis(DiffRequest& request);
+  /// Runs the TBR analysis of the function of the request and records the
+  /// parameters it modifies and uses, and with EnableTBRSummaries the ones
+  /// its pullback reads.
+  void runTBRAnalysis(DiffRequest& request);
+
+  unsigned getNumHits() const { return m_NumHits; }
+  unsigned getNumMisses() const { return m_NumMisses; }
 };
 
   using DiffInterval = std::vector<clang::SourceRange>;
@@ -248,6 +359,7 @@ public:
     /// This is a flag to indicate the default behaviour to enable/disable
     /// TBR analysis during reverse-mode differentiation.
     bool EnableTBRAnalysis = false;
+    bool EnableTBRSummaries = false;
     bool EnableVariedAnalysis = false;
     bool EnableUsefulAnalysis = false;
   };
@@ -260,10 +372,9 @@ public:
     /// Graph to store the dependencies between different requests.
     ///
     clad::DynamicGraph<DiffRequest>& m_DiffRequestGraph;
-    /// Map that contains all AnalysisDeclContext for all declrations.
-    /// Essentially needed for prolonging the lifetime of
-    /// unique_ptr<clang::AnalysisDeclContext>.
-    OwnedAnalysisContexts& m_AllAnalysisDC;
+    /// Shares the analysis contexts and the results of the analyses across
+    /// requests.
+    AnalysisManager& m_AnalysisManager;
     /// If set it means that we need to find the called functions and
     /// add them for implicit diff.
     ///
@@ -281,7 +392,7 @@ public:
   public:
     DiffCollector(clang::DeclGroupRef DGR, DiffInterval& Interval,
                   clad::DynamicGraph<DiffRequest>& requestGraph, clang::Sema& S,
-                  RequestOptions& opts, OwnedAnalysisContexts& AllAnalysisDC);
+                  RequestOptions& opts, AnalysisManager& AM);
     bool VisitCallExpr(clang::CallExpr* E);
     bool VisitDeclRefExpr(clang::DeclRefExpr* DRE);
     bool VisitCXXConstructExpr(clang::CXXConstructExpr* e);
@@ -14,6 +14,9 @@
 #include "BuiltinDerivativesCUDA.cuh"
 #endif
 #include "CladConfig.h"
+#ifdef CLAD_DERIVATIVE_LIBRARY
+#include "DerivativeRegistry.h"
+#endif
 #include "FunctionTraits.h"
 #include "Matrix.h"
 #include "NumericalDiff.h"
@@ -34,6 +37,10 @@
 
 namespace clad {
 
+/// Defined in clad/Differentiator/ErrorAccumulator.h, which has to be included
+/// to use clad::opts::accumulate_errors.
+class error_accumulator;
+
 /// \returns the size of a c-style string
 inline CUDA_HOST_DEVICE unsigned int GetLength(const char* code) {
   const char* code_copy = code;
@@ -350,7 +357,7 @@ T& back(
                                   bool CUDAkernel = false)
       requires(!ImmediateMode)
         : m_Function(f), m_Functor(functor), m_CUDAkernel(CUDAkernel) {
-#ifndef __CLAD__
+#if !defined(__CLAD__) && !defined(CLAD_DERIVATIVE_LIBRARY)
       static_assert(false, "clad doesn't appear to be loaded; make sure that "
                            "you pass clad.so to clang.");
 #endif
@@ -369,7 +376,7 @@ T& back(
         : m_Function(f), m_Code("<constexpr functions don't have support for "
                                 "printing the derivative yet>"),
           m_Functor(functor), m_CUDAkernel(CUDAkernel) {
-#ifndef __CLAD__
+#if !defined(__CLAD__) && !defined(CLAD_DERIVATIVE_LIBRARY)
       static_assert(false, "clad doesn't appear to be loaded; make sure that "
                            "you pass clad.so to clang.");
 #endif
@@ -379,7 +386,7 @@ T& back(
                                   FunctorType* functor = nullptr,
                                   bool CUDAkernel = false)
         : m_Function(f), m_Functor(functor), m_CUDAkernel(CUDAkernel) {
-#ifndef __CLAD__
+#if !defined(__CLAD__) && !defined(CLAD_DERIVATIVE_LIBRARY)
       static_assert(false, "clad doesn't appear to be loaded; make sure that "
                            "you pass clad.so to clang.");
 #endif
@@ -597,6 +604,10 @@ T& back(
   differentiate(F fn, ArgSpec args = "",
                 DerivedFnType derivedFn = static_cast<DerivedFnType>(nullptr),
                 const char* code = "") {
+#ifdef CLAD_USE_DERIVATIVE_REGISTRY
+    registry::lookup(fn, "forward", GetBitmaskedOpts(BitMaskedOpts...), args,
+                     derivedFn, code);
+#endif
     return CladFunction<DerivedFnType, ExtractFunctorTraits_t<F>>(derivedFn,
                                                                   code);
   }
@@ -678,6 +689,10 @@ T& back(
   gradient(F f, ArgSpec args = "",
            DerivedFnType derivedFn = static_cast<DerivedFnType>(nullptr),
            const char* code = "", bool CUDAkernel = false) {
+#ifdef CLAD_USE_DERIVATIVE_REGISTRY
+    registry::lookup(f, "reverse", GetBitmaskedOpts(BitMaskedOpts...), args,
+                     derivedFn, code);
+#endif
     return CladFunction<DerivedFnType, ExtractFunctorTraits_t<F>, true>(
         derivedFn /* will be replaced by gradient*/, code, nullptr, CUDAkernel);
   }
@@ -714,14 +729,22 @@ T& back(
   }
 
   /// Generates function which computes hessian matrix of the given function wrt
-  /// the parameters specified in `args`.
+  /// the parameters specified in `args`. With `opts::sparse` the generated
+  /// function computes hessian-vector products instead, to be used with
+  /// clad::sparse_hessian, see clad::hessian_vector_product. With
+  /// `opts::parallel` the columns are evaluated concurrently, see
+  /// clad::parallel_columns. With `opts::packed` only the upper triangle is
+  /// computed, in packed format, see clad::packed_index.
   ///
   /// \param[in] fn function to differentiate
   /// \param[in] args independent parameters information
   /// \returns `CladFunction` object to access the corresponding derived
   /// function.
   template <unsigned... BitMaskedOpts, typename ArgSpec = const char*,
-            typename F, typename DerivedFnType = HessianDerivedFnTraits_t<F>,
+            typename F,
+            typename DerivedFnType = HessianDerivedFnTraitsWithOpts_t<
+                F, clad::HasOption(GetBitmaskedOpts(BitMaskedOpts...),
+                                   opts::sparse)>,
             typename = typename std::enable_if<
                 !clad::HasOption(GetBitmaskedOpts(BitMaskedOpts...),
                                  opts::immediate_mode) &&
@@ -731,12 +754,19 @@ T& back(
   hessian(F f, ArgSpec args = "",
           DerivedFnType derivedFn = static_cast<DerivedFnType>(nullptr),
           const char* code = "") {
+#ifdef CLAD_USE_DERIVATIVE_REGISTRY
+    registry::lookup(f, "hessian", GetBitmaskedOpts(BitMaskedOpts...), args,
+                     derivedFn, code);
+#endif
     return CladFunction<DerivedFnType, ExtractFunctorTraits_t<F>>(
         derivedFn /* will be replaced by hessian*/, code);
   }
 
   template <unsigned... BitMaskedOpts, typename ArgSpec = const char*,
-            typename F, typename DerivedFnType = HessianDerivedFnTraits_t<F>,
+            typename F,
+            typename DerivedFnType = HessianDerivedFnTraitsWithOpts_t<
+                F, clad::HasOption(GetBitmaskedOpts(BitMaskedOpts...),
+                                   opts::sparse)>,
             typename = typename std::enable_if<
                 clad::HasOption(GetBitmaskedOpts(BitMaskedOpts...),
                                 opts::immediate_mode) &&
@@ -765,8 +795,92 @@ T& back(
         derivedFn /* will be replaced by hessian*/, code, f);
   }
 
+  /// Generates function which computes the product of the hessian matrix of
+  /// the given function wrt the parameters specified in `args` with a
+  /// direction, without forming the hessian. The derived function takes the
+  /// direction as one extra argument per parameter, followed by the output:
+  /// f_hessian_vector_product(params..., _d_params..., hvp). The product is
+  /// accumulated into hvp, which is laid out as a row of the hessian. Only the
+  /// entries of the direction within `args` are used, so the product is the
+  /// block of the hessian wrt `args` times the restriction of the direction.
+  /// This is the derivative generated by clad::hessian<clad::opts::sparse>.
+  ///
+  /// \param[in] fn function to differentiate
+  /// \param[in] args independent parameters information
+  /// \returns `CladFunction` object to access the corresponding derived
+  /// function.
+  template <unsigned... BitMaskedOpts, typename ArgSpec = const char*,
+            typename F,
+            typename DerivedFnType =
+                HessianDerivedFnTraitsWithOpts_t<F, /*Sparse=*/true>,
+            typename = typename std::enable_if<
+                !std::is_class<remove_reference_and_pointer_t<F>>::value>::type>
+  constexpr CladFunction<
+      DerivedFnType, ExtractFunctorTraits_t<F>> __attribute__((annotate("V")))
+  hessian_vector_product(
+      F f, ArgSpec args = "",
+      DerivedFnType derivedFn = static_cast<DerivedFnType>(nullptr),
+      const char* code = "") {
+    return CladFunction<DerivedFnType, ExtractFunctorTraits_t<F>>(
+        derivedFn /* will be replaced by hessian-vector product*/, code);
+  }
+
+  /// Generates function which computes the product of the jacobian matrix of
+  /// the given function with a direction, without forming the jacobian:
+  /// f_jvp(params..., _d_params...). The directions of array parameters are
+  /// `clad::array_ref` buffers, which also receive the directional derivative
+  /// of output parameters. The product costs one pushforward of the function
+  /// and is always computed w.r.t. all the parameters.
+  ///
+  /// \param[in] fn function to differentiate
+  /// \param[in] args must be left unspecified
+  /// \returns `CladFunction` object to access the corresponding derived
+  /// function.
+  template <unsigned... BitMaskedOpts, typename ArgSpec = const char*,
+            typename F, typename DerivedFnType = JVPDerivedFnTraits_t<F>,
+            typename = typename std::enable_if<
+                !std::is_class<remove_reference_and_pointer_t<F>>::value>::type>
+  constexpr CladFunction<
+      DerivedFnType, ExtractFunctorTraits_t<F>> __attribute__((annotate("JVP")))
+  jvp(F f, ArgSpec args = "",
+      DerivedFnType derivedFn = static_cast<DerivedFnType>(nullptr),
+      const char* code = "") {
+    return CladFunction<DerivedFnType, ExtractFunctorTraits_t<F>>(
+        derivedFn /* will be replaced by jacobian-vector product*/, code);
+  }
+
+  /// Generates function which computes the product of a vector with the
+  /// jacobian matrix of the given function wrt the parameters specified in
+  /// `args`, without forming the jacobian: f_vjp(params..., _d_y,
+  /// _d_params...). The vector is given by the seed _d_y of the return value
+  /// and by the adjoints of the output parameters; the product is accumulated
+  /// into the adjoints of the requested parameters, the adjoints of the output
+  /// parameters are left unchanged. Adjoints of array parameters are
+  /// `clad::array_ref` buffers. The product costs one pullback of the function.
+  ///
+  /// \param[in] fn function to differentiate
+  /// \param[in] args independent parameters information
+  /// \returns `CladFunction` object to access the corresponding derived
+  /// function.
+  template <unsigned... BitMaskedOpts, typename ArgSpec = const char*,
+            typename F, typename DerivedFnType = VJPDerivedFnTraits_t<F>,
+            typename = typename std::enable_if<
+                !std::is_class<remove_reference_and_pointer_t<F>>::value>::type>
+  constexpr CladFunction<
+      DerivedFnType, ExtractFunctorTraits_t<F>> __attribute__((annotate("VJP")))
+  vjp(F f, ArgSpec args = "",
+      DerivedFnType derivedFn = static_cast<DerivedFnType>(nullptr),
+      const char* code = "") {
+    return CladFunction<DerivedFnType, ExtractFunctorTraits_t<F>>(
+        derivedFn /* will be replaced by vector-jacobian product*/, code);
+  }
+
   /// Generates function which computes jacobian matrix of the given function
   /// wrt the parameters specified in `args` using reverse mode differentiation.
+  /// With clad::opts::auto_mode the jacobian of a function writing to output
+  /// arrays is computed row by row with its pullback when it has fewer output
+  /// than independent variables; the choice is deferred to runtime if the
+  /// array sizes are not known at compile time.
   ///
   /// \param[in] fn function to differentiate
   /// \param[in] args independent parameters information
@@ -781,6 +895,10 @@ T& back(
   jacobian(F f, ArgSpec args = "",
            DerivedFnType derivedFn = static_cast<DerivedFnType>(nullptr),
            const char* code = "") {
+#ifdef CLAD_USE_DERIVATIVE_REGISTRY
+    registry::lookup(f, "jacobian", GetBitmaskedOpts(BitMaskedOpts...), args,
+                     derivedFn, code);
+#endif
     return CladFunction<DerivedFnType, ExtractFunctorTraits_t<F>,
                         /*EnablePadding=*/true>(
         derivedFn /* will be replaced by Jacobian*/, code);
@@ -803,8 +921,17 @@ T& back(
         derivedFn /* will be replaced by Jacobian*/, code, f);
   }
 
-  template <typename ArgSpec = const char*, typename F,
-            typename DerivedFnType = GradientDerivedEstFnTraits_t<F>>
+  /// Generates a function which estimates the floating-point error of the
+  /// given function. The error is summed into a trailing `double&` parameter,
+  /// or, with `opts::accumulate_errors`, recorded per variable into a trailing
+  /// clad::error_accumulator.
+  template <unsigned... BitMaskedOpts, typename ArgSpec = const char*,
+            typename F,
+            typename DerivedFnType = GradientDerivedEstFnTraits_t<
+                F, typename std::conditional<
+                       clad::HasOption(GetBitmaskedOpts(BitMaskedOpts...),
+                                       opts::accumulate_errors),
+                       error_accumulator, double>::type>>
   constexpr CladFunction<DerivedFnType> __attribute__((annotate("E")))
   estimate_error(F f, ArgSpec args = "",
                  DerivedFnType derivedFn = static_cast<DerivedFnType>(nullptr),
@@ -5,10 +5,9 @@
 #include <functional>
 #include <iostream>
 #include <queue>
-#include <set>
 #include <string>
 #include <unordered_map>
-#include <unordered_set>
+#include <utility>
 #include <vector>
 
 namespace clad {
@@ -18,18 +17,19 @@ private:
   /// a unique identifier for the node in the adjacency list.
   std::vector<T> m_nodes;
 
-  /// Store the nodes in the graph as an unordered map from the node to a
-  /// boolean indicating whether the node is processed or not. The second
-  /// element in the pair is the id of the node in the nodes vector.
-  std::unordered_map<T, std::pair<bool, size_t>> m_nodeMap;
+  /// Maps the hash of a node to the ids of the nodes with that hash. The nodes
+  /// themselves are only stored in m_nodes.
+  std::unordered_multimap<size_t, size_t> m_nodeIds;
 
-  /// Store the adjacency list for the graph. The adjacency list is a map from
-  /// a node to the set of nodes that it has an edge to. We use integers inside
-  /// the set to avoid copying the nodes.
-  std::unordered_map<size_t, std::set<size_t>> m_adjList;
+  /// Whether the node with a given id is processed.
+  std::vector<bool> m_processed;
 
-  /// Set of source nodes in the graph.
-  std::set<size_t> m_sources;
+  /// Whether the node with a given id is a source node.
+  std::vector<bool> m_isSource;
+
+  /// Store the adjacency list for the graph. The successors of the node with a
+  /// given id are kept sorted and unique.
+  std::vector<std::vector<size_t>> m_adjList;
 
   /// Store the id of the node being processed right now.
   int m_currentId = -1; // -1 means no node is being processed.
@@ -37,6 +37,15 @@ private:
   /// Maintain a queue of nodes to be processed next.
   std::queue<size_t> m_toProcessQueue;
 
+  /// \returns the id of the node or -1 if it is not in the graph.
+  int findNode(const T& node) const {
+    auto range = m_nodeIds.equal_range(std::hash<T>{}(node));
+    for (auto it = range.first; it != range.second; ++it)
+      if (m_nodes[it->second] == node)
+        return it->second;
+    return -1;
+  }
+
 public:
   DynamicGraph() = default;
 
@@ -44,11 +53,12 @@ public:
   /// \param src
   /// \param dest
   void addEdge(const T& src, const T& dest) {
-    std::pair<bool, size_t> srcInfo = addNode(src);
-    std::pair<bool, size_t> destInfo = addNode(dest);
-    size_t srcId = srcInfo.second;
-    size_t destId = destInfo.second;
-    m_adjList[srcId].insert(destId);
+    size_t srcId = addNode(src).second;
+    size_t destId = addNode(dest).second;
+    std::vector<size_t>& succs = m_adjList[srcId];
+    auto it = std::lower_bound(succs.begin(), succs.end(), destId);
+    if (it == succs.end() || *it != destId)
+      succs.insert(it, destId);
   }
 
   /// Add a node to the graph. If the node is already present, return the
@@ -59,17 +69,18 @@ public:
   /// \returns A pair of a boolean indicating whether the node is already
   /// processed and the id of the node in the graph.
   std::pair<bool, size_t> addNode(const T& node, bool isSource = false) {
-    if (m_nodeMap.find(node) == m_nodeMap.end()) {
-      size_t id = m_nodes.size();
-      m_nodes.push_back(node);
-      m_nodeMap[node] = {false, id}; // node is not processed yet.
-      m_adjList[id] = {};
-      if (isSource) {
-        m_sources.insert(id);
-        m_toProcessQueue.push(id);
-      }
-    }
-    return m_nodeMap[node];
+    int id = findNode(node);
+    if (id != -1)
+      return {m_processed[id], id};
+    size_t newId = m_nodes.size();
+    m_nodes.push_back(node);
+    m_nodeIds.emplace(std::hash<T>{}(node), newId);
+    m_processed.push_back(false); // node is not processed yet.
+    m_isSource.push_back(isSource);
+    m_adjList.emplace_back();
+    if (isSource)
+      m_toProcessQueue.push(newId);
+    return {false, newId};
   }
 
   /// Add an edge from the current node being processed to the
@@ -79,24 +90,28 @@ public:
   void addEdgeToCurrentNode(const T& dest, bool alreadyProcessed = false) {
     if (m_currentId != -1)
       addEdge(m_nodes[m_currentId], dest);
-    if (alreadyProcessed)
-      m_nodeMap[dest].first = true;
+    if (alreadyProcessed) {
+      int destId = findNode(dest);
+      if (destId != -1)
+        m_processed[destId] = true;
+    }
   }
 
   /// Set the current node being processed.
   /// \param node
   void setCurrentProcessingNode(const T& node) {
-    if (m_nodeMap.find(node) != m_nodeMap.end())
-      m_currentId = m_nodeMap[node].second;
+    int id = findNode(node);
+    if (id != -1)
+      m_currentId = id;
   }
 
   /// Mark the current node being processed as processed and add the
   /// destination nodes to the queue of nodes to be processed.
   void markCurrentNodeProcessed() {
     if (m_currentId != -1) {
-      m_nodeMap[m_nodes[m_currentId]].first = true;
+      m_processed[m_currentId] = true;
       for (size_t destId : m_adjList[m_currentId])
-        if (!m_nodeMap[m_nodes[destId]].first)
+        if (!m_processed[destId])
           m_toProcessQueue.push(destId);
     }
     m_currentId = -1;
@@ -108,7 +123,6 @@ public:
 
   /// Get the nodes in the graph.
   const std::vector<T>& getNodes() const { return m_nodes; }
-  std::vector<T>& getNodes() { return m_nodes; }
 
   /// Dump the nodes and edges.
   void dump() const { print(std::cerr); }
@@ -116,22 +130,46 @@ public:
   /// Print the nodes and edges in the graph.
   void print(std::ostream& Out) const {
     // First print the nodes with their insertion order.
-    for (const T& node : m_nodes) {
-      std::pair<bool, int> nodeInfo = m_nodeMap.at(node);
-      Out << (std::string)node << ": #" << nodeInfo.second;
-      if (m_sources.find(nodeInfo.second) != m_sources.end())
+    for (size_t i = 0; i < m_nodes.size(); i++) {
+      Out << (std::string)m_nodes[i] << ": #" << i;
+      if (m_isSource[i])
         Out << " (source)";
-      if (nodeInfo.first)
+      if (m_processed[i])
         Out << ", (done)\n";
       else
         Out << ", (unprocessed)\n";
     }
     // Then print the edges.
-    for (int i = 0; i < m_nodes.size(); i++)
-      for (size_t dest : m_adjList.at(i))
+    for (size_t i = 0; i < m_nodes.size(); i++)
+      for (size_t dest : m_adjList[i])
         Out << i << " -> " << dest << "\n";
   }
 
+  /// Print the graph in the DOT format of graphviz. Source nodes are drawn
+  /// with a double border and unprocessed nodes are dashed.
+  void printDOT(std::ostream& Out, const std::string& Name = "G") const {
+    Out << "digraph " << Name << " {\n";
+    for (size_t i = 0; i < m_nodes.size(); i++) {
+      std::string label = (std::string)m_nodes[i];
+      Out << "  n" << i << " [label=\"";
+      for (char c : label) {
+        if (c == '"' || c == '\\')
+          Out << '\\';
+        Out << c;
+      }
+      Out << "\"";
+      if (m_isSource[i])
+        Out << ", peripheries=2";
+      if (!m_processed[i])
+        Out << ", style=dashed";
+      Out << "];\n";
+    }
+    for (size_t i = 0; i < m_nodes.size(); i++)
+      for (size_t dest : m_adjList[i])
+        Out << "  n" << i << " -> n" << dest << ";\n";
+    Out << "}\n";
+  }
+
   /// Get the next node to be processed from the queue of nodes to be
   /// processed.
   /// \returns The next node to be processed.
@@ -0,0 +1,124 @@
+#ifndef CLAD_DIFFERENTIATOR_ERRORACCUMULATOR_H
+#define CLAD_DIFFERENTIATOR_ERRORACCUMULATOR_H
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+/// The number of variables an error accumulator tracks separately. Variables
+/// past the last slot share it.
+#ifndef CLAD_ERROR_ACCUMULATOR_SIZE
+#define CLAD_ERROR_ACCUMULATOR_SIZE 64
+#endif
+
+namespace clad {
+/// Collects the floating-point error estimates of the derivatives generated
+/// with clad::estimate_error<clad::opts::accumulate_errors>. Each variable the
+/// estimator tracks is given a compile-time index into a fixed-size array, so
+/// recording a contribution is one addition and nothing is allocated while the
+/// derivative runs. Each declaration has its own index, the names passed to
+/// set_names() only label them. The errors of successive calls add up until
+/// reset() is called, so a single accumulator can monitor many calls of a
+/// function.
+///
+/// Contributions inside loops can be sampled, see set_sampling_stride().
+class error_accumulator {
+public:
+  static constexpr std::size_t capacity = CLAD_ERROR_ACCUMULATOR_SIZE;
+
+private:
+  double m_Errors[capacity] = {};
+  std::size_t m_Counters[capacity] = {};
+  std::size_t m_Stride = 1;
+  /// The names of the slots separated by commas, set by the derivative.
+  const char* m_Names = "";
+
+  static constexpr std::size_t slot(std::size_t id) {
+    return id < capacity ? id : capacity - 1;
+  }
+
+public:
+  /// Records only one in \p stride contributions of each variable inside
+  /// loops, scaled by \p stride. The default, 1, records all of them.
+  void set_sampling_stride(std::size_t stride) {
+    m_Stride = stride ? stride : 1;
+  }
+  std::size_t sampling_stride() const { return m_Stride; }
+
+  /// Adds \p error to the estimate of the variable \p id.
+  void add(std::size_t id, double error) { m_Errors[slot(id)] += error; }
+
+  /// \returns true if the next contribution of the variable \p id inside a
+  /// loop is to be recorded with add_sample().
+  bool sample(std::size_t id) {
+    if (m_Stride == 1)
+      return true;
+    std::size_t& counter = m_Counters[slot(id)];
+    if (++counter < m_Stride)
+      return false;
+    counter = 0;
+    return true;
+  }
+
+  /// Adds a sampled contribution, standing for the skipped ones too.
+  void add_sample(std::size_t id, double error) {
+    m_Errors[slot(id)] += static_cast<double>(m_Stride) * error;
+  }
+
+  /// \returns the estimate of the variable \p id. Nested function calls
+  /// record their total error into such a slot.
+  double& at(std::size_t id) { return m_Errors[slot(id)]; }
+  double at(std::size_t id) const { return m_Errors[slot(id)]; }
+
+  void set_names(const char* names) { m_Names = names; }
+
+  /// \returns the number of variables tracked by the last derivative.
+  std::size_t size() const {
+    if (!*m_Names)
+      return 0;
+    std::size_t n = 1;
+    for (const char* c = m_Names; *c; ++c)
+      n += *c == ',';
+    return n < capacity ? n : capacity;
+  }
+
+  /// \returns the name of the variable \p id.
+  std::string name(std::size_t id) const {
+    const char* begin = m_Names;
+    for (std::size_t i = 0; i < id && begin; ++i) {
+      begin = std::strchr(begin, ',');
+      if (begin)
+        ++begin;
+    }
+    if (!begin)
+      return "";
+    const char* end = std::strchr(begin, ',');
+    return end ? std::string(begin, end) : std::string(begin);
+  }
+
+  /// \returns the sum of the estimates of all the variables.
+  double total() const {
+    double sum = 0;
+    for (double error : m_Errors)
+      sum += error;
+    return sum;
+  }
+
+  void reset() {
+    for (std::size_t i = 0; i < capacity; ++i) {
+      m_Errors[i] = 0;
+      m_Counters[i] = 0;
+    }
+  }
+
+  /// Prints the estimate of every variable and their sum.
+  void print(FILE* out = stdout) const {
+    for (std::size_t i = 0, e = size(); i < e; ++i)
+      fprintf(out, "%s: %.10g\n", name(i).c_str(), m_Errors[i]);
+    fprintf(out, "total: %.10g\n", total());
+  }
+};
+} // namespace clad
+
+#endif // CLAD_DIFFERENTIATOR_ERRORACCUMULATOR_H
@@ -6,6 +6,10 @@
 
 #include "clang/AST/OperationKinds.h"
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+
 #include <stack>
 #include <string>
 
@@ -58,6 +62,18 @@ class ErrorEstimationHandler : public ExternalRMVSource {
   /// A flag signaling if the current error comes from a function call.
   bool m_ErrorFromFunctionCall = false;
 
+  /// Whether the errors are recorded per variable into a
+  /// clad::error_accumulator instead of being summed into a double.
+  bool m_UseAccumulator = false;
+  /// The accumulator slots of the variables.
+  llvm::DenseMap<const clang::VarDecl*, unsigned> m_VarSlots;
+  /// The accumulator slots of the errors not attributed to a variable, e.g.
+  /// of the return expression, keyed by their names.
+  llvm::StringMap<unsigned> m_NamedSlots;
+  /// The names of the accumulator slots, indexed by the slot ids. Only used
+  /// to label the slots, see error_accumulator::set_names.
+  llvm::SmallVector<std::string, 16> m_SlotNames;
+
   std::stack<bool> m_ShouldEmit;
   ReverseModeVisitor* m_RMV = nullptr;
   llvm::SmallVectorImpl<clang::ParmVarDecl*>* m_Params = nullptr;
@@ -70,6 +86,22 @@ public:
   /// Builds a reference to the final error parameter of the function.
   clang::DeclRefExpr* BuildFinalErrorExpr();
 
+  /// \returns the id of the accumulator slot of the variable \p VD, or of
+  /// \p name if \p VD is null, which is assigned on first use.
+  unsigned GetSlot(const clang::VarDecl* VD, const std::string& name);
+
+  /// Builds the statement adding an error to the final error, either
+  /// `_final_error += errorExpr` or, with accumulators,
+  /// `_final_error.add(<id of name>, errorExpr)`. Inside loops the latter is
+  /// guarded by `_final_error.sample(<id of name>)`.
+  ///
+  /// \param[in] errorExpr The error expression of the variable.
+  /// \param[in] VD The variable the error is attributed to, if any.
+  /// \param[in] name Name of the variable the error is attributed to.
+  clang::Stmt* BuildAddErrorStmt(clang::Expr* errorExpr,
+                                 const clang::VarDecl* VD,
+                                 const std::string& name);
+
   /// Function to build the error statement corresponding
   /// to the function's return statement.
   void BuildReturnErrorStmt();
@@ -77,7 +109,8 @@ public:
   /// Function to emit error statements into the derivative body.
   ///
   /// \param[in] errorExpr The error expression (LHS) of the variable.
-  void AddErrorStmtToBlock(clang::Expr* errorExpr);
+  /// \param[in] VD The variable the error is attributed to.
+  void AddErrorStmtToBlock(clang::Expr* errorExpr, const clang::VarDecl* VD);
 
   /// Emit the error estimation related statements that were saved to be
   /// emitted at later points into specific blocks.
@@ -472,19 +472,21 @@ namespace clad {
   };
 
   /// This specific specialization is for error estimation calls.
-  template <class T, class = void> struct GradientDerivedEstFnTraits {};
+  template <class T, class ErrorT = double, class = void>
+  struct GradientDerivedEstFnTraits {};
 
   // GradientDerivedEstFnTraits is used to deduce type of the derived functions
-  // derived using reverse modes
-  template <class T>
+  // derived using reverse modes. ErrorT is the type the errors are reported
+  // in, double or clad::error_accumulator.
+  template <class T, class ErrorT = double>
   using GradientDerivedEstFnTraits_t = typename GradientDerivedEstFnTraits<
-      T>::type;
+      T, ErrorT>::type;
 
   // GradientDerivedEstFnTraits specializations for pure function pointer types
-  template <class ReturnType, class... Args>
-  struct GradientDerivedEstFnTraits<ReturnType (*)(Args...)> {
+  template <class ReturnType, class ErrorT, class... Args>
+  struct GradientDerivedEstFnTraits<ReturnType (*)(Args...), ErrorT> {
     using type = void (*)(Args..., OutputParamType_t<Args, Args>...,
-                          double&);
+                          ErrorT&);
   };
 
   /// These macro expansions are used to cover all possible cases of
@@ -497,10 +499,11 @@ namespace clad {
   /// qualifier only if it is supported and finally AddSPECS declares the
   /// function with all the cases
 #define GradientDerivedEstFnTraits_AddSPECS(var, cv, vol, ref, noex)           \
-  template <typename R, typename C, typename... Args>                          \
-  struct GradientDerivedEstFnTraits<R (C::*)(Args...) cv vol ref noex> {       \
+  template <typename R, typename C, typename ErrorT, typename... Args>         \
+  struct GradientDerivedEstFnTraits<R (C::*)(Args...) cv vol ref noex,         \
+                                    ErrorT> {                                  \
     using type = void (C::*)(Args..., OutputParamType_t<Args, Args>...,           \
-                             double&) cv vol ref noex;                         \
+                             ErrorT&) cv vol ref noex;                         \
   };
 
 #if __cpp_noexcept_function_type > 0
@@ -532,20 +535,23 @@ namespace clad {
   /// member typedef `type` same as the type of the derived function of the
   /// call operator, otherwise defines member typedef `type` as the type of
   /// `NoFunction*`.
-  template <class F>
+  template <class F, class ErrorT>
   struct GradientDerivedEstFnTraits<
-      F, typename std::enable_if<
-             std::is_class<remove_reference_and_pointer_t<F>>::value &&
-             has_call_operator<F>::value>::type> {
+      F, ErrorT,
+      typename std::enable_if<
+          std::is_class<remove_reference_and_pointer_t<F>>::value &&
+          has_call_operator<F>::value>::type> {
     using ClassType = typename std::decay<
         remove_reference_and_pointer_t<F>>::type;
-    using type = GradientDerivedEstFnTraits_t<decltype(&ClassType::operator())>;
+    using type =
+        GradientDerivedEstFnTraits_t<decltype(&ClassType::operator()), ErrorT>;
   };
-  template <class F>
+  template <class F, class ErrorT>
   struct GradientDerivedEstFnTraits<
-      F, typename std::enable_if<
-             std::is_class<remove_reference_and_pointer_t<F>>::value &&
-             !has_call_operator<F>::value>::type> {
+      F, ErrorT,
+      typename std::enable_if<
+          std::is_class<remove_reference_and_pointer_t<F>>::value &&
+          !has_call_operator<F>::value>::type> {
     using type = NoFunction*;
   };
 
@@ -718,6 +724,132 @@ namespace clad {
     using type = NoFunction*;
   };
 
+  template <class T, class = void>
+  struct HessianVectorProductDerivedFnTraits {};
+
+  // HessianVectorProductDerivedFnTraits is used to deduce type of the derived
+  // functions computing hessian-vector products. The direction has the same
+  // type as the parameters.
+  template <class T>
+  using HessianVectorProductDerivedFnTraits_t =
+      typename HessianVectorProductDerivedFnTraits<T>::type;
+
+  // HessianVectorProductDerivedFnTraits specializations for pure function
+  // pointer types
+  template <class ReturnType, class... Args>
+  struct HessianVectorProductDerivedFnTraits<ReturnType (*)(Args...)> {
+    using type = void (*)(Args..., Args..., ReturnType*);
+  };
+
+  /// These macro expansions are used to cover all possible cases of
+  /// qualifiers in member functions when declaring
+  /// HessianVectorProductDerivedFnTraits. They need to be read from bottom to
+  /// top, see HessianDerivedFnTraits.
+#define HessianVectorProductDerivedFnTraits_AddSPECS(var, cv, vol, ref, noex)  \
+  template <typename R, typename C, typename... Args>                          \
+  struct HessianVectorProductDerivedFnTraits<R (C::*)(Args...) cv vol ref      \
+                                                 noex> {                       \
+    using type = void (C::*)(Args..., Args..., R*) cv vol ref noex;            \
+  };
+
+#if __cpp_noexcept_function_type > 0
+#define HessianVectorProductDerivedFnTraits_AddNOEX(var, con, vol, ref)        \
+  HessianVectorProductDerivedFnTraits_AddSPECS(var, con, vol, ref, )           \
+      HessianVectorProductDerivedFnTraits_AddSPECS(var, con, vol, ref,         \
+                                                   noexcept)
+#else
+#define HessianVectorProductDerivedFnTraits_AddNOEX(var, con, vol, ref)        \
+  HessianVectorProductDerivedFnTraits_AddSPECS(var, con, vol, ref, )
+#endif
+
+#define HessianVectorProductDerivedFnTraits_AddREF(var, con, vol)              \
+  HessianVectorProductDerivedFnTraits_AddNOEX(var, con, vol, )                 \
+      HessianVectorProductDerivedFnTraits_AddNOEX(var, con, vol, &)            \
+          HessianVectorProductDerivedFnTraits_AddNOEX(var, con, vol, &&)
+
+#define HessianVectorProductDerivedFnTraits_AddVOL(var, con)                   \
+  HessianVectorProductDerivedFnTraits_AddREF(var, con, )                       \
+      HessianVectorProductDerivedFnTraits_AddREF(var, con, volatile)
+
+#define HessianVectorProductDerivedFnTraits_AddCON(var)                        \
+  HessianVectorProductDerivedFnTraits_AddVOL(var, )                            \
+      HessianVectorProductDerivedFnTraits_AddVOL(var, const)
+
+  HessianVectorProductDerivedFnTraits_AddCON(()); // Declares all the
+                                                  // specializations
+
+  /// Specialization for class types, see HessianDerivedFnTraits.
+  template <class F>
+  struct HessianVectorProductDerivedFnTraits<
+      F, typename std::enable_if<
+             std::is_class<remove_reference_and_pointer_t<F>>::value &&
+             has_call_operator<F>::value>::type> {
+    using ClassType = typename std::decay<
+        remove_reference_and_pointer_t<F>>::type;
+    using type = HessianVectorProductDerivedFnTraits_t<decltype(
+        &ClassType::operator())>;
+  };
+  template <class F>
+  struct HessianVectorProductDerivedFnTraits<
+      F, typename std::enable_if<
+             std::is_class<remove_reference_and_pointer_t<F>>::value &&
+             !has_call_operator<F>::value>::type> {
+    using type = NoFunction*;
+  };
+
+  /// Selects the hessian derived function type matching the options of
+  /// clad::hessian: with opts::sparse a hessian-vector product is derived.
+  template <class F, bool Sparse>
+  using HessianDerivedFnTraitsWithOpts_t =
+      typename std::conditional<Sparse,
+                                HessianVectorProductDerivedFnTraits<F>,
+                                HessianDerivedFnTraits<F>>::type::type;
+
+  /// Computes the type of the direction (jvp) or of the adjoint (vjp) of a
+  /// parameter of type T in matrix-free products. Arrays and pointers are
+  /// passed as clad::array_ref buffers.
+  template <class T, bool Adjoint> struct ProductParamType {
+    using value_type = typename std::remove_cv<
+        typename std::remove_reference<T>::type>::type;
+    using type =
+        typename std::conditional<Adjoint, value_type*, value_type>::type;
+  };
+  template <class T, bool Adjoint> struct ProductParamType<T*, Adjoint> {
+    using type = array_ref<typename std::remove_cv<T>::type>;
+  };
+
+  template <class T, bool Adjoint>
+  using ProductParamType_t = typename ProductParamType<T, Adjoint>::type;
+
+  template <class T> struct JVPDerivedFnTraits {};
+
+  // JVPDerivedFnTraits is used to deduce type of the derived functions
+  // computing jacobian-vector products, f_jvp(params..., _d_params...).
+  template <class T>
+  using JVPDerivedFnTraits_t = typename JVPDerivedFnTraits<T>::type;
+
+  template <class ReturnType, class... Args>
+  struct JVPDerivedFnTraits<ReturnType (*)(Args...)> {
+    using type = ReturnType (*)(Args..., ProductParamType_t<Args, false>...);
+  };
+
+  template <class T> struct VJPDerivedFnTraits {};
+
+  // VJPDerivedFnTraits is used to deduce type of the derived functions
+  // computing vector-jacobian products, f_vjp(params..., _d_y, _d_params...).
+  template <class T>
+  using VJPDerivedFnTraits_t = typename VJPDerivedFnTraits<T>::type;
+
+  template <class ReturnType, class... Args>
+  struct VJPDerivedFnTraits<ReturnType (*)(Args...)> {
+    using type = void (*)(Args...,
+                          typename ProductParamType<ReturnType, false>::type,
+                          ProductParamType_t<Args, true>...);
+  };
+  template <class... Args> struct VJPDerivedFnTraits<void (*)(Args...)> {
+    using type = void (*)(Args..., ProductParamType_t<Args, true>...);
+  };
+
   /// Compute type of derived function of function, method or functor when
   /// differentiated using forward differentiation mode
   /// (`clad::differentiate`). Computed type is provided as member typedef
@@ -33,6 +33,31 @@ namespace clad {
           size_t TotalIndependentArgsSize, const std::string& hessianFuncName,
           clang::DeclContext* FD, clang::QualType hessianFuncType);
 
+    /// Appends to stmts the declarations of the column and offset arrays and
+    /// the call to clad::parallel_columns which evaluates the columns of a
+    /// parallel hessian concurrently. The last of params is the output.
+    void BuildParallelColumnsDispatch(
+        llvm::ArrayRef<clang::FunctionDecl*> columns,
+        llvm::ArrayRef<size_t> IndependentArgsSize,
+        llvm::ArrayRef<clang::ParmVarDecl*> params,
+        std::vector<clang::Stmt*>& stmts);
+
+    /// Builds f_hessian_vector_product(params..., _d_params..., hvp) which
+    /// computes the product of the hessian with the direction _d_params by
+    /// calling the pullback of the pushforward of f once. Only the entries of
+    /// the direction within the requested parameters are used, the others are
+    /// taken as zero.
+    DerivativeAndOverload
+    DeriveHessianVectorProduct(const DiffParams& args,
+                               const IndexIntervalTable& indexIntervalTable,
+                               const std::string& hvpFuncName,
+                               clang::DeclContext* DC,
+                               clang::QualType hvpFuncType);
+
+    /// Derives the pullback of the pushforward of f w.r.t. the requested
+    /// parameters. Returns nullptr if the pushforward is not available.
+    clang::FunctionDecl* DerivePushforwardPullback(const DiffParams& args);
+
   public:
     HessianModeVisitor(DerivativeBuilder& builder, const DiffRequest& request);
     ~HessianModeVisitor() override = default;
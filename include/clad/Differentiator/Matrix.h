@@ -189,6 +189,12 @@ CUDA_HOST_DEVICE matrix<T> identity_matrix(size_t rows, size_t cols,
   return res;
 }
 
+// Function for creating a zero matrix of size rows x cols.
+template <typename T>
+CUDA_HOST_DEVICE matrix<T> zero_matrix(size_t rows, size_t cols) {
+  return matrix<T>(rows, cols);
+}
+
 /// Overloaded operator for clad::matrix which returns a new matrix.
 
 /// Adding constant to matrix.
@@ -5,11 +5,19 @@
 #include "ArrayRef.h"
 #include "FunctionTraits.h"
 #include "Tape.h"
+#ifdef CLAD_NUM_DIFF_THREADS
+#include "Parallel.h"
+#endif
 
+#include <algorithm>
 #include <cmath>
+#include <complex>
 #include <limits>
 #include <memory>
+#include <tuple>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace numerical_diff {
 
@@ -129,16 +137,19 @@ namespace numerical_diff {
   ///  belongs.
   /// \param[in] \c arrPos The position of the array element
   /// (-1 if parameter is scalar) to which the error belongs.
+  /// \param[in] \c method The scheme the derivative error belongs to.
   inline void printError(precision derivError, precision evalError,
-                         unsigned paramPos, int arrPos = -1) {
+                         unsigned paramPos, int arrPos = -1,
+                         const char* method =
+                             "the five-point central difference") {
     if (arrPos != -1)
       printf("\nError Report for parameter at position %d and index %d:\n",
              paramPos, arrPos);
     else
       printf("\nError Report for parameter at position %d:\n", paramPos);
-    printf("Error due to the five-point central difference is: %0.10f"
+    printf("Error due to %s is: %0.10f"
            "\nError due to function evaluation is: %0.10f\n",
-           derivError, evalError);
+           method, derivError, evalError);
   }
 
   /// A function to update scalar parameter values given a multiplier and the
@@ -243,8 +254,326 @@ namespace numerical_diff {
     return temp;
   }
 
+  /// The state of an argument of the function to differentiate while it is
+  /// evaluated at the points of the stencil. Scalars and user-defined types
+  /// are updated through updateIndexParamValue, which can be overloaded for
+  /// custom data types.
+  template <typename T, typename Enable = void> class perturbed_arg {
+    T m_Arg;
+
+  public:
+    /// True if the argument can be perturbed by several threads at once, each
+    /// with its own state. The overloads of updateIndexParamValue for
+    /// user-defined types may share buffers, see getBufferManager.
+    static constexpr bool thread_safe = std::is_arithmetic<T>::value;
+
+    perturbed_arg(T arg, std::size_t /*n*/) : m_Arg(arg) {}
+
+    /// \returns the argument, perturbed if \p idx is \p currIdx. See
+    /// updateIndexParamValue for the parameters.
+    T get(std::size_t idx, std::size_t currIdx, int multiplier,
+          precision& h_val, std::size_t n, std::size_t i) {
+      return updateIndexParamValue(m_Arg, idx, currIdx, multiplier, h_val, n,
+                                   i);
+    }
+
+    /// Undoes the perturbation after the function was evaluated. A no-op since
+    /// the argument is passed by value.
+    void restore(std::size_t /*idx*/, std::size_t /*currIdx*/,
+                 std::size_t /*i*/) {}
+  };
+
+  /// Arrays of arithmetic types are copied once into a scratch buffer whose
+  /// elements are perturbed and restored in place, instead of being copied
+  /// for every evaluation of the function. If the length of the array is not
+  /// known the caller's array is perturbed and restored directly.
+  template <typename T>
+  class perturbed_arg<T*, typename std::enable_if<
+                              std::is_arithmetic<T>::value>::type> {
+    using value_type = typename std::remove_cv<T>::type;
+    T* m_Arg;
+    std::vector<value_type> m_Scratch;
+    value_type m_Saved = 0;
+
+    value_type* data() {
+      // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+      return m_Scratch.empty() ? const_cast<value_type*>(m_Arg)
+                               : m_Scratch.data();
+    }
+
+  public:
+    static constexpr bool thread_safe = true;
+
+    perturbed_arg(T* arg, std::size_t n)
+        : m_Arg(arg), m_Scratch(arg, arg + n) {}
+
+    T* get(std::size_t idx, std::size_t currIdx, int multiplier,
+           precision& h_val, std::size_t /*n*/, std::size_t i) {
+      value_type* buf = data();
+      if (idx == currIdx) {
+        m_Saved = m_Arg[i];
+        h_val = (h_val == 0) ? get_h(m_Saved) : h_val;
+        buf[i] = m_Saved + h_val * multiplier;
+      }
+      return buf;
+    }
+
+    /// Restores the perturbed element. A function taking a non-const array
+    /// may also write to it, in which case the scratch buffer is copied
+    /// again. The check is linear in the length of the array, const arrays
+    /// skip it.
+    void restore(std::size_t idx, std::size_t currIdx, std::size_t i) {
+      value_type* buf = data();
+      if (idx == currIdx)
+        buf[i] = m_Saved;
+      if (!std::is_const<T>::value && !m_Scratch.empty() &&
+          !std::equal(m_Scratch.begin(), m_Scratch.end(), m_Arg))
+        std::copy(m_Arg, m_Arg + m_Scratch.size(), m_Scratch.begin());
+    }
+  };
+
+  /// The states of the arguments of the function to differentiate.
+  template <typename... Args>
+  using perturbed_args =
+      std::tuple<perturbed_arg<typename std::decay<Args>::type>...>;
+
+  constexpr bool all_of() { return true; }
+  template <typename... Bools> constexpr bool all_of(bool b, Bools... bs) {
+    return b && all_of(bs...);
+  }
+
+  /// Evaluates the function with the element \p i of the parameter at position
+  /// \p n perturbed by \p multiplier * h, and restores the arguments.
+  ///
+  /// \param[in] \c lens The lengths of the array parameters, 0 for scalars.
+  template <typename F, typename... PArgs, std::size_t... Ints>
+  precision evaluate_at(F& f, std::tuple<PArgs...>& state,
+                        const std::size_t* lens, std::size_t n,
+                        std::size_t i, int multiplier, precision& h,
+                        clad::IndexSequence<Ints...> /*idxSeq*/) {
+    precision res = f(std::get<Ints>(state).get(Ints, n, multiplier, h,
+                                                lens[Ints], i)...);
+    using expander = int[];
+    (void)expander{0, (std::get<Ints>(state).restore(Ints, n, i), 0)...};
+    return res;
+  }
+
+  /// Calculates the derivative with respect to the element \p i of the
+  /// parameter at position \p n with the five-point stencil formula.
+  ///
+  /// \param[in] \c arrPos The index reported with the error estimates, -1 if
+  /// the parameter is scalar.
+  template <typename F, typename State, std::size_t... Ints>
+  precision five_point_stencil(F& f, State& state, const std::size_t* lens,
+                               std::size_t n, std::size_t i, int arrPos,
+                               bool printErrors,
+                               clad::IndexSequence<Ints...> idxSeq) {
+    precision h = 0;
+    // calculate f[x+h, x-h]
+    // f(..., x+h,...)
+    precision xaf = evaluate_at(f, state, lens, n, i, /*multiplier=*/1, h,
+                                idxSeq);
+    precision xbf = evaluate_at(f, state, lens, n, i, /*multiplier=*/-1, h,
+                                idxSeq);
+    precision xf1 = (xaf - xbf) / (h + h);
+
+    // calculate f[x+2h, x-2h]
+    precision xaf2 = evaluate_at(f, state, lens, n, i, /*multiplier=*/2, h,
+                                 idxSeq);
+    precision xbf2 = evaluate_at(f, state, lens, n, i, /*multiplier=*/-2, h,
+                                 idxSeq);
+    precision xf2 = (xaf2 - xbf2) / (2 * h + 2 * h);
+
+    if (printErrors) {
+      // calculate f(x+3h) and f(x-3h)
+      precision xaf3 = evaluate_at(f, state, lens, n, i, /*multiplier=*/3, h,
+                                   idxSeq);
+      precision xbf3 = evaluate_at(f, state, lens, n, i, /*multiplier=*/-3, h,
+                                   idxSeq);
+      // Error in derivative due to the five-point stencil formula
+      // E(f'(x)) = f`````(x) * h^4 / 30 + O(h^5) (Taylor Approx) and
+      // f`````(x) = (f[x+3h, x-3h] - 4f[x+2h, x-2h] + 5f[x+h, x-h])/(2 * h^5)
+      // Formula courtesy of 'Abramowitz, Milton; Stegun, Irene A. (1970),
+      // Handbook of Mathematical Functions with Formulas, Graphs, and
+      // Mathematical Tables, Dover. Ninth printing. Table 25.2.`.
+      precision error = ((xaf3 - xbf3) - 4 * (xaf2 - xbf2) + 5 * (xaf - xbf)) /
+                        (60 * h);
+      // This is the error in evaluation of all the function values.
+      precision evalError = std::numeric_limits<precision>::epsilon() *
+                            (std::fabs(xaf2) + std::fabs(xbf2) +
+                             8 * (std::fabs(xaf) + std::fabs(xbf))) /
+                            (12 * h);
+      // Finally print the error to standard ouput.
+      printError(std::fabs(error), evalError, n, arrPos);
+    }
+
+    // five-point stencil formula = (4f[x+h, x-h] - f[x+2h, x-2h])/3
+    return 4.0 * xf1 / 3.0 - xf2 / 3.0;
+  }
+
+  /// The schemes numerical derivatives can be calculated with.
+  enum class scheme {
+    /// The five-point central difference with a fixed step.
+    five_point_stencil,
+    /// Ridders' extrapolation of central differences with decreasing steps.
+    ridders
+  };
+
+  /// The scheme requested through set_scheme.
+  inline scheme& requested_scheme() {
+    static scheme s = scheme::five_point_stencil;
+    return s;
+  }
+
+  /// Sets the scheme numerical derivatives are calculated with, the default
+  /// is the five-point stencil.
+  inline void set_scheme(scheme s) { requested_scheme() = s; }
+
+  /// \returns the step updateIndexParamValue chooses for the element \p i of
+  /// the parameter at position \p n, without evaluating the function.
+  template <typename... PArgs, std::size_t... Ints>
+  precision get_step(std::tuple<PArgs...>& state, const std::size_t* lens,
+                     std::size_t n, std::size_t i,
+                     clad::IndexSequence<Ints...> /*idxSeq*/) {
+    precision h = 0;
+    using expander = int[];
+    (void)expander{0, ((void)std::get<Ints>(state).get(Ints, n,
+                                                      /*multiplier=*/0, h,
+                                                      lens[Ints], i),
+                       std::get<Ints>(state).restore(Ints, n, i), 0)...};
+    return h;
+  }
+
+  /// Calculates the derivative with respect to the element \p i of the
+  /// parameter at position \p n with Ridders' method: central differences
+  /// with steps decreasing by a constant factor are extrapolated to a zero
+  /// step in a Neville tableau. Each level evaluates the function twice and
+  /// reuses the differences of all the previous levels. The extrapolation
+  /// stops once its error estimate grows again or falls below the rounding
+  /// error of the evaluations.
+  ///
+  /// \param[in,out] \c fx The value of the function at the unperturbed
+  /// arguments, evaluated once and shared by all the parameters. NaN if it
+  /// was not evaluated yet.
+  template <typename F, typename State, std::size_t... Ints>
+  precision ridders(F& f, State& state, const std::size_t* lens,
+                    std::size_t n, std::size_t i, int arrPos,
+                    bool printErrors, precision& fx,
+                    clad::IndexSequence<Ints...> idxSeq) {
+    // Steps shrink by con per level, the error of the extrapolation has to
+    // grow by safe to stop before the maximal number of levels.
+    constexpr int maxLevels = 10;
+    constexpr precision con = 1.4;
+    constexpr precision con2 = con * con;
+    constexpr precision safe = 2.0;
+    constexpr precision eps = std::numeric_limits<precision>::epsilon();
+
+    precision hh = get_step(state, lens, n, i, idxSeq);
+    if (std::isnan(fx)) {
+      precision h = hh;
+      fx = evaluate_at(f, state, lens, n, i, /*multiplier=*/0, h, idxSeq);
+    }
+    // The extrapolation needs a step over which the function changes
+    // noticeably, the step of the five-point stencil is tuned for a single
+    // difference.
+    hh *= 16;
+
+    precision a[maxLevels][maxLevels];
+    precision err = std::numeric_limits<precision>::max();
+    precision roundoff = 0;
+    precision dx = 0;
+    for (int l = 0; l < maxLevels; l++) {
+      if (l)
+        hh /= con;
+      precision h = hh;
+      precision xaf = evaluate_at(f, state, lens, n, i, /*multiplier=*/1, h,
+                                  idxSeq);
+      precision xbf = evaluate_at(f, state, lens, n, i, /*multiplier=*/-1, h,
+                                  idxSeq);
+      a[l][0] = (xaf - xbf) / (h + h);
+      roundoff = eps * std::fabs(fx) / h;
+      if (!l) {
+        dx = a[0][0];
+        continue;
+      }
+      precision fac = con2;
+      for (int k = 1; k <= l; k++) {
+        a[l][k] = (a[l][k - 1] * fac - a[l - 1][k - 1]) / (fac - 1);
+        fac *= con2;
+        precision errk = std::max(std::fabs(a[l][k] - a[l][k - 1]),
+                                  std::fabs(a[l][k] - a[l - 1][k - 1]));
+        if (errk <= err) {
+          err = errk;
+          dx = a[l][k];
+        }
+      }
+      if (std::fabs(a[l][l] - a[l - 1][l - 1]) >= safe * err ||
+          err <= roundoff)
+        break;
+    }
+
+    if (printErrors)
+      printError(err, roundoff, n, arrPos, "Ridders' extrapolation");
+    return dx;
+  }
+
+  /// Calculates the derivative with respect to the element \p i of the
+  /// parameter at position \p n with the scheme requested through set_scheme.
+  template <typename F, typename State, typename IdxSeq>
+  precision derivative_at(F& f, State& state, const std::size_t* lens,
+                          std::size_t n, std::size_t i, int arrPos,
+                          bool printErrors, precision& fx, IdxSeq idxSeq) {
+    if (requested_scheme() == scheme::ridders)
+      return ridders(f, state, lens, n, i, arrPos, printErrors, fx, idxSeq);
+    return five_point_stencil(f, state, lens, n, i, arrPos, printErrors,
+                              idxSeq);
+  }
+
+#ifdef CLAD_NUM_DIFF_THREADS
+  /// The number of threads requested through set_num_threads.
+  inline unsigned& requested_num_threads() {
+    static unsigned n = 1;
+    return n;
+  }
+
+  /// Sets the number of threads central_difference evaluates the entries of
+  /// gradients with, 0 selects clad::get_num_threads(). The default is a
+  /// single thread. The function to differentiate must then be safe to call
+  /// concurrently. Only available with -DCLAD_NUM_DIFF_THREADS, which pulls
+  /// in clad/Differentiator/Parallel.h.
+  inline void set_num_threads(unsigned n) { requested_num_threads() = n; }
+#endif
+
+  /// Calculates the entries [begin, end) of the gradient, numbering the
+  /// entries consecutively over all parameters.
+  template <typename F, typename RetType, std::size_t... Ints,
+            typename... Args>
+  void central_difference_entries(
+      F& f, clad::tape_impl<clad::array_ref<RetType>>& _grad,
+      bool printErrors, std::size_t begin, std::size_t end,
+      clad::IndexSequence<Ints...> idxSeq, Args&... args) {
+    std::size_t lens[] = {_grad[Ints].size()...};
+    perturbed_args<Args...> state(
+        perturbed_arg<typename std::decay<Args>::type>(args, lens[Ints])...);
+    precision fx = std::numeric_limits<precision>::quiet_NaN();
+    std::size_t entry = 0;
+    for (std::size_t i = 0; i < sizeof...(Args) && entry < end; i++) {
+      std::size_t argVecLen = lens[i];
+      for (std::size_t j = 0; j < argVecLen; j++, entry++) {
+        if (entry < begin || entry >= end)
+          continue;
+        _grad[i][j] = derivative_at(f, state, lens, i, j,
+                                    argVecLen > 1 ? (int)j : -1, printErrors,
+                                    fx, idxSeq);
+        getBufferManager().free_buffer();
+      }
+    }
+  }
+
   /// A helper function to calculate the numerical derivative of a target
-  /// function.
+  /// function. With -DCLAD_NUM_DIFF_THREADS the entries are distributed over
+  /// the threads requested with set_num_threads, unless errors are printed or
+  /// an argument is not perturbed_arg::thread_safe.
   ///
   /// \param[in] \c f The target function to numerically differentiate.
   /// \param[out] \c _grad The gradient array reference to which the gradients
@@ -260,70 +589,30 @@ namespace numerical_diff {
   void central_difference_helper(
       F f, clad::tape_impl<clad::array_ref<RetType>>& _grad, bool printErrors,
       clad::IndexSequence<Ints...> idxSeq, Args&&... args) {
-
-    std::size_t argLen = sizeof...(Args);
-    // loop over all the args, selecting each arg to get the derivative with
-    // respect to.
-    for (std::size_t i = 0; i < argLen; i++) {
-      precision h;
-      std::size_t argVecLen = _grad[i].size();
-      for (std::size_t j = 0; j < argVecLen; j++) {
-        // Reset h
-        h = 0;
-        // calculate f[x+h, x-h]
-        // f(..., x+h,...)
-        precision xaf = f(updateIndexParamValue(std::forward<Args>(args), Ints,
-                                                i, /*multiplier=*/1, h,
-                                                _grad[Ints].size(), j)...);
-        precision xbf = f(updateIndexParamValue(std::forward<Args>(args), Ints,
-                                                i, /*multiplier=*/-1, h,
-                                                _grad[Ints].size(), j)...);
-        precision xf1 = (xaf - xbf) / (h + h);
-
-        // calculate f[x+2h, x-2h]
-        precision xaf2 = f(updateIndexParamValue(std::forward<Args>(args), Ints,
-                                                 i,
-                                                 /*multiplier=*/2, h,
-                                                 _grad[Ints].size(), j)...);
-        precision xbf2 = f(updateIndexParamValue(std::forward<Args>(args), Ints,
-                                                 i,
-                                                 /*multiplier=*/-2, h,
-                                                 _grad[Ints].size(), j)...);
-        precision xf2 = (xaf2 - xbf2) / (2 * h + 2 * h);
-
-        if (printErrors) {
-          // calculate f(x+3h) and f(x-3h)
-          precision xaf3 = f(updateIndexParamValue(std::forward<Args>(args),
-                                                   Ints, i,
-                                                   /*multiplier=*/3, h,
-                                                   _grad[Ints].size(), j)...);
-          precision xbf3 = f(updateIndexParamValue(std::forward<Args>(args),
-                                                   Ints, i,
-                                                   /*multiplier=*/-3, h,
-                                                   _grad[Ints].size(), j)...);
-          // Error in derivative due to the five-point stencil formula
-          // E(f'(x)) = f`````(x) * h^4 / 30 + O(h^5) (Taylor Approx) and
-          // f`````(x) = (f[x+3h, x-3h] - 4f[x+2h, x-2h] + 5f[x+h, x-h])/(2 *
-          // h^5) Formula courtesy of 'Abramowitz, Milton; Stegun, Irene A.
-          // (1970), Handbook of Mathematical Functions with Formulas, Graphs,
-          // and Mathematical Tables, Dover. Ninth printing. Table 25.2.`.
-          precision error = ((xaf3 - xbf3) - 4 * (xaf2 - xbf2) +
-                             5 * (xaf - xbf)) /
-                            (60 * h);
-          // This is the error in evaluation of all the function values.
-          precision evalError = std::numeric_limits<precision>::epsilon() *
-                                (std::fabs(xaf2) + std::fabs(xbf2) +
-                                 8 * (std::fabs(xaf) + std::fabs(xbf))) /
-                                (12 * h);
-          // Finally print the error to standard ouput.
-          printError(std::fabs(error), evalError, i, argVecLen > 1 ? j : -1);
-        }
-
-        // five-point stencil formula = (4f[x+h, x-h] - f[x+2h, x-2h])/3
-        _grad[i][j] = 4.0 * xf1 / 3.0 - xf2 / 3.0;
-        getBufferManager().free_buffer();
-      }
+    std::size_t numEntries = 0;
+    for (std::size_t i = 0; i < sizeof...(Args); i++)
+      numEntries += _grad[i].size();
+#ifdef CLAD_NUM_DIFF_THREADS
+    std::size_t numThreads = requested_num_threads();
+    if (!numThreads)
+      numThreads = clad::get_num_threads();
+    numThreads = std::min(numThreads, numEntries);
+    constexpr bool threadSafe =
+        all_of(perturbed_arg<typename std::decay<Args>::type>::thread_safe...);
+    if (numThreads > 1 && !printErrors && threadSafe) {
+      // Each thread computes a contiguous block of entries with its own
+      // copies of the arrays.
+      clad::parallel_blocks(numThreads, [&](std::size_t t) {
+        central_difference_entries(f, _grad, /*printErrors=*/false,
+                                   t * numEntries / numThreads,
+                                   (t + 1) * numEntries / numThreads, idxSeq,
+                                   args...);
+      });
+      return;
     }
+#endif
+    central_difference_entries(f, _grad, printErrors, 0, numEntries, idxSeq,
+                               args...);
   }
 
   /// A helper function to calculate the numerical derivative of a target
@@ -343,59 +632,16 @@ namespace numerical_diff {
   void central_difference_helper(F f, RetType* _grad, bool printErrors,
                                  clad::IndexSequence<Ints...> idxSeq,
                                  Args&&... args) {
-
-    std::size_t argLen = sizeof...(Args);
+    std::size_t lens[sizeof...(Args)] = {};
+    perturbed_args<Args...> state(
+        perturbed_arg<typename std::decay<Args>::type>(args, 0)...);
+    precision fx = std::numeric_limits<precision>::quiet_NaN();
     // loop over all the args, selecting each arg to get the derivative with
     // respect to.
-    for (std::size_t i = 0; i < argLen; i++) {
-      precision h = 0;
-      // calculate f[x+h, x-h]
-      // f(..., x+h,...)
-      precision xaf = f(updateIndexParamValue(std::forward<Args>(args), Ints, i,
-                                              /*multiplier=*/1, h)...);
-      precision xbf = f(updateIndexParamValue(std::forward<Args>(args), Ints, i,
-                                              /*multiplier=*/-1, h)...);
-      precision xf1 = (xaf - xbf) / (h + h);
-
-      // calculate f[x+2h, x-2h]
-      precision xaf2 =
-          f(updateIndexParamValue(std::forward<Args>(args), Ints, i,
-                                  /*multiplier=*/2, h)...);
-      precision xbf2 =
-          f(updateIndexParamValue(std::forward<Args>(args), Ints, i,
-                                  /*multiplier=*/-2, h)...);
-      precision xf2 = (xaf2 - xbf2) / (2 * h + 2 * h);
-
-      if (printErrors) {
-        // calculate f(x+3h) and f(x-3h)
-        precision xaf3 =
-            f(updateIndexParamValue(std::forward<Args>(args), Ints, i,
-                                    /*multiplier=*/3, h)...);
-        precision xbf3 =
-            f(updateIndexParamValue(std::forward<Args>(args), Ints, i,
-                                    /*multiplier=*/-3, h)...);
-        // Error in derivative due to the five-point stencil formula
-        // E(f'(x)) = f`````(x) * h^4 / 30 + O(h^5) (Taylor Approx) and
-        // f`````(x) = (f[x+3h, x-3h] - 4f[x+2h, x-2h] + 5f[x+h, x-h])/(2 *
-        // h^5) Formula courtesy of 'Abramowitz, Milton; Stegun, Irene A.
-        // (1970), Handbook of Mathematical Functions with Formulas, Graphs,
-        // and Mathematical Tables, Dover. Ninth printing. Table 25.2.`.
-        precision error =
-            ((xaf3 - xbf3) - 4 * (xaf2 - xbf2) + 5 * (xaf - xbf)) / (60 * h);
-        // This is the error in evaluation of all the function values.
-        precision evalError = std::numeric_limits<precision>::epsilon() *
-                              (std::fabs(xaf2) + std::fabs(xbf2) +
-                               8 * (std::fabs(xaf) + std::fabs(xbf))) /
-                              (12 * h);
-        // Finally print the error to standard ouput.
-        printError(std::fabs(error), evalError, i);
-      }
-
-      // five-point stencil formula = (4f[x+h, x-h] - f[x+2h, x-2h])/3
-      _grad[i] = 4.0 * xf1 / 3.0 - xf2 / 3.0;
-    }
+    for (std::size_t i = 0; i < sizeof...(Args); i++)
+      _grad[i] = derivative_at(f, state, lens, i, /*i=*/0, /*arrPos=*/-1,
+                               printErrors, fx, idxSeq);
   }
-
   /// A function to calculate the derivative of a function using the central
   /// difference formula. Note: we do not propogate errors resulting in the
   /// following function, it is likely the errors are large enough to be of
@@ -417,6 +663,64 @@ namespace numerical_diff {
                                      std::forward<Args>(args)...);
   }
 
+  /// The step of the complex-step method. Since no difference is taken, the
+  /// step can be far below the rounding error of the arguments.
+  constexpr precision complex_step_h = 1e-20;
+
+  /// A helper function to calculate the derivative of a target function with
+  /// the complex-step method.
+  ///
+  /// \param[in] \c f The target function to numerically differentiate, taking
+  /// and returning std::complex<RetType>.
+  /// \param[out] \c _grad The gradient array to which the gradients will be
+  /// written.
+  /// \param[in] \c printErrors A flag to decide if we want to print numerical
+  /// diff errors estimates.
+  /// \param[in] \c idxSeq The index sequence associated with the input
+  /// parameter pack.
+  /// \param[in] \c args The arguments to the function to differentiate.
+  template <typename F, typename RetType, std::size_t... Ints,
+            typename... Args>
+  void complex_step_difference_helper(F f, RetType* _grad, bool printErrors,
+                                      clad::IndexSequence<Ints...> /*idxSeq*/,
+                                      Args&&... args) {
+    using complex = std::complex<RetType>;
+    for (std::size_t i = 0; i < sizeof...(Args); i++) {
+      complex res = f(complex(args, Ints == i ? complex_step_h : 0)...);
+      _grad[i] = std::imag(res) / complex_step_h;
+      // The truncation error h^2 * f'''(x) / 6 vanishes with h = 1e-20 and
+      // the evaluation is only affected by the rounding of the result.
+      if (printErrors)
+        printError(0, std::numeric_limits<precision>::epsilon() *
+                          std::fabs(_grad[i]),
+                   i, /*arrPos=*/-1, "the complex step");
+    }
+  }
+
+  /// A function to calculate the derivative of a function with respect to all
+  /// its scalar arguments with the complex-step method:
+  /// f'(x) = Im(f(x + ih)) / h. Unlike central differences, it needs a single
+  /// evaluation per argument and does not suffer from cancellation, so it is
+  /// accurate to machine precision without tuning the step.
+  /// \note The function has to be real-analytic and written only in terms of
+  /// operations which std::complex overloads analytically. Comparisons do not
+  /// compile and std::abs returns the modulus, which is not analytic.
+  ///
+  /// \param[in] \c f The target function to numerically differentiate, the
+  /// specialization of a function template for std::complex<RetType>.
+  /// \param[out] \c _grad The gradient array to which the gradients will be
+  /// written.
+  /// \param[in] \c printErrors A flag to decide if we want to print numerical
+  /// diff errors estimates.
+  /// \param[in] \c args The arguments to the function to differentiate.
+  template <typename F, typename RetType, typename... Args>
+  void complex_step_difference(F f, RetType* _grad, bool printErrors,
+                               Args&&... args) {
+    return complex_step_difference_helper(
+        f, _grad, printErrors, clad::MakeIndexSequence<sizeof...(Args)>{},
+        std::forward<Args>(args)...);
+  }
+
   /// A helper function to calculate ther derivative with respect to a
   /// single input.
   ///
@@ -438,52 +742,14 @@ namespace numerical_diff {
   precision forward_central_difference_helper(
       F f, T arg, std::size_t n, int arrIdx, std::size_t arrLen,
       bool printErrors, clad::IndexSequence<Ints...> idxSeq, Args&&... args) {
-
-    precision xaf, xbf, xaf2, xbf2, xf1, xf2, dx, h = 0;
-    // calculate f[x+h, x-h]
-    xaf = f(updateIndexParamValue(std::forward<Args>(args), Ints, n,
-                                  /*multiplier=*/1, h, arrLen, arrIdx)...);
-    xbf = f(updateIndexParamValue(std::forward<Args>(args), Ints, n,
-                                  /*multiplier=*/-1, h, arrLen, arrIdx)...);
-    xf1 = (xaf - xbf) / (h + h);
-
-    // calculate f[x+2h, x-2h]
-    xaf2 = f(updateIndexParamValue(std::forward<Args>(args), Ints, n,
-                                   /*multiplier=*/2, h, arrLen, arrIdx)...);
-    xbf2 = f(updateIndexParamValue(std::forward<Args>(args), Ints, n,
-                                   /*multiplier=*/-2, h, arrLen, arrIdx)...);
-    xf2 = (xaf2 - xbf2) / (2 * h + 2 * h);
-
-    if (printErrors) {
-      // calculate f(x+3h) and f(x-3h)
-      precision xaf3 = f(
-          updateIndexParamValue(std::forward<Args>(args), Ints, n,
-                                /*multiplier=*/3, h, arrLen, arrIdx)...);
-      precision xbf3 = f(
-          updateIndexParamValue(std::forward<Args>(args), Ints, n,
-                                /*multiplier=*/-3, h, arrLen, arrIdx)...);
-      // Error in derivative due to the five-point stencil formula
-      // E(f'(x)) = f`````(x) * h^4 / 30 + O(h^5) (Taylor Approx) and
-      // f`````(x) = (f[x+3h, x-3h] - 4f[x+2h, x-2h] + 5f[x+h, x-h])/(2 * h^5)
-      // Formula courtesy of 'Abramowitz, Milton; Stegun, Irene A. (1970),
-      // Handbook of Mathematical Functions with Formulas, Graphs, and
-      // Mathematical Tables, Dover. Ninth printing. Table 25.2.`.
-      precision error = ((xaf3 - xbf3) - 4 * (xaf2 - xbf2) + 5 * (xaf - xbf)) /
-                        (60 * h);
-      // This is the error in evaluation of all the function values.
-      precision evalError = std::numeric_limits<precision>::epsilon() *
-                            (std::fabs(xaf2) + std::fabs(xbf2) +
-                             8 * (std::fabs(xaf) + std::fabs(xbf))) /
-                            (12 * h);
-      // Finally print the error to standard ouput.
-      printError(std::fabs(error), evalError, n, arrIdx);
-    }
-
-    // five-point stencil formula = (4f[x+h, x-h] - f[x+2h, x-2h])/3
-    dx = 4.0 * xf1 / 3.0 - xf2 / 3.0;
-    return dx;
+    std::size_t lens[sizeof...(Args)];
+    std::fill_n(lens, sizeof...(Args), arrLen);
+    perturbed_args<Args...> state(
+        perturbed_arg<typename std::decay<Args>::type>(args, arrLen)...);
+    precision fx = std::numeric_limits<precision>::quiet_NaN();
+    return derivative_at(f, state, lens, n, static_cast<std::size_t>(arrIdx),
+                         arrIdx, printErrors, fx, idxSeq);
   }
-
   /// A function to calculate the derivative of a function using the central
   /// difference formula. Note: we do not propogate errors resulting in the
   /// following function, it is likely the errors are large enough to be of
@@ -0,0 +1,54 @@
+//--------------------------------------------------------------------*- C++ -*-
+// clad - the C++ Clang-based Automatic Differentiator
+//
+// Support for symmetric matrices stored in packed upper triangular (LAPACK
+// 'U') format, as produced by clad::hessian<clad::opts::packed>.
+//------------------------------------------------------------------------------
+
+#ifndef CLAD_DIFFERENTIATOR_PACKED_H
+#define CLAD_DIFFERENTIATOR_PACKED_H
+
+#include "clad/Differentiator/CladConfig.h"
+
+#include <cstddef>
+
+namespace clad {
+
+/// \returns the number of entries of the packed triangle of a n x n matrix.
+constexpr CUDA_HOST_DEVICE std::size_t packed_size(std::size_t n) {
+  return n * (n + 1) / 2;
+}
+
+/// \returns the position of the entry (i, j) of a symmetric matrix in packed
+/// upper (LAPACK 'U') format, i.e. the upper triangle stored column by column.
+/// The entries (i, j) and (j, i) share the same position.
+constexpr CUDA_HOST_DEVICE std::size_t packed_index(std::size_t i,
+                                                    std::size_t j) {
+  return i <= j ? i + j * (j + 1) / 2 : j + i * (i + 1) / 2;
+}
+
+/// Accumulates the entries row[i], ..., row[n - 1] of the row i of a
+/// symmetric n x n matrix into its packed upper triangle and clears row for
+/// the next one.
+template <typename T>
+CUDA_HOST_DEVICE void pack_upper_row(T* packed, T* row, std::size_t n,
+                                     std::size_t i) {
+  for (std::size_t j = i; j < n; ++j)
+    packed[packed_index(i, j)] += row[j];
+  for (std::size_t j = 0; j < n; ++j)
+    row[j] = 0;
+}
+
+/// Expands a symmetric n x n matrix in packed upper format into the dense
+/// row-major matrix dense.
+template <typename T>
+CUDA_HOST_DEVICE void unpack_symmetric(const T* packed, T* dense,
+                                       std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i)
+    for (std::size_t j = 0; j < n; ++j)
+      dense[i * n + j] = packed[packed_index(i, j)];
+}
+
+} // namespace clad
+
+#endif // CLAD_DIFFERENTIATOR_PACKED_H
@@ -0,0 +1,97 @@
+//--------------------------------------------------------------------*- C++ -*-
+// clad - the C++ Clang-based Automatic Differentiator
+//
+// Support for evaluating the independent columns of derivative matrices
+// concurrently.
+//------------------------------------------------------------------------------
+
+#ifndef CLAD_DIFFERENTIATOR_PARALLEL_H
+#define CLAD_DIFFERENTIATOR_PARALLEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#ifndef __CUDACC__
+#include <thread>
+#include <vector>
+#endif
+
+namespace clad {
+
+namespace detail {
+/// The number of threads requested through clad::set_num_threads, 0 selects
+/// the hardware concurrency.
+inline unsigned& requested_num_threads() {
+  static unsigned n = 0;
+  return n;
+}
+
+/// Calls the column i, which writes row i of the n x n matrix out. Row i is
+/// passed as one slice per requested parameter, starting at offsets[Is].
+template <typename Fn, std::size_t N, typename T, std::size_t K,
+          std::size_t... Is, typename... Args>
+void call_column(Fn (&columns)[N], std::size_t i, T* out,
+                 const std::size_t (&offsets)[K], std::index_sequence<Is...>,
+                 Args&... args) {
+  columns[i](args..., out + i * N + offsets[Is]...);
+}
+} // namespace detail
+
+/// Sets the number of threads used by parallel hessians, 0 restores the
+/// default of one thread per hardware thread.
+inline void set_num_threads(unsigned n) { detail::requested_num_threads() = n; }
+
+/// \returns the number of threads used by parallel hessians.
+inline unsigned get_num_threads() {
+  unsigned n = detail::requested_num_threads();
+#ifndef __CUDACC__
+  if (!n)
+    n = std::thread::hardware_concurrency();
+#endif
+  return n ? n : 1;
+}
+
+/// Calls \p block(t) for t = 0 ... numThreads - 1 concurrently, the calling
+/// thread computing block 0. Uses OpenMP when compiled with -fopenmp and
+/// std::thread otherwise. Under CUDA the blocks are called in sequence.
+template <typename Fn>
+void parallel_blocks(std::size_t numThreads, const Fn& block) {
+#if defined(_OPENMP)
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+  for (long t = 0; t < static_cast<long>(numThreads); ++t)
+    block(static_cast<std::size_t>(t));
+#elif !defined(__CUDACC__)
+  std::vector<std::thread> workers;
+  workers.reserve(numThreads - 1);
+  for (std::size_t t = 1; t < numThreads; ++t)
+    workers.emplace_back(block, t);
+  block(0);
+  for (std::thread& worker : workers)
+    worker.join();
+#else
+  for (std::size_t t = 0; t < numThreads; ++t)
+    block(t);
+#endif
+}
+
+/// Computes the N columns of a N x N derivative matrix concurrently, as
+/// generated by clad::hessian<clad::opts::parallel>. The column i is called
+/// as columns[i](args..., out + i * N + offsets[0], ...) and only writes row
+/// i of out, so the columns need no synchronization. Each thread computes a
+/// contiguous block of rows, see parallel_blocks.
+template <typename Fn, std::size_t N, typename T, std::size_t K,
+          typename... Args>
+void parallel_columns(Fn (&columns)[N], T* out,
+                      const std::size_t (&offsets)[K], Args&... args) {
+  using Indices = std::make_index_sequence<K>;
+  std::size_t numThreads = std::min<std::size_t>(get_num_threads(), N);
+  parallel_blocks(numThreads, [&](std::size_t t) {
+    for (std::size_t i = t * N / numThreads, e = (t + 1) * N / numThreads;
+         i < e; ++i)
+      detail::call_column(columns, i, out, offsets, Indices{}, args...);
+  });
+}
+
+} // namespace clad
+
+#endif // CLAD_DIFFERENTIATOR_PARALLEL_H
@@ -0,0 +1,222 @@
+//--------------------------------------------------------------------*- C++ -*-
+// clad - the C++ Clang-based Automatic Differentiator
+//
+// Support for computing jacobians row by row with the pullback of the
+// function, as generated by clad::jacobian<clad::opts::auto_mode>.
+//------------------------------------------------------------------------------
+
+#ifndef CLAD_DIFFERENTIATOR_REVERSEJACOBIAN_H
+#define CLAD_DIFFERENTIATOR_REVERSEJACOBIAN_H
+
+#include "clad/Differentiator/Array.h"
+#include "clad/Differentiator/ArrayRef.h"
+#include "clad/Differentiator/Matrix.h"
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace clad {
+
+/// \returns true if a jacobian with n independent and m output variables is
+/// cheaper to compute in reverse mode. The vector forward mode propagates
+/// n-wide vectors through a single evaluation, the reverse mode needs one
+/// pullback per output.
+constexpr bool prefer_reverse_jacobian(std::size_t n, std::size_t m) {
+  return m < n;
+}
+
+/// An independent array of a jacobian. Its adjoint forms the columns
+/// [offset, offset + size) of every row of the jacobian.
+template <typename T, typename U> struct jacobian_input_array {
+  T* value;
+  matrix<U>* derivative;
+  array<U> adjoint;
+
+  std::size_t num_inputs() const { return adjoint.size(); }
+  std::size_t num_outputs() const { return 0; }
+  std::tuple<T*> primals() const { return std::tuple<T*>(value); }
+  std::tuple<U*> adjoints() const { return std::tuple<U*>(adjoint.ptr()); }
+  std::tuple<matrix<U>*> derivatives() const {
+    return std::tuple<matrix<U>*>(derivative);
+  }
+  /// Seeds the derivative like the forward mode jacobian does.
+  void prepare(std::size_t n, std::size_t& offset) {
+    *derivative = identity_matrix<U>(adjoint.size(), n, offset);
+    offset += adjoint.size();
+  }
+  void seed(std::size_t, std::size_t&) {}
+  template <typename V> void store(array_ref<V>& row, std::size_t& col) {
+    for (std::size_t i = 0; i < adjoint.size(); ++i)
+      row[col++] = adjoint[i];
+  }
+  template <typename... Params>
+  void gather(std::size_t, std::size_t&, Params&...) {}
+  void clear() {
+    for (std::size_t i = 0; i < adjoint.size(); ++i)
+      adjoint[i] = 0;
+  }
+};
+
+/// An independent scalar of a jacobian, it forms one column of the jacobian.
+template <typename T> struct jacobian_input_scalar {
+  T value;
+  T adjoint = 0;
+
+  std::size_t num_inputs() const { return 1; }
+  std::size_t num_outputs() const { return 0; }
+  std::tuple<T> primals() const { return std::tuple<T>(value); }
+  std::tuple<T*> adjoints() { return std::tuple<T*>(&adjoint); }
+  std::tuple<> derivatives() const { return {}; }
+  void prepare(std::size_t, std::size_t& offset) { ++offset; }
+  void seed(std::size_t, std::size_t&) {}
+  template <typename V> void store(array_ref<V>& row, std::size_t& col) {
+    row[col++] = adjoint;
+  }
+  template <typename... Params>
+  void gather(std::size_t, std::size_t&, Params&...) {}
+  void clear() { adjoint = 0; }
+};
+
+/// An output array of a jacobian. Its entries form the rows of the jacobian,
+/// each of them is computed by one pullback seeded with the entry.
+template <typename T, typename U> struct jacobian_output_array {
+  T* value;
+  matrix<U>* derivative;
+  array<U> adjoint;
+
+  std::size_t num_inputs() const { return 0; }
+  std::size_t num_outputs() const { return adjoint.size(); }
+  std::tuple<T*> primals() const { return std::tuple<T*>(value); }
+  std::tuple<U*> adjoints() const { return std::tuple<U*>(adjoint.ptr()); }
+  std::tuple<matrix<U>*> derivatives() const {
+    return std::tuple<matrix<U>*>(derivative);
+  }
+  void prepare(std::size_t n, std::size_t&) {
+    *derivative = matrix<U>(adjoint.size(), n);
+  }
+  /// Seeds the entry k of all the outputs if it belongs to this array.
+  void seed(std::size_t k, std::size_t& offset) {
+    if (k >= offset && k - offset < adjoint.size())
+      adjoint[k - offset] = 1;
+    offset += adjoint.size();
+  }
+  template <typename V> void store(array_ref<V>&, std::size_t&) {}
+  /// Writes the adjoints of the inputs to the row of the entry k of all the
+  /// outputs if it belongs to this array.
+  template <typename... Params>
+  void gather(std::size_t k, std::size_t& offset, Params&... params) {
+    if (k >= offset && k - offset < adjoint.size()) {
+      array_ref<U> row = (*derivative)[k - offset];
+      std::size_t col = 0;
+      using expand = int[];
+      (void)expand{0, (params.store(row, col), 0)...};
+    }
+    offset += adjoint.size();
+  }
+  void clear() {
+    for (std::size_t i = 0; i < adjoint.size(); ++i)
+      adjoint[i] = 0;
+  }
+};
+
+/// A parameter the jacobian is not computed w.r.t.; Args is the derivative
+/// slot of the forward mode jacobian, if there is one.
+template <typename T, typename... Args> struct jacobian_constant_value {
+  T value;
+  std::tuple<Args...> derivative;
+
+  std::size_t num_inputs() const { return 0; }
+  std::size_t num_outputs() const { return 0; }
+  std::tuple<T> primals() const { return std::tuple<T>(value); }
+  std::tuple<> adjoints() const { return {}; }
+  std::tuple<Args...> derivatives() const { return derivative; }
+  void prepare(std::size_t, std::size_t&) {}
+  void seed(std::size_t, std::size_t&) {}
+  template <typename V> void store(array_ref<V>&, std::size_t&) {}
+  template <typename... Params>
+  void gather(std::size_t, std::size_t&, Params&...) {}
+  void clear() {}
+};
+
+template <typename T, typename U>
+jacobian_input_array<T, U> jacobian_input(T* value, matrix<U>* derivative) {
+  return {value, derivative, array<U>(derivative->rows())};
+}
+
+template <typename T> jacobian_input_scalar<T> jacobian_input(T value) {
+  return {value};
+}
+
+template <typename T, typename U>
+jacobian_output_array<T, U> jacobian_output(T* value, matrix<U>* derivative) {
+  return {value, derivative, array<U>(derivative->rows())};
+}
+
+template <typename T> jacobian_constant_value<T> jacobian_constant(T value) {
+  return {value, {}};
+}
+
+template <typename T, typename U>
+jacobian_constant_value<T*, matrix<U>*>
+jacobian_constant(T* value, matrix<U>* derivative) {
+  return {value, std::tuple<matrix<U>*>(derivative)};
+}
+
+namespace detail {
+template <typename Fn, typename Tuple, std::size_t... Is>
+void apply_jacobian(Fn& fn, Tuple& args, std::index_sequence<Is...>) {
+  fn(std::get<Is>(args)...);
+}
+} // namespace detail
+
+/// Computes the jacobian of a function one row at a time: each output entry
+/// seeds one call to the pullback, whose adjoints of the independent
+/// variables form the row. The parameters are described in the order of the
+/// function by clad::jacobian_input, clad::jacobian_output and
+/// clad::jacobian_constant.
+template <typename Pullback, typename... Params>
+void reverse_jacobian(Pullback pullback, Params&&... params) {
+  using expand = int[];
+  std::size_t n = 0;
+  std::size_t m = 0;
+  (void)expand{0, (n += params.num_inputs(), m += params.num_outputs(), 0)...};
+  std::size_t offset = 0;
+  (void)expand{0, (params.prepare(n, offset), 0)...};
+
+  auto args = std::tuple_cat(params.primals()..., params.adjoints()...);
+  using Indices =
+      std::make_index_sequence<std::tuple_size<decltype(args)>::value>;
+  for (std::size_t k = 0; k < m; ++k) {
+    (void)expand{0, (params.clear(), 0)...};
+    offset = 0;
+    (void)expand{0, (params.seed(k, offset), 0)...};
+    detail::apply_jacobian(pullback, args, Indices{});
+    offset = 0;
+    (void)expand{0, (params.gather(k, offset, params...), 0)...};
+  }
+}
+
+/// Computes the jacobian of a function with the forward mode jacobian or
+/// row by row with its pullback, whichever is cheaper for the sizes of the
+/// parameters, see clad::prefer_reverse_jacobian.
+template <typename Jacobian, typename Pullback, typename... Params>
+void auto_jacobian(Jacobian jacobian, Pullback pullback, Params&&... params) {
+  using expand = int[];
+  std::size_t n = 0;
+  std::size_t m = 0;
+  (void)expand{0, (n += params.num_inputs(), m += params.num_outputs(), 0)...};
+  if (prefer_reverse_jacobian(n, m)) {
+    reverse_jacobian(pullback, params...);
+    return;
+  }
+  auto args = std::tuple_cat(params.primals()..., params.derivatives()...);
+  using Indices =
+      std::make_index_sequence<std::tuple_size<decltype(args)>::value>;
+  detail::apply_jacobian(jacobian, args, Indices{});
+}
+
+} // namespace clad
+
+#endif // CLAD_DIFFERENTIATOR_REVERSEJACOBIAN_H
@@ -324,11 +324,27 @@ namespace clad {
                                    llvm::StringRef prefix = "_t",
                                    clang::QualType type = {});
 
+    /// Builds a reference to the specialization of the function template of
+    /// \p FD for std::complex, to differentiate it with the complex step.
+    /// The template must have a single floating point type parameter which
+    /// is the type of all the parameters, taken by value or by const
+    /// reference, and of the result. The body of the specialization is only
+    /// instantiated at the end of the translation unit, so a body that
+    /// std::complex does not support, e.g. one comparing its arguments, is
+    /// a hard error rather than a fallback to central differences.
+    ///
+    /// \returns The reference or nullptr if \p FD is not such a
+    /// specialization.
+    clang::Expr* BuildComplexStepCallee(const clang::FunctionDecl* FD);
+
     /// A function to get the multi-argument "central_difference"
-    /// call expression for the given arguments.
+    /// call expression for the given arguments. With -fnum-diff-complex-step,
+    /// "complex_step_difference" is called instead if the target function is
+    /// templated on its scalar type.
     /// The call is automatically inserted in PreCallStmts.
     ///
     /// \param[in] targetFuncCall The function to get the derivative for.
+    /// \param[in] targetFD The declaration of the target function.
     /// \param[in] retType The return type of the target call expression.
     /// \param[in] dfdx The dfdx corresponding to this call expression.
     /// \param[in] numArgs The total number of 'args'.
@@ -339,7 +355,8 @@ namespace clad {
     ///
     /// \returns The derivative function call.
     void GetMultiArgCentralDiffCall(
-        clang::Expr* targetFuncCall, clang::QualType retType, unsigned numArgs,
+        clang::Expr* targetFuncCall, const clang::FunctionDecl* targetFD,
+        clang::QualType retType, unsigned numArgs,
         clang::Expr* dfdx, llvm::SmallVectorImpl<clang::Stmt*>& PreCallStmts,
         llvm::SmallVectorImpl<clang::Expr*>& args,
         llvm::SmallVectorImpl<clang::Expr*>& outputArgs,
@@ -0,0 +1,437 @@
+//--------------------------------------------------------------------*- C++ -*-
+// clad - the C++ Clang-based Automatic Differentiator
+//
+// Support for sparse derivative matrices: sparsity patterns, graph coloring
+// and the recovery of sparse jacobians and hessians from compressed
+// evaluations.
+//------------------------------------------------------------------------------
+
+#ifndef CLAD_DIFFERENTIATOR_SPARSE_H
+#define CLAD_DIFFERENTIATOR_SPARSE_H
+
+#include "clad/Differentiator/Matrix.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace clad {
+
+/// The position of the nonzero entries of a rows x cols matrix in compressed
+/// sparse row (CSR) format. The column indices of row i are
+/// col_idx[row_ptr[i]] ... col_idx[row_ptr[i + 1] - 1], sorted ascending.
+struct sparsity_pattern {
+  std::size_t rows = 0;
+  std::size_t cols = 0;
+  std::vector<std::size_t> row_ptr;
+  std::vector<std::size_t> col_idx;
+
+  sparsity_pattern() = default;
+  sparsity_pattern(std::size_t rows, std::size_t cols)
+      : rows(rows), cols(cols), row_ptr(rows + 1, 0) {}
+
+  /// \returns the number of structural nonzeros.
+  std::size_t nnz() const { return col_idx.size(); }
+
+  /// \returns true if (i, j) is a structural nonzero.
+  bool contains(std::size_t i, std::size_t j) const {
+    auto begin = col_idx.begin() + row_ptr[i];
+    auto end = col_idx.begin() + row_ptr[i + 1];
+    return std::binary_search(begin, end, j);
+  }
+
+  /// Builds a pattern from a list of (row, col) pairs, duplicates are merged.
+  static sparsity_pattern
+  from_coordinates(std::size_t rows, std::size_t cols,
+                   const std::vector<std::size_t>& row_ind,
+                   const std::vector<std::size_t>& col_ind) {
+    assert(row_ind.size() == col_ind.size() && "mismatching coordinates");
+    std::vector<std::vector<std::size_t>> entries(rows);
+    for (std::size_t k = 0; k < row_ind.size(); ++k) {
+      assert(row_ind[k] < rows && col_ind[k] < cols && "out of bounds");
+      entries[row_ind[k]].push_back(col_ind[k]);
+    }
+    sparsity_pattern P(rows, cols);
+    for (std::size_t i = 0; i < rows; ++i) {
+      std::vector<std::size_t>& row = entries[i];
+      std::sort(row.begin(), row.end());
+      row.erase(std::unique(row.begin(), row.end()), row.end());
+      P.col_idx.insert(P.col_idx.end(), row.begin(), row.end());
+      P.row_ptr[i + 1] = P.col_idx.size();
+    }
+    return P;
+  }
+
+  /// \returns the pattern of the transposed matrix.
+  sparsity_pattern transpose() const {
+    sparsity_pattern T(cols, rows);
+    T.col_idx.resize(nnz());
+    for (std::size_t k = 0; k < nnz(); ++k)
+      ++T.row_ptr[col_idx[k] + 1];
+    for (std::size_t j = 0; j < cols; ++j)
+      T.row_ptr[j + 1] += T.row_ptr[j];
+    std::vector<std::size_t> next(T.row_ptr.begin(), T.row_ptr.end() - 1);
+    for (std::size_t i = 0; i < rows; ++i)
+      for (std::size_t k = row_ptr[i]; k < row_ptr[i + 1]; ++k)
+        T.col_idx[next[col_idx[k]]++] = i;
+    return T;
+  }
+};
+
+/// A sparse matrix in compressed sparse row format.
+template <typename T> struct csr_matrix {
+  sparsity_pattern pattern;
+  /// The value of every structural nonzero, in the order of pattern.col_idx.
+  std::vector<T> values;
+
+  csr_matrix() = default;
+  explicit csr_matrix(const sparsity_pattern& P)
+      : pattern(P), values(P.nnz(), T()) {}
+
+  std::size_t rows() const { return pattern.rows; }
+  std::size_t cols() const { return pattern.cols; }
+  std::size_t nnz() const { return pattern.nnz(); }
+  const std::vector<std::size_t>& row_ptr() const { return pattern.row_ptr; }
+  const std::vector<std::size_t>& col_idx() const { return pattern.col_idx; }
+
+  /// \returns the entry (i, j), zero if it is not a structural nonzero.
+  T operator()(std::size_t i, std::size_t j) const {
+    auto begin = pattern.col_idx.begin() + pattern.row_ptr[i];
+    auto end = pattern.col_idx.begin() + pattern.row_ptr[i + 1];
+    auto it = std::lower_bound(begin, end, j);
+    if (it == end || *it != j)
+      return T();
+    return values[it - pattern.col_idx.begin()];
+  }
+};
+
+/// A sparse matrix in coordinate (COO) format, entries are ordered by row and
+/// then by column.
+template <typename T> struct coo_matrix {
+  std::size_t rows = 0;
+  std::size_t cols = 0;
+  std::vector<std::size_t> row_ind;
+  std::vector<std::size_t> col_ind;
+  std::vector<T> values;
+
+  std::size_t nnz() const { return values.size(); }
+};
+
+/// \returns \p A in coordinate format.
+template <typename T> coo_matrix<T> to_coo(const csr_matrix<T>& A) {
+  coo_matrix<T> C;
+  C.rows = A.rows();
+  C.cols = A.cols();
+  C.row_ind.reserve(A.nnz());
+  for (std::size_t i = 0; i < A.rows(); ++i)
+    C.row_ind.insert(C.row_ind.end(), A.row_ptr()[i + 1] - A.row_ptr()[i], i);
+  C.col_ind = A.col_idx();
+  C.values = A.values;
+  return C;
+}
+
+/// The result of a graph coloring: colors[j] is the color of column (or row)
+/// j, colors are numbered 0 ... num_colors - 1.
+struct coloring {
+  std::vector<std::size_t> colors;
+  std::size_t num_colors = 0;
+};
+
+/// Greedy distance-2 coloring of the column vertices of the bipartite graph of
+/// \p P, i.e. columns sharing a nonzero row never get the same color.
+/// Columns are visited in decreasing order of their number of nonzeros
+/// ("largest first"), which usually lowers the number of colors.
+inline coloring color_columns(const sparsity_pattern& P) {
+  sparsity_pattern PT = P.transpose();
+  std::vector<std::size_t> order(P.cols);
+  for (std::size_t j = 0; j < P.cols; ++j)
+    order[j] = j;
+  std::stable_sort(order.begin(), order.end(),
+                   [&PT](std::size_t a, std::size_t b) {
+                     return PT.row_ptr[a + 1] - PT.row_ptr[a] >
+                            PT.row_ptr[b + 1] - PT.row_ptr[b];
+                   });
+
+  constexpr std::size_t uncolored = static_cast<std::size_t>(-1);
+  coloring C;
+  C.colors.assign(P.cols, uncolored);
+  // forbidden[c] == j + 1 means color c is used by a neighbor of column j.
+  std::vector<std::size_t> forbidden;
+  for (std::size_t j : order) {
+    for (std::size_t k = PT.row_ptr[j]; k < PT.row_ptr[j + 1]; ++k) {
+      std::size_t i = PT.col_idx[k];
+      for (std::size_t l = P.row_ptr[i]; l < P.row_ptr[i + 1]; ++l) {
+        std::size_t c = C.colors[P.col_idx[l]];
+        if (c != uncolored)
+          forbidden[c] = j + 1;
+      }
+    }
+    std::size_t c = 0;
+    while (c < forbidden.size() && forbidden[c] == j + 1)
+      ++c;
+    if (c == forbidden.size())
+      forbidden.push_back(0);
+    C.colors[j] = c;
+    C.num_colors = std::max(C.num_colors, c + 1);
+  }
+  return C;
+}
+
+/// Builds the cols x num_colors seed matrix S of a column coloring, such that
+/// J * S sums up the columns of every color.
+template <typename T> matrix<T> seed_matrix(const coloring& C) {
+  matrix<T> S(C.colors.size(), C.num_colors);
+  for (std::size_t j = 0; j < C.colors.size(); ++j)
+    S(j, C.colors[j]) = 1;
+  return S;
+}
+
+/// Recovers the sparse jacobian from the compressed jacobian B = J * S
+/// evaluated with the seed matrix of the column coloring \p C of \p P.
+template <typename T>
+csr_matrix<T> recover_jacobian(const sparsity_pattern& P, const coloring& C,
+                               const matrix<T>& B) {
+  assert(B.rows() == P.rows && B.cols() == C.num_colors &&
+         "compressed jacobian does not match the coloring");
+  csr_matrix<T> J(P);
+  for (std::size_t i = 0; i < P.rows; ++i)
+    for (std::size_t k = P.row_ptr[i]; k < P.row_ptr[i + 1]; ++k)
+      J.values[k] = B(i, C.colors[P.col_idx[k]]);
+  return J;
+}
+
+namespace sparse_detail {
+/// Fills the n elements of \p x with the probe point \p probe around \p x0.
+/// Probe 0 is \p x0 itself, the others move every coordinate by a
+/// deterministic pseudo-random amount of up to half its magnitude (at least
+/// 0.5), so that they do not share the special values of \p x0.
+template <typename T>
+void probe_point(const T* x0, T* x, std::size_t n, std::size_t probe) {
+  std::uint32_t state = 2166136261U ^ static_cast<std::uint32_t>(probe);
+  for (std::size_t j = 0; j < n; ++j) {
+    x[j] = x0[j];
+    if (probe == 0)
+      continue;
+    state = state * 1664525U + 1013904223U;
+    T u = static_cast<T>(state >> 8) / static_cast<T>(1U << 24) - T(0.5);
+    T scale = x0[j] < T(0) ? -x0[j] : x0[j];
+    x[j] += u * (scale < T(1) ? T(1) : scale);
+  }
+}
+} // namespace sparse_detail
+
+/// Detects the sparsity pattern of a rows x cols jacobian by a single
+/// propagation of all the cols directions at each probe point.
+/// \p compressed(x, S, B) must compute B = J(x) * S for a cols x p seed
+/// matrix S at the point x of the cols independent variables, typically by
+/// calling a derivative generated with clad::jacobian<clad::opts::sparse>.
+///
+/// The pattern is numerical: it is the union of the nonzeros found at \p x0
+/// and at \p num_probes - 1 perturbations of it. It only holds for these
+/// points, an entry which vanishes at all of them is dropped.
+template <typename T, typename Fn>
+sparsity_pattern detect_jacobian_sparsity(std::size_t rows, std::size_t cols,
+                                          const T* x0, Fn&& compressed,
+                                          std::size_t num_probes = 3) {
+  matrix<T> S = identity_matrix<T>(cols, cols);
+  matrix<T> B(rows, cols);
+  std::vector<T> x(cols);
+  std::vector<char> nonzero(rows * cols, 0);
+  for (std::size_t probe = 0; probe < num_probes; ++probe) {
+    sparse_detail::probe_point(x0, x.data(), cols, probe);
+    for (std::size_t i = 0; i < rows; ++i)
+      for (std::size_t j = 0; j < cols; ++j)
+        B(i, j) = 0;
+    compressed(x.data(), S, B);
+    for (std::size_t i = 0; i < rows; ++i)
+      for (std::size_t j = 0; j < cols; ++j)
+        if (B(i, j) != T(0))
+          nonzero[i * cols + j] = 1;
+  }
+  sparsity_pattern P(rows, cols);
+  for (std::size_t i = 0; i < rows; ++i) {
+    for (std::size_t j = 0; j < cols; ++j)
+      if (nonzero[i * cols + j])
+        P.col_idx.push_back(j);
+    P.row_ptr[i + 1] = P.col_idx.size();
+  }
+  return P;
+}
+
+/// Computes the jacobian with the known sparsity pattern \p P using one
+/// compressed sweep per color of its column coloring. \p compressed(S, B) must
+/// compute B = J * S at the point of interest, see detect_jacobian_sparsity.
+template <typename T, typename Fn>
+csr_matrix<T> sparse_jacobian(const sparsity_pattern& P, const coloring& C,
+                              Fn&& compressed) {
+  matrix<T> S = seed_matrix<T>(C);
+  matrix<T> B(P.rows, C.num_colors);
+  compressed(S, B);
+  return recover_jacobian(P, C, B);
+}
+
+template <typename T, typename Fn>
+csr_matrix<T> sparse_jacobian(const sparsity_pattern& P, Fn&& compressed) {
+  return sparse_jacobian<T>(P, color_columns(P), compressed);
+}
+
+/// Greedy star coloring of the adjacency graph of the symmetric pattern \p P,
+/// i.e. adjacent vertices get different colors and every path on four
+/// vertices uses at least three colors. This allows the direct recovery of a
+/// symmetric matrix from one product per color, see recover_hessian.
+/// Vertices are visited in decreasing order of their degree.
+inline coloring color_symmetric(const sparsity_pattern& P) {
+  assert(P.rows == P.cols && "symmetric patterns must be square");
+  const std::size_t n = P.rows;
+  std::vector<std::size_t> order(n);
+  for (std::size_t v = 0; v < n; ++v)
+    order[v] = v;
+  std::stable_sort(order.begin(), order.end(),
+                   [&P](std::size_t a, std::size_t b) {
+                     return P.row_ptr[a + 1] - P.row_ptr[a] >
+                            P.row_ptr[b + 1] - P.row_ptr[b];
+                   });
+
+  constexpr std::size_t uncolored = static_cast<std::size_t>(-1);
+  coloring C;
+  C.colors.assign(n, uncolored);
+  // forbidden[c] == v + 1 means color c cannot be used for vertex v.
+  std::vector<std::size_t> forbidden;
+  for (std::size_t v : order) {
+    for (std::size_t k = P.row_ptr[v]; k < P.row_ptr[v + 1]; ++k) {
+      std::size_t w = P.col_idx[k];
+      if (w == v)
+        continue;
+      if (C.colors[w] != uncolored)
+        forbidden[C.colors[w]] = v + 1;
+    }
+    for (std::size_t k = P.row_ptr[v]; k < P.row_ptr[v + 1]; ++k) {
+      std::size_t w = P.col_idx[k];
+      if (w == v)
+        continue;
+      for (std::size_t l = P.row_ptr[w]; l < P.row_ptr[w + 1]; ++l) {
+        std::size_t x = P.col_idx[l];
+        if (x == w || x == v || C.colors[x] == uncolored)
+          continue;
+        if (C.colors[w] == uncolored) {
+          // v and x would share the color of the center of the star at w.
+          forbidden[C.colors[x]] = v + 1;
+          continue;
+        }
+        // Forbid the color of x if it would complete the two-colored path
+        // v - w - x - y.
+        for (std::size_t m = P.row_ptr[x]; m < P.row_ptr[x + 1]; ++m) {
+          std::size_t y = P.col_idx[m];
+          if (y != w && y != x && C.colors[y] == C.colors[w]) {
+            forbidden[C.colors[x]] = v + 1;
+            break;
+          }
+        }
+      }
+    }
+    std::size_t c = 0;
+    while (c < forbidden.size() && forbidden[c] == v + 1)
+      ++c;
+    if (c == forbidden.size())
+      forbidden.push_back(0);
+    C.colors[v] = c;
+    C.num_colors = std::max(C.num_colors, c + 1);
+  }
+  return C;
+}
+
+/// Recovers the symmetric sparse matrix H from the compressed products
+/// B = H * S evaluated with the seed matrix of the star coloring \p C of the
+/// pattern \p P. The entry (i, j) is read from B(i, color(j)) when no other
+/// nonzero of row i has the color of j, and from B(j, color(i)) otherwise.
+template <typename T>
+csr_matrix<T> recover_hessian(const sparsity_pattern& P, const coloring& C,
+                              const matrix<T>& B) {
+  assert(B.rows() == P.rows && B.cols() == C.num_colors &&
+         "compressed hessian does not match the coloring");
+  csr_matrix<T> H(P);
+  std::vector<std::size_t> count(C.num_colors, 0);
+  for (std::size_t i = 0; i < P.rows; ++i) {
+    for (std::size_t k = P.row_ptr[i]; k < P.row_ptr[i + 1]; ++k)
+      ++count[C.colors[P.col_idx[k]]];
+    for (std::size_t k = P.row_ptr[i]; k < P.row_ptr[i + 1]; ++k) {
+      std::size_t j = P.col_idx[k];
+      if (count[C.colors[j]] == 1)
+        H.values[k] = B(i, C.colors[j]);
+      else
+        H.values[k] = B(j, C.colors[i]);
+    }
+    for (std::size_t k = P.row_ptr[i]; k < P.row_ptr[i + 1]; ++k)
+      count[C.colors[P.col_idx[k]]] = 0;
+  }
+  return H;
+}
+
+/// Detects the symmetric sparsity pattern of the n x n hessian by one
+/// hessian-vector product per unit direction at each probe point.
+/// \p hvp(x, v, Hv) must accumulate H(x) * v into the zero-initialized Hv at
+/// the point x of the n independent variables, typically by calling a
+/// derivative generated with clad::hessian<clad::opts::sparse>.
+///
+/// The pattern is numerical: it is the union of the nonzeros found at \p x0
+/// and at \p num_probes - 1 perturbations of it. It only holds for these
+/// points, see detect_jacobian_sparsity.
+template <typename T, typename Fn>
+sparsity_pattern detect_hessian_sparsity(std::size_t n, const T* x0, Fn&& hvp,
+                                         std::size_t num_probes = 3) {
+  std::vector<T> x(n);
+  std::vector<T> v(n, T(0));
+  std::vector<T> Hv(n);
+  std::vector<std::size_t> row_ind;
+  std::vector<std::size_t> col_ind;
+  for (std::size_t probe = 0; probe < num_probes; ++probe) {
+    sparse_detail::probe_point(x0, x.data(), n, probe);
+    for (std::size_t j = 0; j < n; ++j) {
+      v[j] = 1;
+      std::fill(Hv.begin(), Hv.end(), T(0));
+      hvp(x.data(), v.data(), Hv.data());
+      v[j] = 0;
+      for (std::size_t i = 0; i < n; ++i) {
+        if (Hv[i] == T(0))
+          continue;
+        row_ind.push_back(i);
+        col_ind.push_back(j);
+        row_ind.push_back(j);
+        col_ind.push_back(i);
+      }
+    }
+  }
+  return sparsity_pattern::from_coordinates(n, n, row_ind, col_ind);
+}
+
+/// Computes the hessian with the known symmetric sparsity pattern \p P using
+/// one hessian-vector product per color of its star coloring \p C.
+/// \p hvp(v, Hv) must accumulate H * v into Hv at the point of interest, see
+/// detect_hessian_sparsity.
+template <typename T, typename Fn>
+csr_matrix<T> sparse_hessian(const sparsity_pattern& P, const coloring& C,
+                             Fn&& hvp) {
+  matrix<T> B(P.rows, C.num_colors);
+  std::vector<T> v(P.rows);
+  std::vector<T> Hv(P.rows);
+  for (std::size_t c = 0; c < C.num_colors; ++c) {
+    for (std::size_t j = 0; j < P.rows; ++j)
+      v[j] = C.colors[j] == c ? T(1) : T(0);
+    std::fill(Hv.begin(), Hv.end(), T(0));
+    hvp(v.data(), Hv.data());
+    for (std::size_t i = 0; i < P.rows; ++i)
+      B(i, c) = Hv[i];
+  }
+  return recover_hessian(P, C, B);
+}
+
+template <typename T, typename Fn>
+csr_matrix<T> sparse_hessian(const sparsity_pattern& P, Fn&& hvp) {
+  return sparse_hessian<T>(P, color_symmetric(P), hvp);
+}
+
+} // namespace clad
+
+#endif // CLAD_DIFFERENTIATOR_SPARSE_H
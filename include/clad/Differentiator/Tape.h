@@ -49,6 +49,9 @@ template <typename T, std::size_t SLAB_SIZE> struct DiskManager {
     file.seekg(offset, std::ios::beg);
     void* raw_dest = static_cast<void*>(dest);
     file.read(static_cast<char*>(raw_dest), SLAB_SIZE * sizeof(T));
+    // The elements were read back at another address.
+    for (std::size_t i = 0; i < SLAB_SIZE; ++i)
+      relocated(dest[i]);
   }
 #else
   CUDA_HOST_DEVICE DiskManager() {}
@@ -0,0 +1,608 @@
+//--------------------------------------------------------------------*- C++ -*-
+// clad - the C++ Clang-based Automatic Differentiator
+//
+// Univariate truncated Taylor arithmetic. Propagates the normalized Taylor
+// coefficients f_k = f^(k)(x0) / k! of every intermediate value, so that a
+// single evaluation of a function templated on its scalar type yields all
+// derivatives up to order N at O(N^2) cost per operation.
+//------------------------------------------------------------------------------
+
+#ifndef CLAD_DIFFERENTIATOR_TAYLOR_H
+#define CLAD_DIFFERENTIATOR_TAYLOR_H
+
+#include "clad/Differentiator/CladConfig.h"
+
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+
+namespace clad {
+
+/// A truncated Taylor polynomial of degree N with coefficients of type T.
+/// Element k holds f^(k)(x0) / k!, i.e. the coefficients are normalized the
+/// same way as the Taylor series expansion around x0.
+///
+/// Generic code should call the math functions unqualified (e.g. through
+/// `using std::sin; sin(x);`) so that the overloads in this file are found by
+/// argument-dependent lookup.
+///
+/// clad::taylor is a number type, the plugin does not generate any code for
+/// it. Only functions templated on their scalar type can be evaluated with
+/// it, functions written for `double` have to be differentiated with the
+/// other modes.
+template <typename T, std::size_t N> class taylor {
+  static_assert(std::is_floating_point<T>::value,
+                "clad::taylor requires a floating point coefficient type");
+
+  /// The normalized Taylor coefficients, m_Coeffs[0] is the value.
+  T m_Coeffs[N + 1] = {};
+
+public:
+  using value_type = T;
+
+  CUDA_HOST_DEVICE taylor() = default;
+  /// Constructs a constant, all higher order coefficients are zero.
+  template <typename U, typename std::enable_if<std::is_arithmetic<U>::value,
+                                                int>::type = 0>
+  CUDA_HOST_DEVICE taylor(U val) {
+    m_Coeffs[0] = static_cast<T>(val);
+  }
+
+  /// Constructs the independent variable x0 + t, i.e. the seed {x0, 1, 0...}.
+  CUDA_HOST_DEVICE static taylor variable(T x0) {
+    taylor res(x0);
+    if (N > 0)
+      res.m_Coeffs[1] = 1;
+    return res;
+  }
+
+  /// \returns the number of stored coefficients, N + 1.
+  CUDA_HOST_DEVICE static constexpr std::size_t size() { return N + 1; }
+  /// \returns the highest order which is propagated.
+  CUDA_HOST_DEVICE static constexpr std::size_t order() { return N; }
+
+  CUDA_HOST_DEVICE T& operator[](std::size_t k) { return m_Coeffs[k]; }
+  CUDA_HOST_DEVICE const T& operator[](std::size_t k) const {
+    return m_Coeffs[k];
+  }
+
+  /// \returns the value of the expansion point.
+  CUDA_HOST_DEVICE T value() const { return m_Coeffs[0]; }
+
+  /// \returns the k-th derivative, i.e. k! * m_Coeffs[k].
+  CUDA_HOST_DEVICE T derivative(std::size_t k) const {
+    T factorial = 1;
+    for (std::size_t i = 2; i <= k; ++i)
+      factorial *= static_cast<T>(i);
+    return factorial * m_Coeffs[k];
+  }
+
+  CUDA_HOST_DEVICE taylor& operator+=(const taylor& rhs) {
+    for (std::size_t k = 0; k <= N; ++k)
+      m_Coeffs[k] += rhs.m_Coeffs[k];
+    return *this;
+  }
+  CUDA_HOST_DEVICE taylor& operator-=(const taylor& rhs) {
+    for (std::size_t k = 0; k <= N; ++k)
+      m_Coeffs[k] -= rhs.m_Coeffs[k];
+    return *this;
+  }
+  /// Cauchy product, c_k = sum_{j=0..k} a_j * b_{k-j}.
+  CUDA_HOST_DEVICE taylor& operator*=(const taylor& rhs) {
+    // Walk downwards so that the lower coefficients are still unmodified.
+    for (std::size_t k = N + 1; k-- > 0;) {
+      T sum = 0;
+      for (std::size_t j = 0; j <= k; ++j)
+        sum += m_Coeffs[j] * rhs.m_Coeffs[k - j];
+      m_Coeffs[k] = sum;
+    }
+    return *this;
+  }
+  /// c = a / b, c_k = (a_k - sum_{j=1..k} b_j * c_{k-j}) / b_0.
+  CUDA_HOST_DEVICE taylor& operator/=(const taylor& rhs) {
+    // The recurrence reads rhs while writing *this, divide by a copy.
+    if (this == &rhs) {
+      taylor copy(rhs);
+      return *this /= copy;
+    }
+    for (std::size_t k = 0; k <= N; ++k) {
+      T sum = m_Coeffs[k];
+      for (std::size_t j = 1; j <= k; ++j)
+        sum -= rhs.m_Coeffs[j] * m_Coeffs[k - j];
+      m_Coeffs[k] = sum / rhs.m_Coeffs[0];
+    }
+    return *this;
+  }
+
+  template <typename U, typename std::enable_if<std::is_arithmetic<U>::value,
+                                                int>::type = 0>
+  CUDA_HOST_DEVICE taylor& operator+=(U val) {
+    m_Coeffs[0] += static_cast<T>(val);
+    return *this;
+  }
+  template <typename U, typename std::enable_if<std::is_arithmetic<U>::value,
+                                                int>::type = 0>
+  CUDA_HOST_DEVICE taylor& operator-=(U val) {
+    m_Coeffs[0] -= static_cast<T>(val);
+    return *this;
+  }
+  template <typename U, typename std::enable_if<std::is_arithmetic<U>::value,
+                                                int>::type = 0>
+  CUDA_HOST_DEVICE taylor& operator*=(U val) {
+    for (std::size_t k = 0; k <= N; ++k)
+      m_Coeffs[k] *= static_cast<T>(val);
+    return *this;
+  }
+  template <typename U, typename std::enable_if<std::is_arithmetic<U>::value,
+                                                int>::type = 0>
+  CUDA_HOST_DEVICE taylor& operator/=(U val) {
+    for (std::size_t k = 0; k <= N; ++k)
+      m_Coeffs[k] /= static_cast<T>(val);
+    return *this;
+  }
+
+  CUDA_HOST_DEVICE taylor operator-() const {
+    taylor res;
+    for (std::size_t k = 0; k <= N; ++k)
+      res.m_Coeffs[k] = -m_Coeffs[k];
+    return res;
+  }
+  CUDA_HOST_DEVICE taylor operator+() const { return *this; }
+}; // class taylor
+
+template <typename T> struct is_taylor : std::false_type {};
+template <typename T, std::size_t N>
+struct is_taylor<taylor<T, N>> : std::true_type {};
+
+/// Arithmetic operators.
+#define CLAD_TAYLOR_BINARY_OP(op)                                              \
+  template <typename T, std::size_t N>                                         \
+  CUDA_HOST_DEVICE taylor<T, N> operator op(const taylor<T, N>& a,             \
+                                            const taylor<T, N>& b) {           \
+    taylor<T, N> res(a);                                                       \
+    res op## = b;                                                              \
+    return res;                                                                \
+  }                                                                            \
+  template <typename T, std::size_t N, typename U,                             \
+            typename std::enable_if<std::is_arithmetic<U>::value,              \
+                                    int>::type = 0>                            \
+  CUDA_HOST_DEVICE taylor<T, N> operator op(const taylor<T, N>& a, U b) {      \
+    taylor<T, N> res(a);                                                       \
+    res op## = b;                                                              \
+    return res;                                                                \
+  }                                                                            \
+  template <typename T, std::size_t N, typename U,                             \
+            typename std::enable_if<std::is_arithmetic<U>::value,              \
+                                    int>::type = 0>                            \
+  CUDA_HOST_DEVICE taylor<T, N> operator op(U a, const taylor<T, N>& b) {      \
+    taylor<T, N> res(a);                                                       \
+    res op## = b;                                                              \
+    return res;                                                                \
+  }
+
+CLAD_TAYLOR_BINARY_OP(+)
+CLAD_TAYLOR_BINARY_OP(-)
+CLAD_TAYLOR_BINARY_OP(*)
+CLAD_TAYLOR_BINARY_OP(/)
+#undef CLAD_TAYLOR_BINARY_OP
+
+/// Comparisons only look at the value, like the primal code would.
+#define CLAD_TAYLOR_COMPARISON_OP(op)                                          \
+  template <typename T, std::size_t N>                                         \
+  CUDA_HOST_DEVICE bool operator op(const taylor<T, N>& a,                     \
+                                    const taylor<T, N>& b) {                   \
+    return a[0] op b[0];                                                       \
+  }                                                                            \
+  template <typename T, std::size_t N, typename U,                             \
+            typename std::enable_if<std::is_arithmetic<U>::value,              \
+                                    int>::type = 0>                            \
+  CUDA_HOST_DEVICE bool operator op(const taylor<T, N>& a, U b) {              \
+    return a[0] op b;                                                          \
+  }                                                                            \
+  template <typename T, std::size_t N, typename U,                             \
+            typename std::enable_if<std::is_arithmetic<U>::value,              \
+                                    int>::type = 0>                            \
+  CUDA_HOST_DEVICE bool operator op(U a, const taylor<T, N>& b) {              \
+    return a op b[0];                                                          \
+  }
+
+CLAD_TAYLOR_COMPARISON_OP(<)
+CLAD_TAYLOR_COMPARISON_OP(<=)
+CLAD_TAYLOR_COMPARISON_OP(>)
+CLAD_TAYLOR_COMPARISON_OP(>=)
+CLAD_TAYLOR_COMPARISON_OP(==)
+CLAD_TAYLOR_COMPARISON_OP(!=)
+#undef CLAD_TAYLOR_COMPARISON_OP
+
+namespace taylor_detail {
+constexpr double pi = 3.14159265358979323846;
+
+/// Solves b' = a' * g for b, given the series of g and b_0. This is the
+/// common recurrence b_k = 1/k * sum_{j=1..k} j * a_j * g_{k-j} behind the
+/// elementary functions whose derivative is known in closed form.
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> integrate(const taylor<T, N>& a,
+                                        const taylor<T, N>& g, T b0) {
+  taylor<T, N> b(b0);
+  for (std::size_t k = 1; k <= N; ++k) {
+    T sum = 0;
+    for (std::size_t j = 1; j <= k; ++j)
+      sum += static_cast<T>(j) * a[j] * g[k - j];
+    b[k] = sum / static_cast<T>(k);
+  }
+  return b;
+}
+
+/// b = a^r for a real exponent r and a_0 != 0, using a * b' = r * a' * b:
+/// b_k = 1/(k * a_0) * sum_{j=1..k} ((r + 1) * j - k) * a_j * b_{k-j}.
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> pow(const taylor<T, N>& a, T r, T b0) {
+  taylor<T, N> b(b0);
+  for (std::size_t k = 1; k <= N; ++k) {
+    T sum = 0;
+    for (std::size_t j = 1; j <= k; ++j)
+      sum += ((r + 1) * static_cast<T>(j) - static_cast<T>(k)) * a[j] *
+             b[k - j];
+    b[k] = sum / (static_cast<T>(k) * a[0]);
+  }
+  return b;
+}
+
+/// b = e^a with b' = a' * b, b_0 is passed so that expm1/exp2 can reuse it.
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> exp(const taylor<T, N>& a, T b0) {
+  taylor<T, N> b(b0);
+  for (std::size_t k = 1; k <= N; ++k) {
+    T sum = 0;
+    for (std::size_t j = 1; j <= k; ++j)
+      sum += static_cast<T>(j) * a[j] * b[k - j];
+    b[k] = sum / static_cast<T>(k);
+  }
+  return b;
+}
+
+/// b = log(a) with a * b' = a':
+/// b_k = (a_k - 1/k * sum_{j=1..k-1} j * b_j * a_{k-j}) / a_0.
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> log(const taylor<T, N>& a, T b0) {
+  taylor<T, N> b(b0);
+  for (std::size_t k = 1; k <= N; ++k) {
+    T sum = 0;
+    for (std::size_t j = 1; j < k; ++j)
+      sum += static_cast<T>(j) * b[j] * a[k - j];
+    b[k] = (a[k] - sum / static_cast<T>(k)) / a[0];
+  }
+  return b;
+}
+
+/// Computes s = sin(a) and c = cos(a) together, s' = a' * c, c' = -a' * s.
+/// The hyperbolic pair is obtained with sign = 1 (sinh' = cosh, cosh' = sinh).
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE void sincos(const taylor<T, N>& a, taylor<T, N>& s,
+                             taylor<T, N>& c, T s0, T c0, T sign) {
+  s = taylor<T, N>(s0);
+  c = taylor<T, N>(c0);
+  for (std::size_t k = 1; k <= N; ++k) {
+    T sum_s = 0;
+    T sum_c = 0;
+    for (std::size_t j = 1; j <= k; ++j) {
+      sum_s += static_cast<T>(j) * a[j] * c[k - j];
+      sum_c += static_cast<T>(j) * a[j] * s[k - j];
+    }
+    s[k] = sum_s / static_cast<T>(k);
+    c[k] = sign * sum_c / static_cast<T>(k);
+  }
+}
+
+/// b = tan(a) (sign = 1) or tanh(a) (sign = -1), b' = a' * (1 + sign * b^2).
+/// The series of 1 + sign * b^2 is built on the fly from the already known
+/// coefficients of b.
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> tan(const taylor<T, N>& a, T b0, T sign) {
+  taylor<T, N> b(b0);
+  taylor<T, N> d(1 + sign * b0 * b0);
+  for (std::size_t k = 1; k <= N; ++k) {
+    T sum = 0;
+    for (std::size_t j = 1; j <= k; ++j)
+      sum += static_cast<T>(j) * a[j] * d[k - j];
+    b[k] = sum / static_cast<T>(k);
+    T sq = 0;
+    for (std::size_t j = 0; j <= k; ++j)
+      sq += b[j] * b[k - j];
+    d[k] = sign * sq;
+  }
+  return b;
+}
+} // namespace taylor_detail
+
+/// Taylor rules for the builtin functions of BuiltinDerivatives.h.
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> exp(const taylor<T, N>& a) {
+  return taylor_detail::exp(a, ::std::exp(a[0]));
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> expm1(const taylor<T, N>& a) {
+  taylor<T, N> b = taylor_detail::exp(a, ::std::exp(a[0]));
+  b[0] = ::std::expm1(a[0]);
+  return b;
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> exp2(const taylor<T, N>& a) {
+  return taylor_detail::exp(a * ::std::log(static_cast<T>(2)),
+                            ::std::exp2(a[0]));
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> log(const taylor<T, N>& a) {
+  return taylor_detail::log(a, ::std::log(a[0]));
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> log10(const taylor<T, N>& a) {
+  return log(a) / ::std::log(static_cast<T>(10));
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> log2(const taylor<T, N>& a) {
+  return log(a) / ::std::log(static_cast<T>(2));
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> log1p(const taylor<T, N>& a) {
+  return taylor_detail::log(a + 1, ::std::log1p(a[0]));
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> sqrt(const taylor<T, N>& a) {
+  // b^2 = a: b_k = (a_k - sum_{j=1..k-1} b_j * b_{k-j}) / (2 * b_0).
+  taylor<T, N> b(::std::sqrt(a[0]));
+  for (std::size_t k = 1; k <= N; ++k) {
+    T sum = a[k];
+    for (std::size_t j = 1; j < k; ++j)
+      sum -= b[j] * b[k - j];
+    b[k] = sum / (2 * b[0]);
+  }
+  return b;
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> cbrt(const taylor<T, N>& a) {
+  return taylor_detail::pow(a, static_cast<T>(1) / 3, ::std::cbrt(a[0]));
+}
+
+template <typename T, std::size_t N, typename U,
+          typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+CUDA_HOST_DEVICE taylor<T, N> pow(const taylor<T, N>& a, U r) {
+  T exponent = static_cast<T>(r);
+  // The recurrence divides by a_0, x^0 and x^1 are handled exactly instead.
+  if (exponent == 0)
+    return taylor<T, N>(1);
+  if (exponent == 1)
+    return a;
+  if (a[0] == 0 && exponent > 0 && ::std::floor(exponent) == exponent) {
+    // Positive integer powers of a series starting at zero are well defined,
+    // a^n has no coefficient below order n. Compute them by repeated
+    // multiplication.
+    if (exponent > static_cast<T>(N))
+      return taylor<T, N>();
+    auto n = static_cast<std::size_t>(exponent);
+    taylor<T, N> res(1);
+    for (std::size_t i = 0; i < n; ++i)
+      res *= a;
+    return res;
+  }
+  return taylor_detail::pow(a, exponent, ::std::pow(a[0], exponent));
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> pow(const taylor<T, N>& a,
+                                  const taylor<T, N>& b) {
+  return exp(b * log(a));
+}
+
+template <typename T, std::size_t N, typename U,
+          typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+CUDA_HOST_DEVICE taylor<T, N> pow(U a, const taylor<T, N>& b) {
+  return taylor_detail::exp(b * ::std::log(static_cast<T>(a)),
+                            ::std::pow(static_cast<T>(a), b[0]));
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> sin(const taylor<T, N>& a) {
+  taylor<T, N> s;
+  taylor<T, N> c;
+  taylor_detail::sincos(a, s, c, ::std::sin(a[0]), ::std::cos(a[0]),
+                        static_cast<T>(-1));
+  return s;
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> cos(const taylor<T, N>& a) {
+  taylor<T, N> s;
+  taylor<T, N> c;
+  taylor_detail::sincos(a, s, c, ::std::sin(a[0]), ::std::cos(a[0]),
+                        static_cast<T>(-1));
+  return c;
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> tan(const taylor<T, N>& a) {
+  return taylor_detail::tan(a, ::std::tan(a[0]), static_cast<T>(1));
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> sinh(const taylor<T, N>& a) {
+  taylor<T, N> s;
+  taylor<T, N> c;
+  taylor_detail::sincos(a, s, c, ::std::sinh(a[0]), ::std::cosh(a[0]),
+                        static_cast<T>(1));
+  return s;
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> cosh(const taylor<T, N>& a) {
+  taylor<T, N> s;
+  taylor<T, N> c;
+  taylor_detail::sincos(a, s, c, ::std::sinh(a[0]), ::std::cosh(a[0]),
+                        static_cast<T>(1));
+  return c;
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> tanh(const taylor<T, N>& a) {
+  return taylor_detail::tan(a, ::std::tanh(a[0]), static_cast<T>(-1));
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> asin(const taylor<T, N>& a) {
+  // asin' = 1 / sqrt(1 - x^2)
+  taylor<T, N> g = 1 / sqrt(1 - a * a);
+  return taylor_detail::integrate(a, g, ::std::asin(a[0]));
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> acos(const taylor<T, N>& a) {
+  // acos' = -1 / sqrt(1 - x^2)
+  taylor<T, N> g = -1 / sqrt(1 - a * a);
+  return taylor_detail::integrate(a, g, ::std::acos(a[0]));
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> atan(const taylor<T, N>& a) {
+  // atan' = 1 / (1 + x^2)
+  taylor<T, N> g = 1 / (1 + a * a);
+  return taylor_detail::integrate(a, g, ::std::atan(a[0]));
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> atan2(const taylor<T, N>& y,
+                                    const taylor<T, N>& x) {
+  // d atan2(y, x) = (x * dy - y * dx) / (x^2 + y^2). The value is
+  // obtained from std::atan2 to get the quadrant right.
+  taylor<T, N> r2 = x * x + y * y;
+  taylor<T, N> res(::std::atan2(y[0], x[0]));
+  // Integrate (x * y' - y * x') / r2 term by term.
+  taylor<T, N> num;
+  for (std::size_t k = 0; k < N; ++k) {
+    // Coefficient k of x * y' - y * x', where (y')_m = (m + 1) * y_{m+1}.
+    T sum = 0;
+    for (std::size_t j = 0; j <= k; ++j)
+      sum += static_cast<T>(k - j + 1) *
+             (x[j] * y[k - j + 1] - y[j] * x[k - j + 1]);
+    num[k] = sum;
+  }
+  taylor<T, N> q = num / r2;
+  for (std::size_t k = 1; k <= N; ++k)
+    res[k] = q[k - 1] / static_cast<T>(k);
+  return res;
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> asinh(const taylor<T, N>& a) {
+  taylor<T, N> g = 1 / sqrt(a * a + 1);
+  return taylor_detail::integrate(a, g, ::std::asinh(a[0]));
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> acosh(const taylor<T, N>& a) {
+  taylor<T, N> g = 1 / sqrt(a * a - 1);
+  return taylor_detail::integrate(a, g, ::std::acosh(a[0]));
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> atanh(const taylor<T, N>& a) {
+  taylor<T, N> g = 1 / (1 - a * a);
+  return taylor_detail::integrate(a, g, ::std::atanh(a[0]));
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> erf(const taylor<T, N>& a) {
+  // erf' = 2 / sqrt(pi) * e^(-x^2)
+  taylor<T, N> g =
+      exp(-(a * a)) * (2 / ::std::sqrt(static_cast<T>(taylor_detail::pi)));
+  return taylor_detail::integrate(a, g, ::std::erf(a[0]));
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> erfc(const taylor<T, N>& a) {
+  taylor<T, N> g =
+      exp(-(a * a)) * (-2 / ::std::sqrt(static_cast<T>(taylor_detail::pi)));
+  return taylor_detail::integrate(a, g, ::std::erfc(a[0]));
+}
+
+/// Piecewise functions follow the branch selected by the value, like their
+/// pushforwards do.
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> fabs(const taylor<T, N>& a) {
+  return a[0] < 0 ? -a : a;
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> abs(const taylor<T, N>& a) {
+  return fabs(a);
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> fmin(const taylor<T, N>& a,
+                                   const taylor<T, N>& b) {
+  return b[0] < a[0] ? b : a;
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> fmax(const taylor<T, N>& a,
+                                   const taylor<T, N>& b) {
+  return a[0] < b[0] ? b : a;
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> fdim(const taylor<T, N>& a,
+                                   const taylor<T, N>& b) {
+  return a[0] > b[0] ? a - b : taylor<T, N>(0);
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> floor(const taylor<T, N>& a) {
+  return taylor<T, N>(::std::floor(a[0]));
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> ceil(const taylor<T, N>& a) {
+  return taylor<T, N>(::std::ceil(a[0]));
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> fmod(const taylor<T, N>& a,
+                                   const taylor<T, N>& b) {
+  return a - b * ::std::trunc(a[0] / b[0]);
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> hypot(const taylor<T, N>& a,
+                                    const taylor<T, N>& b) {
+  return sqrt(a * a + b * b);
+}
+
+template <typename T, std::size_t N>
+CUDA_HOST_DEVICE taylor<T, N> fma(const taylor<T, N>& a, const taylor<T, N>& b,
+                                  const taylor<T, N>& c) {
+  return a * b + c;
+}
+
+/// Computes the derivatives of order 0..N of the univariate function \p f at
+/// \p x in a single Taylor-mode evaluation. \p f must be callable with a
+/// clad::taylor<T, N> argument, i.e. a function template or a generic lambda,
+/// functions taking `double` are not supported. The k-th derivative is
+/// written into \p derivatives[k].
+template <std::size_t N, typename F, typename T>
+CUDA_HOST_DEVICE void taylor_derivatives(F&& f, T x, T* derivatives) {
+  taylor<T, N> res = f(taylor<T, N>::variable(x));
+  for (std::size_t k = 0; k <= N; ++k)
+    derivatives[k] = res.derivative(k);
+}
+
+} // namespace clad
+
+#endif // CLAD_DIFFERENTIATOR_TAYLOR_H
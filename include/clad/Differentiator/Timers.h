@@ -10,17 +10,33 @@ namespace clad {
 
 struct TimedAnalysisRegion {
   TimedAnalysisRegion(llvm::StringRef Name);
-  /// Only runs the lambda if timers are enabled. Useful for more complex
-  /// operations such as ::print.
+  /// Only runs the lambda if timers or the time trace are enabled. Useful for
+  /// more complex operations such as ::print.
   TimedAnalysisRegion(const std::function<std::string()>& NameProvider);
+  /// The detail is attached to the span of the region in the time trace, see
+  /// -ftime-trace. It is only computed if the time trace is enabled.
+  TimedAnalysisRegion(llvm::StringRef Name,
+                      const std::function<std::string()>& DetailProvider);
   ~TimedAnalysisRegion();
+
+private:
+  /// Whether a span of the time trace was started by this region.
+  bool m_Traced = false;
 };
 struct TimedGenerationRegion {
   TimedGenerationRegion(llvm::StringRef Name);
-  /// Only runs the lambda if timers are enabled. Useful for more complex
-  /// operations such as ::print.
+  /// Only runs the lambda if timers or the time trace are enabled. Useful for
+  /// more complex operations such as ::print.
   TimedGenerationRegion(const std::function<std::string()>& NameProvider);
+  /// The detail is attached to the span of the region in the time trace, see
+  /// -ftime-trace. It is only computed if the time trace is enabled.
+  TimedGenerationRegion(llvm::StringRef Name,
+                        const std::function<std::string()>& DetailProvider);
   ~TimedGenerationRegion();
+
+private:
+  /// Whether a span of the time trace was started by this region.
+  bool m_Traced = false;
 };
 } // namespace clad
 #endif // CLAD_DIFFERENTIATOR_TIMERS_H
@@ -23,6 +23,7 @@ namespace clad {
 
 void VariedAnalyzer::Analyze() {
   m_BlockData.resize(m_AnalysisDC->getCFG()->size());
+  m_CFGQueue.resize(m_AnalysisDC->getCFG()->size());
   // Set current block ID to the ID of entry the block.
 
   CFGBlock& entry = m_AnalysisDC->getCFG()->getEntry();
@@ -62,9 +63,7 @@ void VariedAnalyzer::Analyze() {
   m_CFGQueue.insert(m_CurBlockID);
   // Visit CFG blocks in the queue until it's empty.
   while (!m_CFGQueue.empty()) {
-    auto IDIter = std::prev(m_CFGQueue.end());
-    m_CurBlockID = *IDIter;
-    m_CFGQueue.erase(IDIter);
+    m_CurBlockID = m_CFGQueue.pop();
     CFGBlock& nextBlock = *getCFGBlockByID(m_AnalysisDC, m_CurBlockID);
     AnalyzeCFGBlock(nextBlock);
   }
@@ -97,7 +96,7 @@ void VariedAnalyzer::AnalyzeCFGBlock(const CFGBlock& block) {
     // current block as previous.
     if (!succData) {
       succData = std::make_unique<VarsData>();
-      succData->m_Prev = m_BlockData[block.getBlockID()].get();
+      succData->setPrev(m_BlockData[block.getBlockID()].get());
     }
     if (succData->m_Prev == m_BlockData[block.getBlockID()].get()) {
       m_CFGQueue.insert(succ->getBlockID());
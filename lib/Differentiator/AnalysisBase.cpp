@@ -2,6 +2,7 @@
 
 #include "clad/Differentiator/CladUtils.h"
 
+#include "clang/AST/ASTContext.h"
 #include "clang/AST/Decl.h"
 #include "clang/AST/Expr.h"
 #include "clang/AST/ExprCXX.h"
@@ -13,6 +14,7 @@
 #include "clang/Basic/LLVM.h"
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Casting.h"
 
@@ -141,6 +143,223 @@ void AnalysisBase::getDependencySet(const clang::Expr* E,
   finder.TraverseStmt(const_cast<Expr*>(E));
 }
 
+/// \returns the variable \p E refers to, if any.
+static const VarDecl* getReferencedVar(const Expr* E) {
+  if (const auto* DRE = dyn_cast<DeclRefExpr>(E->IgnoreParenImpCasts()))
+    return dyn_cast<VarDecl>(DRE->getDecl());
+  return nullptr;
+}
+
+/// \returns true if \p Idx is `i`, `i + c`, `c + i` or `i - c` for the
+/// counter `i`.
+static bool isAffineIndex(const Expr* Idx, const VarDecl* Counter) {
+  Idx = Idx->IgnoreParenImpCasts();
+  if (getReferencedVar(Idx) == Counter)
+    return true;
+  const auto* BO = dyn_cast<BinaryOperator>(Idx);
+  if (!BO || (BO->getOpcode() != BO_Add && BO->getOpcode() != BO_Sub))
+    return false;
+  const Expr* L = BO->getLHS()->IgnoreParenImpCasts();
+  const Expr* R = BO->getRHS()->IgnoreParenImpCasts();
+  if (getReferencedVar(L) == Counter && isa<IntegerLiteral>(R))
+    return true;
+  return BO->getOpcode() == BO_Add && isa<IntegerLiteral>(L) &&
+         getReferencedVar(R) == Counter;
+}
+
+/// \returns the counter of \p FS if the loop sets it in its initialization
+/// and moves it by a constant non-zero step in its increment.
+static const VarDecl* getLoopCounter(const ForStmt* FS) {
+  const Expr* Inc = FS->getInc();
+  if (!Inc)
+    return nullptr;
+  Inc = Inc->IgnoreParens();
+  const VarDecl* Counter = nullptr;
+  if (const auto* UO = dyn_cast<UnaryOperator>(Inc)) {
+    if (UO->isIncrementDecrementOp())
+      Counter = getReferencedVar(UO->getSubExpr());
+  } else if (const auto* CAO = dyn_cast<CompoundAssignOperator>(Inc)) {
+    const auto* Step =
+        dyn_cast<IntegerLiteral>(CAO->getRHS()->IgnoreParenImpCasts());
+    if ((CAO->getOpcode() == BO_AddAssign ||
+         CAO->getOpcode() == BO_SubAssign) &&
+        Step && Step->getValue().getBoolValue())
+      Counter = getReferencedVar(CAO->getLHS());
+  }
+  if (!Counter || !Counter->getType()->isIntegerType())
+    return nullptr;
+  const Stmt* Init = FS->getInit();
+  if (const auto* DS = dyn_cast_or_null<DeclStmt>(Init)) {
+    if (DS->isSingleDecl() && DS->getSingleDecl() == Counter)
+      return Counter;
+  } else if (const auto* BO = dyn_cast_or_null<BinaryOperator>(Init)) {
+    if (BO->getOpcode() == BO_Assign &&
+        getReferencedVar(BO->getLHS()) == Counter)
+      return Counter;
+  }
+  return nullptr;
+}
+
+void AnalysisBase::collectAffineLoops(const FunctionDecl* FD) {
+  // Counts the references to every variable in a statement, the ones that
+  // only read the counter and the subscripts affine in the counter.
+  class AccessCollector : public RecursiveASTVisitor<AccessCollector> {
+  public:
+    const VarDecl* m_Counter;
+    std::unordered_map<const VarDecl*, unsigned> m_Refs;
+    std::unordered_map<const VarDecl*,
+                       llvm::SmallVector<const ArraySubscriptExpr*, 4>>
+        m_Subscripts;
+    unsigned m_CounterReads = 0;
+
+    AccessCollector(const VarDecl* Counter) : m_Counter(Counter) {}
+    bool VisitDeclRefExpr(DeclRefExpr* DRE) {
+      if (const auto* VD = dyn_cast<VarDecl>(DRE->getDecl()))
+        ++m_Refs[VD];
+      return true;
+    }
+    bool VisitImplicitCastExpr(ImplicitCastExpr* ICE) {
+      if (ICE->getCastKind() == CK_LValueToRValue &&
+          isa<DeclRefExpr>(ICE->getSubExpr()->IgnoreParens()) &&
+          getReferencedVar(ICE->getSubExpr()) == m_Counter)
+        ++m_CounterReads;
+      return true;
+    }
+    bool VisitUnaryOperator(UnaryOperator* UO) {
+      // A pointer to an element reaches the other elements.
+      if (UO->getOpcode() == UO_AddrOf)
+        if (const auto* ASE =
+                dyn_cast<ArraySubscriptExpr>(UO->getSubExpr()->IgnoreParens()))
+          if (const VarDecl* VD = getReferencedVar(ASE->getBase()))
+            ++m_Refs[VD];
+      return true;
+    }
+    bool VisitArraySubscriptExpr(ArraySubscriptExpr* ASE) {
+      const Expr* Base = ASE->getBase()->IgnoreParenImpCasts();
+      if (!isa<DeclRefExpr>(Base) || !ASE->getType()->isBuiltinType() ||
+          !isAffineIndex(ASE->getIdx(), m_Counter))
+        return true;
+      if (const VarDecl* VD = getReferencedVar(Base))
+        m_Subscripts[VD].push_back(ASE);
+      return true;
+    }
+  };
+  class LoopFinder : public RecursiveASTVisitor<LoopFinder> {
+  public:
+    llvm::SmallVector<const ForStmt*, 4> m_Loops;
+    bool VisitForStmt(ForStmt* FS) {
+      m_Loops.push_back(FS);
+      return true;
+    }
+  };
+
+  LoopFinder finder;
+  finder.TraverseStmt(FD->getBody());
+  ASTContext& C = m_AnalysisDC->getASTContext();
+  for (const ForStmt* FS : finder.m_Loops) {
+    const VarDecl* Counter = getLoopCounter(FS);
+    if (!Counter)
+      continue;
+    // The counter may only be read in the condition and in the body.
+    AccessCollector inner(Counter);
+    // NOLINTBEGIN(cppcoreguidelines-pro-type-const-cast)
+    inner.TraverseStmt(const_cast<Expr*>(FS->getCond()));
+    inner.TraverseStmt(const_cast<Stmt*>(FS->getBody()));
+    // NOLINTEND(cppcoreguidelines-pro-type-const-cast)
+    if (inner.m_Refs[Counter] != inner.m_CounterReads)
+      continue;
+    // The arrays may not be used in the loop other than at one affine index.
+    AccessCollector all(Counter);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    all.TraverseStmt(const_cast<ForStmt*>(FS));
+    AffineLoop Loop;
+    for (auto& pair : all.m_Subscripts) {
+      const VarDecl* VD = pair.first;
+      auto& subscripts = pair.second;
+      if (VD == Counter || all.m_Refs[VD] != subscripts.size() ||
+          !VD->isLocalVarDeclOrParm())
+        continue;
+      // Local pointers may alias other arrays.
+      if (!VD->getType()->isArrayType() && !isa<ParmVarDecl>(VD))
+        continue;
+      ProfileID ID = getProfileID(subscripts.front()->getIdx(), C);
+      if (llvm::any_of(subscripts, [&](const ArraySubscriptExpr* ASE) {
+            return !(getProfileID(ASE->getIdx(), C) == ID);
+          }))
+        continue;
+      for (const ArraySubscriptExpr* ASE : subscripts)
+        m_AffineIndices.insert(ASE->getIdx());
+      ProfileID FreshID = ID;
+      FreshID.AddBoolean(true);
+      Loop.Elements.push_back({VD, ID, FreshID});
+    }
+    if (Loop.Elements.empty())
+      continue;
+    Loop.Init = FS->getInit();
+    if (const auto* E = dyn_cast<Expr>(Loop.Init))
+      Loop.Init = E->IgnoreParens();
+    Loop.Inc = FS->getInc()->IgnoreParens();
+    m_AffineLoopStmts[Loop.Init] = m_AffineLoops.size();
+    m_AffineLoopStmts[Loop.Inc] = m_AffineLoops.size();
+    m_AffineLoops.push_back(std::move(Loop));
+  }
+}
+
+void AnalysisBase::enterAffineIteration(const Stmt* S) {
+  auto it = m_AffineLoopStmts.find(S);
+  if (it == m_AffineLoopStmts.end())
+    return;
+  const AffineLoop& Loop = m_AffineLoops[it->second];
+  bool isEntry = S == Loop.Init;
+  auto& curBranch = getCurBlockVarsData();
+  for (const AffineLoop::Element& Elem : Loop.Elements) {
+    if (curBranch.find(Elem.Array) == curBranch.end()) {
+      VarData* data = getVarDataFromDecl(Elem.Array);
+      if (!data)
+        continue;
+      curBranch[Elem.Array] = data->copy();
+    }
+    VarData& data = curBranch[Elem.Array];
+    if (data.m_Type != VarData::ARR_TYPE)
+      continue;
+    ArrMap& elements = *data.m_Val.m_ArrData;
+    // The element of the next iteration was not accessed by the previous
+    // ones, its state is the one all the elements had before the loop.
+    if (isEntry || elements.find(Elem.FreshID) == elements.end())
+      elements[Elem.FreshID] = elements[ProfileID()].copy();
+    elements[Elem.ID] = elements[Elem.FreshID].copy();
+  }
+}
+
+unsigned VarNumbering::add(const VarDecl* VD) {
+  auto it = m_Indices.insert({VD, m_Decls.size()});
+  if (it.second)
+    m_Decls.push_back(VD);
+  return it.first->second;
+}
+
+void VarNumbering::collect(const FunctionDecl* FD) {
+  class VarCollector : public RecursiveASTVisitor<VarCollector> {
+  public:
+    VarNumbering& m_Vars;
+    VarCollector(VarNumbering& Vars) : m_Vars(Vars) {}
+    bool VisitVarDecl(VarDecl* VD) {
+      m_Vars.add(VD);
+      return true;
+    }
+    bool VisitDeclRefExpr(DeclRefExpr* DRE) {
+      if (const auto* VD = dyn_cast<VarDecl>(DRE->getDecl()))
+        m_Vars.add(VD);
+      return true;
+    }
+  };
+  for (const ParmVarDecl* PVD : FD->parameters())
+    add(PVD);
+  if (const Stmt* Body = FD->getBody())
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    VarCollector(*this).TraverseStmt(const_cast<Stmt*>(Body));
+}
+
 CFGBlock* AnalysisBase::getCFGBlockByID(AnalysisDeclContext* ADC, unsigned ID) {
   return *(ADC->getCFG()->begin() + ID);
 }
@@ -153,6 +372,9 @@ bool AnalysisBase::getIDSequence(const clang::Expr* E, const VarDecl*& VD,
     if (const auto* ASE = dyn_cast<clang::ArraySubscriptExpr>(E)) {
       if (const auto* IL = dyn_cast<clang::IntegerLiteral>(ASE->getIdx()))
         IDSequence.push_back(getProfileID(IL, m_AnalysisDC->getASTContext()));
+      else if (m_AffineIndices.count(ASE->getIdx()))
+        IDSequence.push_back(
+            getProfileID(ASE->getIdx(), m_AnalysisDC->getASTContext()));
       else
         IDSequence.push_back(ProfileID());
       E = ASE->getBase();
@@ -358,50 +580,20 @@ AnalysisBase::collectDataFromPredecessors(VarsData* varsData, VarsData* limit) {
 
 VarsData* AnalysisBase::findLowestCommonAncestor(VarsData* varsData1,
                                                  VarsData* varsData2) {
-  VarsData* pred1 = varsData1;
-  VarsData* pred2 = varsData2;
-  while (true) {
-    if (pred1 == pred2)
-      return pred1;
-
-    auto* branch = varsData1;
-    while (branch != pred1) {
-      if (branch == pred2)
-        return branch;
-      branch = branch->m_Prev;
-    }
-
-    branch = varsData2;
-    while (branch != pred2) {
-      if (branch == pred1)
-        return branch;
-      branch = branch->m_Prev;
-    }
-
-    if (pred1->m_Prev) {
-      pred1 = pred1->m_Prev;
-      // This ensures we don't get an infinite loop because of VarsData being
-      // connected in a loop themselves.
-      if (pred1 == varsData1)
-        return nullptr;
-    } else {
-      // pred1 not having a predecessor means it is corresponds to the entry
-      // block and, therefore it is the lowest common ancestor.
-      return pred1;
-    }
-
-    if (pred2->m_Prev) {
-      pred2 = pred2->m_Prev;
-      // This ensures we don't get an infinite loop because of VarsData being
-      // connected in a loop themselves.
-      if (pred2 == varsData2)
-        return nullptr;
-    } else {
-      // pred2 not having a predecessor means it is corresponds to the entry
-      // block and, therefore it is the lowest common ancestor.
-      return pred2;
-    }
+  // Every VarsData is attached to the VarsData of the block that created it,
+  // the chains form a tree rooted at the entry block. Bring both to the same
+  // depth and walk up until they meet.
+  while (varsData1 && varsData2 && varsData1->m_Depth > varsData2->m_Depth)
+    varsData1 = varsData1->m_Prev;
+  while (varsData1 && varsData2 && varsData2->m_Depth > varsData1->m_Depth)
+    varsData2 = varsData2->m_Prev;
+  while (varsData1 != varsData2) {
+    if (!varsData1 || !varsData2)
+      return nullptr;
+    varsData1 = varsData1->m_Prev;
+    varsData2 = varsData2->m_Prev;
   }
+  return varsData1;
 }
 
 bool AnalysisBase::merge(VarsData* targetData, VarsData* mergeData) {
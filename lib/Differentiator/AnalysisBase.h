@@ -9,9 +9,12 @@
 #include "clad/Differentiator/Compatibility.h"
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/FoldingSet.h"
 #include "llvm/ADT/SmallVector.h"
 
+#include <cassert>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
@@ -139,21 +142,32 @@ struct VarData {
 struct VarsData {
   std::unordered_map<const clang::VarDecl*, VarData> m_Data;
   VarsData* m_Prev = nullptr;
+  /// The length of the m_Prev chain. The chains form a tree rooted at the
+  /// VarsData of the entry block, which makes common ancestors cheap to find.
+  unsigned m_Depth = 0;
 
   VarsData() = default;
   VarsData(const VarsData& other) = default;
   ~VarsData() = default;
   VarsData(VarsData&& other) noexcept
-      : m_Data(std::move(other.m_Data)), m_Prev(other.m_Prev) {}
+      : m_Data(std::move(other.m_Data)), m_Prev(other.m_Prev),
+        m_Depth(other.m_Depth) {}
   VarsData& operator=(const VarsData& other) = delete;
   VarsData& operator=(VarsData&& other) noexcept {
     if (&m_Data != &other.m_Data) {
       m_Data = std::move(other.m_Data);
       m_Prev = other.m_Prev;
+      m_Depth = other.m_Depth;
     }
     return *this;
   }
 
+  /// Attaches this VarsData to the one of a preceding block.
+  void setPrev(VarsData* Prev) {
+    m_Prev = Prev;
+    m_Depth = Prev ? Prev->m_Depth + 1 : 0;
+  }
+
   using iterator = std::unordered_map<const clang::VarDecl*, VarData>::iterator;
   iterator begin() { return m_Data.begin(); }
   iterator end() { return m_Data.end(); }
@@ -162,17 +176,89 @@ struct VarsData {
   void clear() { m_Data.clear(); }
 };
 // NOLINTEND(cppcoreguidelines-pro-type-union-access)
+
+/// A for loop whose counter moves by a constant step and is changed only by
+/// the increment. The listed arrays are accessed in the loop at one affine
+/// index of the counter only, e.g. `a[i + 1]`, so that every iteration works
+/// on an element of its own.
+struct AffineLoop {
+  const clang::Stmt* Init = nullptr;
+  const clang::Stmt* Inc = nullptr;
+  struct Element {
+    const clang::VarDecl* Array;
+    /// The key of the element of the current iteration.
+    ProfileID ID;
+    /// The key of the state the elements had before the loop.
+    ProfileID FreshID;
+  };
+  llvm::SmallVector<Element, 2> Elements;
+};
+
+/// Numbers the variables of a function densely so that sets of variables can
+/// be stored as bit vectors. 'this' is numbered as nullptr.
+class VarNumbering {
+  llvm::DenseMap<const clang::VarDecl*, unsigned> m_Indices;
+  std::vector<const clang::VarDecl*> m_Decls;
+
+public:
+  /// Numbers the parameters of \p FD and the variables its body refers to.
+  void collect(const clang::FunctionDecl* FD);
+  /// \returns the number of \p VD, adding it if needed.
+  unsigned add(const clang::VarDecl* VD);
+  /// \returns true and sets \p Index if \p VD has a number.
+  bool lookup(const clang::VarDecl* VD, unsigned& Index) const {
+    auto it = m_Indices.find(VD);
+    if (it == m_Indices.end())
+      return false;
+    Index = it->second;
+    return true;
+  }
+  const clang::VarDecl* getDecl(unsigned Index) const {
+    return m_Decls[Index];
+  }
+  unsigned size() const { return m_Decls.size(); }
+};
+
+/// The CFG blocks that still have to be visited, stored as a bit vector over
+/// the block IDs. Clang builds the CFG bottom-up, the successors of a block
+/// get lower IDs than the block, so visiting the highest ID first follows the
+/// reverse post-order of the structured control flow. Backward analyses visit
+/// the lowest ID first.
+class CFGWorklist {
+  llvm::BitVector m_Pending;
+  bool m_Backward;
+
+public:
+  explicit CFGWorklist(bool Backward = false) : m_Backward(Backward) {}
+  void resize(unsigned NumBlocks) { m_Pending.resize(NumBlocks); }
+  void insert(unsigned ID) { m_Pending.set(ID); }
+  bool empty() const { return m_Pending.none(); }
+  /// Removes the next block to visit and \returns its ID.
+  unsigned pop() {
+    int ID = m_Backward ? m_Pending.find_first() : m_Pending.find_last();
+    assert(ID >= 0 && "popping from an empty worklist");
+    m_Pending.reset(ID);
+    return ID;
+  }
+};
+
 class AnalysisBase {
 protected:
   clang::AnalysisDeclContext* m_AnalysisDC;
   /// Stores VarsData structures for CFG blocks (the indices in
   /// the vector correspond to CFG blocks' IDs)
   std::vector<std::unique_ptr<VarsData>> m_BlockData;
-  /// The set of IDs of the CFG blocks that should be visited.
-  std::set<unsigned> m_CFGQueue;
+  /// The CFG blocks that should be visited.
+  CFGWorklist m_CFGQueue;
   /// ID of the CFG block being visited.
   unsigned m_CurBlockID{};
   const clang::FunctionDecl* m_Function = nullptr;
+  /// The indices of the subscripts of arrays in affine loops. They stand for
+  /// the element of the current iteration instead of an unknown element.
+  std::set<const clang::Expr*> m_AffineIndices;
+  std::vector<AffineLoop> m_AffineLoops;
+  /// Maps the initialization and the increment of an affine loop to the loop.
+  std::unordered_map<const clang::Stmt*, unsigned> m_AffineLoopStmts;
 
   static clang::CFGBlock* getCFGBlockByID(clang::AnalysisDeclContext* ADC,
                                           unsigned ID);
@@ -185,6 +271,12 @@ protected:
   bool getIDSequence(const clang::Expr* E, const clang::VarDecl*& VD,
                      llvm::SmallVectorImpl<ProfileID>& IDSequence);
 
+  /// Finds the affine loops of the function, see AffineLoop.
+  void collectAffineLoops(const clang::FunctionDecl* FD);
+  /// If \p S starts an affine loop or moves to its next iteration, sets the
+  /// elements of the iteration to the state the elements had before the loop.
+  void enterAffineIteration(const clang::Stmt* S);
+
   /// Returns true if there is at least one required to store node among
   /// child nodes.
   bool findReq(const VarData& varData);
@@ -39,6 +39,7 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/Support/SaveAndRestore.h"
+#include "llvm/Support/TimeProfiler.h"
 
 #include <algorithm>
 #include <cassert>
@@ -190,12 +191,16 @@ DerivativeAndOverload BaseForwardModeVisitor::Derive() {
     if (m_DiffReq.Mode == DiffMode::forward)
       GenerateSeeds(derivedFD);
 
-    Stmt* BodyDiff = Visit(FD->getBody()).getStmt();
-    if (auto* CS = dyn_cast<CompoundStmt>(BodyDiff))
-      for (Stmt* S : CS->body())
-        addToCurrentBlock(S);
-    else
-      addToCurrentBlock(BodyDiff);
+    {
+      llvm::TimeTraceScope TS("Differentiate body",
+                              [this]() { return (std::string)m_DiffReq; });
+      Stmt* BodyDiff = Visit(FD->getBody()).getStmt();
+      if (auto* CS = dyn_cast<CompoundStmt>(BodyDiff))
+        for (Stmt* S : CS->body())
+          addToCurrentBlock(S);
+      else
+        addToCurrentBlock(BodyDiff);
+    }
     Stmt* fnBody = endBlock();
     // FIXME: Enable this when we vgvassilev/clad#367 (removing goto stmts).
     // // If ActOnFinishFunctionBody should pop the current DeclContext.
@@ -1176,6 +1181,7 @@ StmtDiff BaseForwardModeVisitor::VisitCallExpr(const CallExpr* CE) {
     // Silence diag outputs in nested derivation process.
     pushforwardFnRequest.VerboseDiags = false;
     pushforwardFnRequest.EnableTBRAnalysis = m_DiffReq.EnableTBRAnalysis;
+    pushforwardFnRequest.EnableTBRSummaries = m_DiffReq.EnableTBRSummaries;
     pushforwardFnRequest.EnableVariedAnalysis = m_DiffReq.EnableVariedAnalysis;
 
     FunctionDecl* pushforwardFD = nullptr;
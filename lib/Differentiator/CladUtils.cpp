@@ -904,30 +904,40 @@ namespace clad {
           clad_compat::ElaboratedTypeKeyword_None, NS, TT);
     }
 
-    clang::QualType GetRestoreTrackerType(clang::Sema& S) {
-      static QualType T;
-      if (!T.isNull())
-        return T;
+    /// \returns the type clad::Name of a class of the clad runtime.
+    static QualType GetCladRecordType(Sema& S, llvm::StringRef Name) {
       NamespaceDecl* CladNS = GetCladNamespace(S);
       CXXScopeSpec CSS;
       CSS.Extend(S.getASTContext(), CladNS, noLoc, noLoc);
-      DeclarationName TrackerName =
-          &S.getASTContext().Idents.get("restore_tracker");
-      LookupResult TrackerR(S, TrackerName, noLoc, Sema::LookupUsingDeclName,
-                            CLAD_COMPAT_Sema_ForVisibleRedeclaration);
-      S.LookupQualifiedName(TrackerR, CladNS, CSS);
-      assert(!TrackerR.empty() && "cannot find clad::restore_tracker");
-
-      // This will instantiate restore_tracker<T> type and return it.
-      auto* RD = cast<RecordDecl>(TrackerR.getFoundDecl());
+      DeclarationName RecordName = &S.getASTContext().Idents.get(Name);
+      LookupResult R(S, RecordName, noLoc, Sema::LookupUsingDeclName,
+                     CLAD_COMPAT_Sema_ForVisibleRedeclaration);
+      S.LookupQualifiedName(R, CladNS, CSS);
+      assert(!R.empty() && "cannot find the class in the clad namespace");
+
+      auto* RD = cast<RecordDecl>(R.getFoundDecl());
       ASTContext& C = S.getASTContext();
-      T = C.getRecordType(RD);
+      QualType T = C.getRecordType(RD);
       // Get clad namespace and its identifier clad::.
       NestedNameSpecifier* NS = CSS.getScopeRep();
 
       // Create elaborated type with namespace specifier,
-      // i.e. class<T> -> clad::class<T>
-      T = C.getElaboratedType(clad_compat::ElaboratedTypeKeyword_None, NS, T);
+      // i.e. class -> clad::class
+      return C.getElaboratedType(clad_compat::ElaboratedTypeKeyword_None, NS,
+                                 T);
+    }
+
+    clang::QualType GetRestoreTrackerType(clang::Sema& S) {
+      static QualType T;
+      if (T.isNull())
+        T = GetCladRecordType(S, "restore_tracker");
+      return T;
+    }
+
+    clang::QualType GetErrorAccumulatorType(clang::Sema& S) {
+      static QualType T;
+      if (T.isNull())
+        T = GetCladRecordType(S, "error_accumulator");
       return T;
     }
 
@@ -1188,6 +1198,17 @@ namespace clad {
         return C.getPointerType(nonRefValueType);
       }
 
+      if (Mode == DiffMode::jvp || Mode == DiffMode::vjp) {
+        QualType valueType = GetNonConstValueType(Type);
+        if (isArrayOrPointerType(Type))
+          // Directions and adjoints of arrays are passed as buffers.
+          return GetCladArrayRefOfType(S, valueType);
+        // Adjoints of scalars are accumulated through pointers.
+        if (Mode == DiffMode::vjp)
+          return C.getPointerType(valueType);
+        return valueType;
+      }
+
       if (Mode == DiffMode::vector_forward_mode) {
         QualType valueType = GetNonConstValueType(Type);
         if (isArrayOrPointerType(Type))
@@ -1214,7 +1235,7 @@ namespace clad {
     GetDerivativeType(Sema& S, const clang::FunctionDecl* FD, DiffMode mode,
                       llvm::ArrayRef<const clang::ValueDecl*> diffParams,
                       bool forCustomDerv, bool shouldUseRestoreTracker,
-                      bool isForErrorEstimation) {
+                      bool isForErrorEstimation, bool useErrorAccumulator) {
       ASTContext& C = S.getASTContext();
       if (mode == DiffMode::forward)
         return FD->getType();
@@ -1258,10 +1279,34 @@ namespace clad {
           dRetTy = oRetTy;
         }
       } else if (mode == DiffMode::hessian ||
-                 mode == DiffMode::hessian_diagonal) {
+                 mode == DiffMode::hessian_diagonal ||
+                 mode == DiffMode::hessian_packed) {
         QualType argTy = C.getPointerType(oRetTy);
         FnTypes.push_back(argTy);
         return C.getFunctionType(dRetTy, FnTypes, EPI);
+      } else if (mode == DiffMode::hessian_vector_product) {
+        // The direction of the product has one entry per parameter, followed
+        // by the output for the product itself.
+        for (size_t i = 0, e = FnTypes.size(); i < e; ++i)
+          FnTypes.push_back(FnTypes[i]);
+        FnTypes.push_back(C.getPointerType(oRetTy));
+        return C.getFunctionType(dRetTy, FnTypes, EPI);
+      } else if (mode == DiffMode::jvp || mode == DiffMode::vjp) {
+        // Matrix-free products take one direction (jvp) or adjoint (vjp) per
+        // parameter. The adjoints of vjp are preceded by the seed of the
+        // return value, like in pullbacks.
+        size_t numParams = FnTypes.size();
+        if (mode == DiffMode::jvp) {
+          dRetTy = oRetTy;
+        } else if (!oRetTy->isVoidType() && !oRetTy->isPointerType() &&
+                   !utils::isNonConstReferenceType(oRetTy)) {
+          QualType seedTy = oRetTy.getNonReferenceType();
+          FnTypes.push_back(utils::getNonConstType(seedTy, S));
+        }
+        for (size_t i = 0; i < numParams; ++i)
+          FnTypes.push_back(
+              utils::GetParameterDerivativeType(S, mode, FnTypes[i]));
+        return C.getFunctionType(dRetTy, FnTypes, EPI);
       } else if (!returnVoid && !oRetTy->isVoidType()) {
         // Handle pushforwards
         TemplateDecl* valueAndPushforward =
@@ -1344,8 +1389,11 @@ namespace clad {
         }
       }
 
-      if (isForErrorEstimation)
-        FnTypes.push_back(C.getLValueReferenceType(C.DoubleTy));
+      if (isForErrorEstimation) {
+        QualType errorTy =
+            useErrorAccumulator ? GetErrorAccumulatorType(S) : C.DoubleTy;
+        FnTypes.push_back(C.getLValueReferenceType(errorTy));
+      }
 
       return C.getFunctionType(dRetTy, FnTypes, EPI);
     }
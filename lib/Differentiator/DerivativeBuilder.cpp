@@ -7,6 +7,7 @@
 #include "clad/Differentiator/DerivativeBuilder.h"
 
 #include "JacobianModeVisitor.h"
+#include "ProductModeVisitor.h"
 
 #include "clad/Differentiator/BaseForwardModeVisitor.h"
 #include "clad/Differentiator/CladUtils.h"
@@ -458,7 +459,9 @@ static void registerDerivative(Decl* D, Sema& S, const DiffRequest& R) {
 
   DerivativeAndOverload
   DerivativeBuilder::Derive(const DiffRequest& request) {
-    TimedGenerationRegion G([&request]() { return (std::string)request; });
+    TimedGenerationRegion G("Derive " + request.BaseFunctionName + " (" +
+                                DiffModeToString(request.Mode) + ")",
+                            [&request]() { return (std::string)request; });
     if (const FunctionDecl* FD = request.Function) {
       // Process the custom derivative
       if (request.CustomDerivative) {
@@ -600,9 +603,15 @@ static void registerDerivative(Decl* D, Sema& S, const DiffRequest& R) {
       ReverseModeForwPassVisitor V(*this, request);
       result = V.Derive();
     } else if (request.Mode == DiffMode::hessian ||
-               request.Mode == DiffMode::hessian_diagonal) {
+               request.Mode == DiffMode::hessian_diagonal ||
+               request.Mode == DiffMode::hessian_vector_product ||
+               request.Mode == DiffMode::hessian_packed) {
       HessianModeVisitor H(*this, request);
       result = H.Derive();
+    } else if (request.Mode == DiffMode::jvp ||
+               request.Mode == DiffMode::vjp) {
+      ProductModeVisitor P(*this, request);
+      result = P.Derive();
     } else if (request.Mode == DiffMode::jacobian) {
       JacobianModeVisitor J(*this, request);
       result = J.Derive();
@@ -0,0 +1,326 @@
+#include "clad/Differentiator/DerivativeCache.h"
+
+#include "clad/Differentiator/CladUtils.h"
+#include "clad/Differentiator/DerivedFnCollector.h"
+#include "clad/Differentiator/DiffPlanner.h"
+#include "clad/Differentiator/Version.h"
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Attr.h"
+#include "clang/AST/Decl.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/DeclTemplate.h"
+#include "clang/AST/Expr.h"
+#include "clang/AST/ODRHash.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/Basic/SourceManager.h"
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Casting.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <system_error>
+
+using namespace clang;
+
+namespace clad {
+bool DerivativeCache::isCacheable(const DiffRequest& request) {
+  const FunctionDecl* FD = request.Function;
+  if (!FD || request.Global || request.DeclarationOnly ||
+      request.CustomDerivative || request.CurrentDerivativeOrder != 1 ||
+      request.EnableErrorEstimation || request.use_enzyme ||
+      request.ImmediateMode)
+    return false;
+  // FIXME: Derivatives are re-parsed at the translation unit scope. Members,
+  // templates and functions in namespaces would need their enclosing context
+  // to be rebuilt.
+  if (!FD->getDeclContext()->isTranslationUnit() || isa<CXXMethodDecl>(FD) ||
+      FD->getTemplatedKind() != FunctionDecl::TK_NonTemplate)
+    return false;
+  // Leave the diagnostics of such functions to the derivative builder.
+  return FD->isDefined() && !utils::hasNonDifferentiableAttribute(FD) &&
+         !FD->hasAttr<CUDAGlobalAttr>() && !FD->hasAttr<CUDADeviceAttr>();
+}
+
+namespace {
+/// Looks for references to derivatives generated by clad. Their declarations
+/// do not exist when a cached derivative is re-parsed.
+class DerivativeRefFinder : public RecursiveASTVisitor<DerivativeRefFinder> {
+  const FunctionDecl* m_Derivative;
+  const DerivedFnCollector& m_DFC;
+
+public:
+  bool m_Found = false;
+
+  DerivativeRefFinder(const FunctionDecl* derivative,
+                      const DerivedFnCollector& DFC)
+      : m_Derivative(derivative), m_DFC(DFC) {}
+
+  bool VisitDeclRefExpr(DeclRefExpr* DRE) {
+    if (const auto* FD = dyn_cast<FunctionDecl>(DRE->getDecl()))
+      if (FD != m_Derivative && m_DFC.IsCladDerivative(FD))
+        m_Found = true;
+    return !m_Found;
+  }
+};
+} // namespace
+
+bool DerivativeCache::isSelfContained(const FunctionDecl* derivative,
+                                      const DerivedFnCollector& DFC) {
+  DerivativeRefFinder finder(derivative, DFC);
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+  finder.TraverseDecl(const_cast<FunctionDecl*>(derivative));
+  return !finder.m_Found;
+}
+
+namespace {
+/// Hashes what a derivative depends on besides the differentiated function:
+/// the functions it calls, transitively, the records it uses, the variables
+/// and enumerators it reads. Functions and records declared in system headers
+/// are hashed but not traversed.
+class DependencyHasher : public RecursiveASTVisitor<DependencyHasher> {
+  llvm::MD5& m_Hash;
+  const SourceManager& m_SM;
+  llvm::SmallPtrSet<const Decl*, 32> m_Visited;
+  llvm::SmallVector<FunctionDecl*, 16> m_Worklist;
+
+  void update(const NamedDecl* D, uint64_t hash) {
+    m_Hash.update(D->getQualifiedNameAsString());
+    m_Hash.update(std::to_string(hash));
+  }
+
+  bool isSystem(const Decl* D) const {
+    return m_SM.isInSystemHeader(D->getLocation());
+  }
+
+  void addFunction(FunctionDecl* FD) {
+    if (FunctionDecl* Def = FD->getDefinition())
+      FD = Def;
+    if (!m_Visited.insert(FD->getCanonicalDecl()).second)
+      return;
+    // FunctionDecl::getODRHash skips template specializations, hash the
+    // instantiated body instead.
+    ODRHash H;
+    H.AddQualType(FD->getType());
+    if (const Stmt* Body = FD->getBody())
+      H.AddStmt(Body);
+    update(FD, H.CalculateHash());
+    if (FD->hasBody() && !isSystem(FD))
+      m_Worklist.push_back(FD);
+  }
+
+  void addRecord(const CXXRecordDecl* RD) {
+    RD = RD->getDefinition();
+    if (!RD || RD->isLambda() || !m_Visited.insert(RD).second)
+      return;
+    update(RD, RD->getODRHash());
+    // The ODR hash of a specialization does not cover its pattern.
+    if (const auto* CTSD = dyn_cast<ClassTemplateSpecializationDecl>(RD))
+      if (const CXXRecordDecl* Pattern =
+              CTSD->getSpecializedTemplate()->getTemplatedDecl())
+        if (Pattern->hasDefinition())
+          update(Pattern, Pattern->getODRHash());
+    if (isSystem(RD))
+      return;
+    for (const CXXBaseSpecifier& B : RD->bases())
+      addType(B.getType());
+    for (const FieldDecl* F : RD->fields())
+      addType(F->getType());
+  }
+
+  void addType(QualType T) {
+    const Type* Ty = T.getNonReferenceType().getTypePtrOrNull();
+    while (Ty && (Ty->isPointerType() || Ty->isArrayType()))
+      Ty = Ty->getPointeeOrArrayElementType();
+    if (Ty)
+      if (const CXXRecordDecl* RD = Ty->getAsCXXRecordDecl())
+        addRecord(RD);
+  }
+
+  void addDecl(ValueDecl* D) {
+    if (auto* FD = dyn_cast<FunctionDecl>(D)) {
+      addFunction(FD);
+    } else if (auto* VD = dyn_cast<VarDecl>(D)) {
+      if (!VD->hasGlobalStorage() || VD->isStaticLocal() ||
+          !m_Visited.insert(VD->getCanonicalDecl()).second)
+        return;
+      const VarDecl* InitVD = nullptr;
+      const Expr* Init = VD->getAnyInitializer(InitVD);
+      ODRHash H;
+      H.AddQualType(VD->getType());
+      if (Init)
+        H.AddStmt(Init);
+      update(VD, H.CalculateHash());
+      if (Init && !isSystem(InitVD))
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+        TraverseStmt(const_cast<Expr*>(Init));
+    } else if (auto* ECD = dyn_cast<EnumConstantDecl>(D)) {
+      if (m_Visited.insert(ECD).second)
+        update(ECD, ECD->getInitVal().getExtValue());
+    }
+  }
+
+public:
+  DependencyHasher(llvm::MD5& hash, const SourceManager& SM)
+      : m_Hash(hash), m_SM(SM) {}
+
+  void hash(FunctionDecl* FD) {
+    addFunction(FD);
+    while (!m_Worklist.empty())
+      TraverseDecl(m_Worklist.pop_back_val());
+  }
+
+  bool VisitDeclRefExpr(DeclRefExpr* DRE) {
+    addDecl(DRE->getDecl());
+    return true;
+  }
+
+  bool VisitMemberExpr(MemberExpr* ME) {
+    addDecl(ME->getMemberDecl());
+    return true;
+  }
+
+  bool VisitCXXConstructExpr(CXXConstructExpr* CE) {
+    addFunction(CE->getConstructor());
+    return true;
+  }
+
+  bool VisitValueDecl(ValueDecl* VD) {
+    addType(VD->getType());
+    return true;
+  }
+
+  bool VisitExpr(Expr* E) {
+    addType(E->getType());
+    return true;
+  }
+};
+} // namespace
+
+/// Adds the signatures of the custom derivatives in \p DC to \p hash. Adding
+/// a custom derivative for a callee changes the generated code.
+static void hashCustomDerivatives(const DeclContext* DC, llvm::MD5& hash) {
+  for (const Decl* D : DC->decls()) {
+    if (const auto* NSD = dyn_cast<NamespaceDecl>(D)) {
+      hashCustomDerivatives(NSD, hash);
+      continue;
+    }
+    const FunctionDecl* FD = nullptr;
+    if (const auto* FTD = dyn_cast<FunctionTemplateDecl>(D))
+      FD = FTD->getTemplatedDecl();
+    else
+      FD = dyn_cast<FunctionDecl>(D);
+    if (!FD)
+      continue;
+    ODRHash H;
+    H.AddQualType(FD->getType());
+    hash.update(FD->getQualifiedNameAsString());
+    hash.update(std::to_string(H.CalculateHash()));
+  }
+}
+
+const std::string& DerivativeCache::getCustomDerivativesDigest(ASTContext& C) {
+  if (!m_CustomDerivativesDigest.empty())
+    return m_CustomDerivativesDigest;
+  llvm::MD5 hash;
+  for (const NamedDecl* Clad :
+       C.getTranslationUnitDecl()->lookup(&C.Idents.get("clad"))) {
+    const auto* CladNS = dyn_cast<NamespaceDecl>(Clad);
+    if (!CladNS)
+      continue;
+    for (const NamedDecl* Custom :
+         CladNS->lookup(&C.Idents.get("custom_derivatives")))
+      if (const auto* CustomNS = dyn_cast<NamespaceDecl>(Custom))
+        for (const NamespaceDecl* R : CustomNS->redecls())
+          hashCustomDerivatives(R, hash);
+  }
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+  m_CustomDerivativesDigest = std::string(result.digest().str());
+  return m_CustomDerivativesDigest;
+}
+
+std::string DerivativeCache::getKey(const DiffRequest& request) {
+  std::string options;
+  llvm::raw_string_ostream OS(options);
+  request.print(OS);
+  OS << ", summaries=" << request.EnableTBRSummaries
+     << ", va=" << request.EnableVariedAnalysis
+     << ", ua=" << request.EnableUsefulAnalysis
+     << ", immediate=" << request.ImmediateMode;
+  OS.flush();
+
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+  auto* FD = const_cast<FunctionDecl*>(request.Function);
+  ASTContext& C = FD->getASTContext();
+  llvm::MD5 hash;
+  hash.update(getCladFullVersion());
+  hash.update(options);
+  hash.update(std::to_string(FD->getODRHash()));
+  DependencyHasher(hash, C.getSourceManager()).hash(FD);
+  hash.update(getCustomDerivativesDigest(C));
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+  return std::string(result.digest().str());
+}
+
+static std::string getEntryPath(llvm::StringRef dir, llvm::StringRef key) {
+  llvm::SmallString<256> path(dir);
+  llvm::sys::path::append(path, key + ".cpp");
+  return std::string(path.str());
+}
+
+bool DerivativeCache::lookup(llvm::StringRef key, std::string& source) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer =
+      llvm::MemoryBuffer::getFile(getEntryPath(m_Path, key));
+  if (!buffer) {
+    ++m_NumMisses;
+    return false;
+  }
+  source = (*buffer)->getBuffer().str();
+  ++m_NumHits;
+  return true;
+}
+
+void DerivativeCache::store(llvm::StringRef key, llvm::StringRef source) {
+  if (llvm::sys::fs::create_directories(m_Path))
+    return;
+  // Write to a temporary file first so that concurrent compilations never see
+  // a partially written entry.
+  std::string path = getEntryPath(m_Path, key);
+  int FD = -1;
+  llvm::SmallString<256> tmpPath;
+  if (llvm::sys::fs::createUniqueFile(path + "-%%%%%%%%.tmp", FD, tmpPath))
+    return;
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << source;
+    if (OS.has_error()) {
+      OS.clear_error();
+      llvm::sys::fs::remove(tmpPath);
+      return;
+    }
+  }
+  if (llvm::sys::fs::rename(tmpPath, path)) {
+    llvm::sys::fs::remove(tmpPath);
+    return;
+  }
+  ++m_NumStores;
+}
+
+void DerivativeCache::erase(llvm::StringRef key) {
+  llvm::sys::fs::remove(getEntryPath(m_Path, key));
+  --m_NumHits;
+  ++m_NumMisses;
+  ++m_NumDiscarded;
+}
+} // namespace clad
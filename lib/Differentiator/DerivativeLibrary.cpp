@@ -0,0 +1,222 @@
+#include "clad/Differentiator/DerivativeLibrary.h"
+
+#include "clad/Differentiator/DerivedFnCollector.h"
+#include "clad/Differentiator/DiffMode.h"
+#include "clad/Differentiator/DiffPlanner.h"
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Decl.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/Expr.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/AST/PrettyPrinter.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/Basic/LangOptions.h"
+#include "clang/Basic/SourceManager.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/Support/Casting.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <string>
+
+using namespace clang;
+
+namespace clad {
+/// The policy used to print derivatives as source code which can be compiled
+/// on its own, as with -fgenerate-source-file.
+static PrintingPolicy getLibraryPrintingPolicy() {
+  LangOptions LangOpts;
+  LangOpts.CPlusPlus = true;
+  PrintingPolicy Policy(LangOpts);
+  Policy.Bool = true;
+  return Policy;
+}
+
+/// \returns true if \p D is part of the clad runtime, which the library
+/// includes anyway.
+static bool isInCladNamespace(const Decl* D) {
+  for (const DeclContext* DC = D->getDeclContext(); DC; DC = DC->getParent())
+    if (const auto* NS = dyn_cast<NamespaceDecl>(DC))
+      if (NS->getName() == "clad" &&
+          NS->getParent()->getRedeclContext()->isTranslationUnit())
+        return true;
+  return false;
+}
+
+/// Computes the key of the independent parameters of a request the way the
+/// runtime sees them, a string literal or an index.
+/// \returns false if the parameters are not a constant.
+static bool getArgsKey(const Expr* Args, const ASTContext& C,
+                       std::string& Spelling, int& Index) {
+  Spelling.clear();
+  Index = -1;
+  if (!Args)
+    return true;
+  const Expr* E = Args;
+  if (const auto* DAE = dyn_cast<CXXDefaultArgExpr>(E))
+    E = DAE->getExpr();
+  E = E->IgnoreParenImpCasts();
+  if (const auto* SL = dyn_cast<StringLiteral>(E)) {
+    Spelling = SL->getString().str();
+    return true;
+  }
+  Expr::EvalResult Result;
+  if (!E->isValueDependent() && E->EvaluateAsInt(Result, C)) {
+    Index = static_cast<int>(Result.Val.getInt().getExtValue());
+    return true;
+  }
+  return false;
+}
+
+void DerivativeLibrary::addDerivative(const FunctionDecl* FD) {
+  if (FD && FD->hasBody() && !llvm::is_contained(m_Derivatives, FD))
+    m_Derivatives.push_back(FD);
+}
+
+void DerivativeLibrary::addEntry(const DiffRequest& request,
+                                 const FunctionDecl* derivative,
+                                 const FunctionDecl* overload) {
+  const FunctionDecl* FD = request.Function;
+  if (!FD || !derivative || request.RequestedDerivativeOrder != 1 ||
+      request.ImmediateMode || request.EnableErrorEstimation ||
+      request.use_enzyme || request.CompressedJacobian ||
+      request.ParallelColumns || request.ReverseJacobian ||
+      request.AutoJacobian)
+    return;
+  // The runtime only looks up the plain interfaces, other modes come with
+  // options the lookup does not know about.
+  if (request.Mode != DiffMode::forward && request.Mode != DiffMode::reverse &&
+      request.Mode != DiffMode::hessian && request.Mode != DiffMode::jacobian)
+    return;
+  // FIXME: Members, templates and functions in namespaces would need their
+  // enclosing context in the library.
+  if (!FD->getDeclContext()->isTranslationUnit() || isa<CXXMethodDecl>(FD) ||
+      FD->getTemplatedKind() != FunctionDecl::TK_NonTemplate ||
+      !FD->isExternallyVisible())
+    return;
+
+  Entry E;
+  if (!getArgsKey(request.Args, FD->getASTContext(), E.Args, E.ArgIndex))
+    return;
+  E.Function = FD;
+  E.Mode = DiffModeToString(request.Mode);
+  E.Opts = request.BitMaskedOpts;
+  E.Derivative = overload ? overload : derivative;
+  // Keep the code in sync with DiffRequest::updateCall.
+  llvm::raw_string_ostream OS(E.Code);
+  derivative->print(OS, getLibraryPrintingPolicy());
+  OS.flush();
+  addDerivative(derivative);
+  addDerivative(overload);
+  m_Entries.push_back(E);
+}
+
+namespace {
+/// Collects the functions the derivatives call which are not derivatives
+/// themselves, e.g. the original functions in the forward sweep.
+class ReferencedFnCollector
+    : public RecursiveASTVisitor<ReferencedFnCollector> {
+  const DerivedFnCollector& m_DFC;
+
+public:
+  llvm::SetVector<const FunctionDecl*> m_Functions;
+
+  ReferencedFnCollector(const DerivedFnCollector& DFC) : m_DFC(DFC) {}
+
+  bool VisitDeclRefExpr(DeclRefExpr* DRE) {
+    if (const auto* FD = dyn_cast<FunctionDecl>(DRE->getDecl()))
+      if (!m_DFC.IsCladDerivative(FD) && !isInCladNamespace(FD))
+        m_Functions.insert(FD->getCanonicalDecl());
+    return true;
+  }
+};
+} // namespace
+
+static std::string getFnPtrCast(const FunctionDecl* FD,
+                                const PrintingPolicy& Policy) {
+  QualType PtrTy = FD->getASTContext().getPointerType(FD->getType());
+  return "reinterpret_cast<clad::registry::FnPtr>(static_cast<" +
+         PtrTy.getAsString(Policy) + ">(&::" +
+         FD->getQualifiedNameAsString() + "))";
+}
+
+void DerivativeLibrary::print(llvm::raw_ostream& Out, const SourceManager& SM,
+                              const DerivedFnCollector& DFC) const {
+  PrintingPolicy Policy = getLibraryPrintingPolicy();
+
+  ReferencedFnCollector Collector(DFC);
+  for (const FunctionDecl* FD : m_Derivatives)
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    Collector.TraverseDecl(const_cast<FunctionDecl*>(FD));
+  for (const Entry& E : m_Entries)
+    Collector.m_Functions.insert(E.Function->getCanonicalDecl());
+
+  // The declarations of the main file are repeated, the ones of the headers
+  // are included. System headers are reachable through the clad runtime.
+  llvm::SetVector<llvm::StringRef> Includes;
+  llvm::SmallVector<const FunctionDecl*, 8> Decls;
+  for (const FunctionDecl* FD : Collector.m_Functions) {
+    if (llvm::is_contained(m_Derivatives, FD))
+      continue;
+    SourceLocation Loc = SM.getExpansionLoc(FD->getLocation());
+    if (Loc.isInvalid() || SM.isInSystemHeader(Loc))
+      continue;
+    if (!SM.isInMainFile(Loc)) {
+      Includes.insert(SM.getFilename(Loc));
+      continue;
+    }
+    if (FD->getDeclContext()->isTranslationUnit() && !isa<CXXMethodDecl>(FD) &&
+        FD->getTemplatedKind() == FunctionDecl::TK_NonTemplate)
+      Decls.push_back(FD);
+  }
+
+  Out << "// Derivatives generated by clad, see -fderivative-library.\n";
+  Out << "#include \"clad/Differentiator/Differentiator.h\"\n";
+  for (llvm::StringRef Include : Includes)
+    Out << "#include \"" << Include << "\"\n";
+  Out << "\n";
+
+  PrintingPolicy DeclPolicy = Policy;
+  DeclPolicy.TerseOutput = true;
+  for (const FunctionDecl* FD : Decls) {
+    FD->print(Out, DeclPolicy);
+    Out << ";\n";
+  }
+  // Derivatives may call each other in any order.
+  for (const FunctionDecl* FD : m_Derivatives) {
+    FD->print(Out, DeclPolicy);
+    Out << ";\n";
+  }
+  for (const FunctionDecl* FD : m_Derivatives) {
+    Out << "\n";
+    FD->print(Out, Policy);
+    Out << "\n";
+  }
+
+  if (m_Entries.empty())
+    return;
+  Out << "\nnamespace {\n";
+  for (unsigned i = 0, e = m_Entries.size(); i != e; ++i) {
+    const Entry& E = m_Entries[i];
+    Out << "clad::registry::Entry clad_entry_" << i << " = {\n";
+    Out << "    " << getFnPtrCast(E.Function, Policy) << ",\n";
+    Out << "    \"" << E.Mode << "\", " << E.Opts << "u, ";
+    if (E.ArgIndex < 0) {
+      Out << "\"";
+      Out.write_escaped(E.Args);
+      Out << "\", -1,\n";
+    } else {
+      Out << "nullptr, " << E.ArgIndex << ",\n";
+    }
+    Out << "    " << getFnPtrCast(E.Derivative, Policy) << ",\n";
+    Out << "    \"";
+    Out.write_escaped(E.Code);
+    Out << "\", nullptr};\n";
+    Out << "clad::registry::Registrar clad_registrar_" << i << "(clad_entry_"
+        << i << ");\n";
+  }
+  Out << "} // namespace\n";
+}
+} // namespace clad
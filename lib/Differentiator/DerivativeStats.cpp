@@ -0,0 +1,86 @@
+#include "clad/Differentiator/DerivativeStats.h"
+
+#include "clad/Differentiator/DerivedFnCollector.h"
+#include "clad/Differentiator/DiffPlanner.h"
+
+#include "clang/AST/Decl.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/Expr.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/AST/Stmt.h"
+
+#include "llvm/Support/Casting.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <string>
+
+using namespace clang;
+
+namespace clad {
+/// \returns true if \p D is declared directly in the clad namespace.
+static bool isInCladNamespace(const Decl* D) {
+  const auto* NS = dyn_cast<NamespaceDecl>(D->getDeclContext());
+  return NS && NS->getName() == "clad" &&
+         NS->getDeclContext()->getRedeclContext()->isTranslationUnit();
+}
+
+namespace {
+class DerivativeStatsCollector
+    : public RecursiveASTVisitor<DerivativeStatsCollector> {
+  DerivativeStats& m_Stats;
+  const DerivedFnCollector& m_DFC;
+
+public:
+  DerivativeStatsCollector(DerivativeStats& Stats,
+                           const DerivedFnCollector& DFC)
+      : m_Stats(Stats), m_DFC(DFC) {}
+
+  bool VisitStmt(Stmt* S) {
+    if (isa<Expr>(S))
+      ++m_Stats.NumExprs;
+    else
+      ++m_Stats.NumStmts;
+    return true;
+  }
+
+  bool VisitVarDecl(VarDecl* VD) {
+    if (const auto* RD = VD->getType()->getAsCXXRecordDecl())
+      if (RD->getName() == "tape" && isInCladNamespace(RD))
+        ++m_Stats.NumTapes;
+    return true;
+  }
+
+  bool VisitCallExpr(CallExpr* CE) {
+    const FunctionDecl* FD = CE->getDirectCallee();
+    if (!FD)
+      return true;
+    if (FD->getName() == "push" && isInCladNamespace(FD))
+      ++m_Stats.NumTapePushes;
+    else if (m_DFC.IsCladDerivative(FD))
+      ++m_Stats.NumDerivativeCalls;
+    return true;
+  }
+};
+} // namespace
+
+void DerivativeStats::collect(const DiffRequest& request,
+                              const FunctionDecl* FD,
+                              const DerivedFnCollector& DFC) {
+  Request = request;
+  Name = FD->getNameAsString();
+  NumTbrEliminatedStores = request.getNumTbrEliminatedStores();
+  if (Stmt* Body = FD->getBody())
+    DerivativeStatsCollector(*this, DFC).TraverseStmt(Body);
+}
+
+void DerivativeStats::print(llvm::raw_ostream& Out) const {
+  Out << Request << ": " << Name << "\n";
+  Out << "   " << NumStmts << " stmts, " << NumExprs << " exprs, " << NumTapes
+      << " tapes, " << NumTapePushes << " tape pushes, " << NumDerivativeCalls
+      << " derivative calls, " << NumTbrEliminatedStores
+      << " tbr eliminated stores\n";
+  Out << "   " << llvm::format("%.4f", WallTime) << " s, " << Memory
+      << " bytes\n";
+}
+} // namespace clad
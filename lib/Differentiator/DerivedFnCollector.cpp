@@ -11,7 +11,7 @@ void DerivedFnCollector::Add(const DerivedFnInfo& DFI) {
          "We are generating same derivative more than once, or calling "
          "`DerivedFnCollector::Add` more than once for the same derivative "
          ". Ideally, we shouldn't do either.");
-  m_DerivedFnInfoCollection[DFI.OriginalFn()].push_back(DFI);
+  m_DerivedFnInfoCollection[DFI.Hash()].push_back(DFI);
   AddToDerivativeSet(DFI.DerivedFn());
 }
 
@@ -25,7 +25,7 @@ void DerivedFnCollector::AddToCustomDerivativeSet(
 }
 
 bool DerivedFnCollector::AlreadyExists(const DerivedFnInfo& DFI) const {
-  auto subCollectionIt = m_DerivedFnInfoCollection.find(DFI.OriginalFn());
+  auto subCollectionIt = m_DerivedFnInfoCollection.find(DFI.Hash());
   if (subCollectionIt == m_DerivedFnInfoCollection.end())
     return false;
   const auto& subCollection = subCollectionIt->second;
@@ -38,7 +38,8 @@ bool DerivedFnCollector::AlreadyExists(const DerivedFnInfo& DFI) const {
 }
 
 DerivedFnInfo DerivedFnCollector::Find(const DiffRequest& request) const {
-  auto subCollectionIt = m_DerivedFnInfoCollection.find(request.Function);
+  auto subCollectionIt =
+      m_DerivedFnInfoCollection.find(DerivedFnInfo::Hash(request));
   if (subCollectionIt == m_DerivedFnInfoCollection.end())
     return DerivedFnInfo();
   const auto& subCollection = subCollectionIt->second;
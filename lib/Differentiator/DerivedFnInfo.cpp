@@ -1,6 +1,10 @@
 #include "clad/Differentiator/DerivedFnInfo.h"
 #include "clad/Differentiator/DiffPlanner.h"
 
+#include "llvm/ADT/Hashing.h"
+
+#include <cstddef>
+
 using namespace clang;
 
 namespace clad {
@@ -12,22 +16,56 @@ DerivedFnInfo::DerivedFnInfo(const DiffRequest& request,
       m_DiffVarsInfo(request.DVI),
       m_CUDAGlobalArgsIndexes(request.CUDAGlobalArgsIndexes),
       m_UsesEnzyme(request.use_enzyme),
+      m_CompressedJacobian(request.CompressedJacobian),
+      m_ParallelColumns(request.ParallelColumns),
+      m_ReverseJacobian(request.ReverseJacobian),
+      m_AutoJacobian(request.AutoJacobian),
+      m_UseErrorAccumulator(request.UseErrorAccumulator),
       m_DeclarationOnly(request.DeclarationOnly) {}
 
 bool DerivedFnInfo::SatisfiesRequest(const DiffRequest& request) const {
   return (request.Function == m_OriginalFn && request.Mode == m_Mode &&
           request.DVI == m_DiffVarsInfo && request.use_enzyme == m_UsesEnzyme &&
+          request.CompressedJacobian == m_CompressedJacobian &&
+          request.ParallelColumns == m_ParallelColumns &&
+          request.ReverseJacobian == m_ReverseJacobian &&
+          request.AutoJacobian == m_AutoJacobian &&
+          request.UseErrorAccumulator == m_UseErrorAccumulator &&
           request.DeclarationOnly == m_DeclarationOnly &&
           request.CUDAGlobalArgsIndexes == m_CUDAGlobalArgsIndexes);
 }
 
 bool DerivedFnInfo::IsValid() const { return m_OriginalFn && m_DerivedFn; }
 
+static std::size_t HashDerivative(const FunctionDecl* FD, DiffMode Mode,
+                                  const DiffInputVarsInfo& DVI) {
+  llvm::hash_code hash = llvm::hash_combine(FD, static_cast<int>(Mode));
+  for (const DiffInputVarInfo& VarInfo : DVI)
+    hash = llvm::hash_combine(
+        hash, VarInfo.param, VarInfo.paramIndexInterval.Start,
+        VarInfo.paramIndexInterval.Finish,
+        llvm::hash_combine_range(VarInfo.fields.begin(), VarInfo.fields.end()));
+  return hash;
+}
+
+std::size_t DerivedFnInfo::Hash() const {
+  return HashDerivative(m_OriginalFn, m_Mode, m_DiffVarsInfo);
+}
+
+std::size_t DerivedFnInfo::Hash(const DiffRequest& request) {
+  return HashDerivative(request.Function, request.Mode, request.DVI);
+}
+
 bool DerivedFnInfo::RepresentsSameDerivative(const DerivedFnInfo& lhs,
                                              const DerivedFnInfo& rhs) {
   return lhs.m_OriginalFn == rhs.m_OriginalFn && lhs.m_Mode == rhs.m_Mode &&
          lhs.m_DiffVarsInfo == rhs.m_DiffVarsInfo &&
          lhs.m_UsesEnzyme == rhs.m_UsesEnzyme &&
+         lhs.m_CompressedJacobian == rhs.m_CompressedJacobian &&
+         lhs.m_ParallelColumns == rhs.m_ParallelColumns &&
+         lhs.m_ReverseJacobian == rhs.m_ReverseJacobian &&
+         lhs.m_AutoJacobian == rhs.m_AutoJacobian &&
+         lhs.m_UseErrorAccumulator == rhs.m_UseErrorAccumulator &&
          lhs.m_DeclarationOnly == rhs.m_DeclarationOnly &&
          lhs.m_CUDAGlobalArgsIndexes == rhs.m_CUDAGlobalArgsIndexes;
 }
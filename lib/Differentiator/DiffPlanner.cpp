@@ -45,10 +45,13 @@
 
 #include <algorithm>
 #include <cassert>
+#include <iterator>
 #include <memory>
 #include <optional>
+#include <set>
 #include <string>
 #include <utility>
+#include <vector>
 
 using namespace clang;
 
@@ -313,12 +316,139 @@ static QualType GetDerivedFunctionType(const CallExpr* CE) {
     call->setArg(*codeArgIdx, CodeArg);
   }
 
+  AnalysisDeclContext*
+  AnalysisManager::getAnalysisDC(const FunctionDecl* FD) {
+    AnalysisDeclContext*& AnalysisDC = m_AnalysisDCs[FD];
+    if (!AnalysisDC) {
+      clang::CFG::BuildOptions Options;
+      m_AllAnalysisDC.push_back(std::make_unique<AnalysisDeclContext>(
+          /*AnalysisDeclContextManager=*/nullptr, FD, Options));
+      AnalysisDC = m_AllAnalysisDC.back().get();
+    }
+    return AnalysisDC;
+  }
+
+  AnalysisManager::AnalysisKey
+  AnalysisManager::getKey(const DiffRequest& request,
+                          std::vector<const VarDecl*> Seeds,
+                          AnalysisKind Kind) {
+    const FunctionDecl* FD = request.Function;
+    std::vector<bool> Independent(FD->getNumParams());
+    for (const DiffInputVarInfo& dParam : request.DVI)
+      if (const auto* PVD = dyn_cast<ParmVarDecl>(dParam.param))
+        if (PVD->getFunctionScopeIndex() < Independent.size())
+          Independent[PVD->getFunctionScopeIndex()] = true;
+    unsigned Options = request.EnableTBRSummaries |
+                       request.EnableVariedAnalysis << 1 |
+                       request.EnableUsefulAnalysis << 2;
+    return AnalysisKey{FD, std::move(Seeds), std::move(Independent), Options,
+                       Kind};
+  }
+
+  AnalysisManager::AnalysisResult&
+  AnalysisManager::getResult(const AnalysisKey& Key, bool& Found) {
+    auto It = m_Results.find(Key);
+    Found = It != m_Results.end();
+    if (Found) {
+      ++m_NumHits;
+      return It->second;
+    }
+    ++m_NumMisses;
+    return m_Results[Key];
+  }
+
+  /// Inserts the elements of \p Src missing in \p Dst to \p Delta.
+  template <typename T>
+  static void collectAdded(const std::set<T>& Src, const std::set<T>& Dst,
+                           std::set<T>& Delta) {
+    std::set_difference(Src.begin(), Src.end(), Dst.begin(), Dst.end(),
+                        std::inserter(Delta, Delta.end()));
+  }
+
+  void AnalysisManager::runVariedAnalysis(DiffRequest& request) {
+    const FunctionDecl* FD = request.Function;
+    // The varied declarations of the callers only matter if they are visible
+    // in the function, i.e. its parameters and the globals.
+    std::vector<const VarDecl*> Seeds;
+    for (const VarDecl* VD : request.getVariedDecls()) {
+      const DeclContext* DC = VD->getParentFunctionOrMethod();
+      if (!DC || DC == FD)
+        Seeds.push_back(VD);
+    }
+    bool Found = false;
+    AnalysisResult& Result =
+        getResult(getKey(request, Seeds, AnalysisKind::Varied), Found);
+    if (!Found) {
+      TimedAnalysisRegion R("VA " + request.BaseFunctionName,
+                            [&request]() { return (std::string)request; });
+      std::set<const Stmt*> VariedS = request.getVariedStmt();
+      std::set<const VarDecl*> VariedDecls = request.getVariedDecls();
+      VariedAnalyzer analyzer(getAnalysisDC(FD), request,
+                              request.getVariedStmt());
+      analyzer.Analyze();
+      collectAdded(request.getVariedStmt(), VariedS, Result.Stmts);
+      collectAdded(request.getVariedDecls(), VariedDecls, Result.Decls);
+      return;
+    }
+    request.getVariedStmt().insert(Result.Stmts.begin(), Result.Stmts.end());
+    for (const VarDecl* VD : Result.Decls)
+      request.addVariedDecl(VD);
+  }
+
+  void AnalysisManager::runUsefulAnalysis(DiffRequest& request) {
+    const FunctionDecl* FD = request.Function;
+    bool Found = false;
+    AnalysisResult& Result =
+        getResult(getKey(request, {}, AnalysisKind::Useful), Found);
+    if (!Found) {
+      TimedAnalysisRegion R("UA " + request.BaseFunctionName,
+                            [&request]() { return (std::string)request; });
+      std::set<const VarDecl*> UsefulDecls = request.getUsefulDecls();
+      UsefulAnalyzer analyzer(getAnalysisDC(FD), request.getUsefulDecls());
+      analyzer.Analyze(FD);
+      collectAdded(request.getUsefulDecls(), UsefulDecls, Result.Decls);
+      return;
+    }
+    for (const VarDecl* VD : Result.Decls)
+      request.addUsefulDecl(VD);
+  }
+
+  void AnalysisManager::runTBRAnalysis(DiffRequest& request) {
+    const FunctionDecl* FD = request.Function;
+    ParamInfo& modifiedParams = request.getModifiedParams();
+    ParamInfo& usedParams = request.getUsedParams();
+    ParamInfo* nonLinearParams =
+        request.EnableTBRSummaries ? &request.getNonLinearParams() : nullptr;
+    bool Found = false;
+    AnalysisResult& Result =
+        getResult(getKey(request, {}, AnalysisKind::TBR), Found);
+    if (!Found) {
+      TimedAnalysisRegion R("TBR " + request.BaseFunctionName,
+                            [&request]() { return (std::string)request; });
+      std::set<const Stmt*> ToBeRecorded = request.getToBeRecorded();
+      TBRAnalyzer analyzer(request.m_AnalysisDC, request.getToBeRecorded(),
+                           &modifiedParams, &usedParams, nonLinearParams);
+      analyzer.Analyze(request);
+      collectAdded(request.getToBeRecorded(), ToBeRecorded, Result.Stmts);
+      Result.ModifiedParams = modifiedParams[FD];
+      Result.UsedParams = usedParams[FD];
+      if (nonLinearParams)
+        Result.NonLinearParams = (*nonLinearParams)[FD];
+      return;
+    }
+    request.getToBeRecorded().insert(Result.Stmts.begin(), Result.Stmts.end());
+    modifiedParams[FD] = Result.ModifiedParams;
+    usedParams[FD] = Result.UsedParams;
+    if (nonLinearParams)
+      (*nonLinearParams)[FD] = Result.NonLinearParams;
+  }
+
   DiffCollector::DiffCollector(DeclGroupRef DGR, DiffInterval& Interval,
                                clad::DynamicGraph<DiffRequest>& requestGraph,
                                clang::Sema& S, RequestOptions& opts,
-                               OwnedAnalysisContexts& AllAnalysisDC)
+                               AnalysisManager& AM)
       : m_Interval(Interval), m_DiffRequestGraph(requestGraph),
-        m_AllAnalysisDC(AllAnalysisDC), m_Sema(S), m_Options(opts) {
+        m_AnalysisManager(AM), m_Sema(S), m_Options(opts) {
 
     if (Interval.empty())
       return;
@@ -476,10 +606,11 @@ static QualType GetDerivedFunctionType(const CallExpr* CE) {
         }
 
         dVarInfo.param = it->second;
-        
+
         std::size_t lSqBracketIdx = diffSpec.find("[");
         if (lSqBracketIdx != llvm::StringRef::npos) {
-          llvm::StringRef interval(diffSpec.slice(lSqBracketIdx + 1, diffSpec.find(']')));
+          llvm::StringRef interval(
+              diffSpec.slice(lSqBracketIdx + 1, diffSpec.find(']')));
           llvm::StringRef firstStr, lastStr;
           std::tie(firstStr, lastStr) = interval.split(':');
 
@@ -650,23 +781,44 @@ static QualType GetDerivedFunctionType(const CallExpr* CE) {
     Out << "'";
     if (EnableTBRAnalysis)
       Out << ", tbr";
+    if (CompressedJacobian)
+      Out << ", compressed";
+    if (ParallelColumns)
+      Out << ", parallel";
+    if (ReverseJacobian)
+      Out << ", reverse";
+    if (AutoJacobian)
+      Out << ", auto";
+    if (UseErrorAccumulator)
+      Out << ", accumulate_errors";
     Out << ']';
     Out.flush();
   }
 
   bool DiffRequest::shouldBeRecorded(const Stmt* S) const {
+    if (isToBeRecorded(S))
+      return true;
+    m_TbrRunInfo.NotRecorded.insert(S);
+    return false;
+  }
+
+  bool DiffRequest::isToBeRecorded(const Stmt* S) const {
     if (!EnableTBRAnalysis)
       return true;
 
+    // The planner runs the analysis of the requests it collects through the
+    // AnalysisManager, this covers the requests built while deriving.
     if (!m_TbrRunInfo.HasAnalysisRun && !isLambdaCallOperator(Function) &&
         Function->isDefined() && m_AnalysisDC) {
-      TimedAnalysisRegion R("TBR " + BaseFunctionName);
+      TimedAnalysisRegion R("TBR " + BaseFunctionName,
+                            [this]() { return std::string(*this); });
       TBRAnalyzer analyzer(m_AnalysisDC, getToBeRecorded(),
-                           &getModifiedParams(), &getUsedParams());
+                           &getModifiedParams(), &getUsedParams(),
+                           EnableTBRSummaries ? &getNonLinearParams()
+                                              : nullptr);
       analyzer.Analyze(*this);
     }
-    auto found = m_TbrRunInfo.ToBeRecorded.find(S);
-    return found != m_TbrRunInfo.ToBeRecorded.end();
+    return m_TbrRunInfo.ToBeRecorded.count(S);
   }
 
   bool DiffRequest::shouldHaveAdjointForw(const VarDecl* VD) const {
@@ -803,6 +955,28 @@ static QualType GetDerivedFunctionType(const CallExpr* CE) {
     return false;
   }
 
+  /// Reports an error if \p Name, which the code generated for the option
+  /// \p Option calls, is not declared in the clad namespace. The runtime of
+  /// these options is not part of clad/Differentiator/Differentiator.h.
+  ///\returns true on error.
+  static bool RequireCladRuntime(Sema& S, SourceLocation Loc,
+                                 llvm::StringRef Option, llvm::StringRef Name,
+                                 llvm::StringRef Header) {
+    LookupResult R(S, &S.getASTContext().Idents.get(Name), Loc,
+                   Sema::LookupOrdinaryName);
+    S.LookupQualifiedName(R, utils::GetCladNamespace(S));
+    if (const auto* RD = R.getAsSingle<CXXRecordDecl>()) {
+      if (RD->hasDefinition())
+        return false;
+    } else if (!R.empty()) {
+      return false;
+    }
+    utils::diag(S, DiagnosticsEngine::Error, Loc,
+                "%0 option requires including '%1'")
+        << Option << Header;
+    return true;
+  }
+
   ///\returns true on error.
   static bool ProcessInvocationArgs(Sema& S, SourceLocation BeginLoc,
                                     const RequestOptions& ReqOpts,
@@ -810,39 +984,64 @@ static QualType GetDerivedFunctionType(const CallExpr* CE) {
                                     DiffRequest& request) {
     const AnnotateAttr* A = FD->getAttr<AnnotateAttr>();
     std::string Annotation = A->getAnnotation().str();
+
+    const TemplateArgumentList* TAL = FD->getTemplateSpecializationArgs();
+    assert(TAL && "Call must have specialization args!");
+
+    // bitmask_opts is a template pack of unsigned integers, so we need to
+    // do bitwise or of all the values to get the final value.
+    unsigned bitmasked_opts_value = 0;
+    const auto template_arg = TAL->get(0);
+    if (template_arg.getKind() == TemplateArgument::Pack)
+      for (const auto& arg : TAL->get(0).pack_elements())
+        bitmasked_opts_value |= arg.getAsIntegral().getExtValue();
+    request.BitMaskedOpts = bitmasked_opts_value;
+
+    bool accumulate_errors_in_req =
+        clad::HasOption(bitmasked_opts_value, clad::opts::accumulate_errors);
     if (Annotation == "E") {
-      // Error estimation has no options yet.
+      // The error accumulators are the only option of error estimation.
       request.Mode = DiffMode::reverse;
       request.EnableErrorEstimation = true;
-      return false;
+      request.UseErrorAccumulator = accumulate_errors_in_req;
+      return accumulate_errors_in_req &&
+             RequireCladRuntime(S, BeginLoc, "accumulate_errors",
+                                "error_accumulator",
+                                "clad/Differentiator/ErrorAccumulator.h");
     }
+    if (accumulate_errors_in_req) {
+      utils::diag(S, DiagnosticsEngine::Error, BeginLoc,
+                  "accumulate_errors option is only valid for error "
+                  "estimation");
+      return true;
+    }
+
+    // clad::hessian_vector_product is clad::hessian<clad::opts::sparse>, both
+    // are handled by the sparse option below.
+    if (Annotation == "V")
+      bitmasked_opts_value |= clad::opts::sparse;
 
     if (Annotation == "D")
       request.Mode = DiffMode::forward;
-    else if (Annotation == "H")
+    else if (Annotation == "H" || Annotation == "V")
       request.Mode = DiffMode::hessian;
+    else if (Annotation == "JVP")
+      request.Mode = DiffMode::jvp;
+    else if (Annotation == "VJP")
+      request.Mode = DiffMode::vjp;
     else if (Annotation == "J")
       request.Mode = DiffMode::jacobian;
     else if (Annotation == "G")
       request.Mode = DiffMode::reverse;
     else
       llvm_unreachable("unknown mode");
-    if (request.Mode == DiffMode::reverse || request.Mode == DiffMode::hessian)
+    if (request.Mode == DiffMode::reverse ||
+        request.Mode == DiffMode::hessian || request.Mode == DiffMode::vjp)
       request.EnableTBRAnalysis = ReqOpts.EnableTBRAnalysis;
+    request.EnableTBRSummaries = ReqOpts.EnableTBRSummaries;
     request.EnableVariedAnalysis = ReqOpts.EnableVariedAnalysis;
     request.EnableUsefulAnalysis = ReqOpts.EnableUsefulAnalysis;
 
-    const TemplateArgumentList* TAL = FD->getTemplateSpecializationArgs();
-    assert(TAL && "Call must have specialization args!");
-
-    // bitmask_opts is a template pack of unsigned integers, so we need to
-    // do bitwise or of all the values to get the final value.
-    unsigned bitmasked_opts_value = 0;
-    const auto template_arg = TAL->get(0);
-    if (template_arg.getKind() == TemplateArgument::Pack)
-      for (const auto& arg : TAL->get(0).pack_elements())
-        bitmasked_opts_value |= arg.getAsIntegral().getExtValue();
-
     bool enable_tbr_in_req =
         clad::HasOption(bitmasked_opts_value, clad::opts::enable_tbr);
     bool disable_tbr_in_req =
@@ -902,6 +1101,38 @@ static QualType GetDerivedFunctionType(const CallExpr* CE) {
     if (enable_ua_in_req || disable_ua_in_req)
       request.EnableUsefulAnalysis = enable_ua_in_req && !disable_ua_in_req;
 
+    // Check for clad::hessian<parallel>. The option only changes how the
+    // columns of the plain hessian are dispatched.
+    if (clad::HasOption(bitmasked_opts_value, clad::opts::parallel)) {
+      if (request.Mode != DiffMode::hessian ||
+          clad::HasOption(bitmasked_opts_value, clad::opts::diagonal_only) ||
+          clad::HasOption(bitmasked_opts_value, clad::opts::sparse) ||
+          clad::HasOption(bitmasked_opts_value, clad::opts::packed) ||
+          clad::HasOption(bitmasked_opts_value, clad::opts::immediate_mode)) {
+        utils::diag(S, DiagnosticsEngine::Error, BeginLoc,
+                    "parallel option is only valid for the full hessian");
+        return true;
+      }
+      if (RequireCladRuntime(S, BeginLoc, "parallel", "parallel_columns",
+                             "clad/Differentiator/Parallel.h"))
+        return true;
+      request.ParallelColumns = true;
+    }
+
+    // Check for clad::hessian<packed>. The diagonal is already stored densely
+    // by clad::hessian<diagonal_only>.
+    if (clad::HasOption(bitmasked_opts_value, clad::opts::packed)) {
+      if (request.Mode == DiffMode::hessian &&
+          !clad::HasOption(bitmasked_opts_value, clad::opts::diagonal_only)) {
+        request.Mode = DiffMode::hessian_packed;
+        return RequireCladRuntime(S, BeginLoc, "packed", "pack_upper_row",
+                                  "clad/Differentiator/Packed.h");
+      }
+      utils::diag(S, DiagnosticsEngine::Error, BeginLoc,
+                  "packed option is only valid for the full hessian");
+      return true;
+    }
+
     // Check for clad::hessian<diagonal_only>.
     if (clad::HasOption(bitmasked_opts_value, clad::opts::diagonal_only)) {
       if (request.Mode == DiffMode::hessian) {
@@ -913,6 +1144,36 @@ static QualType GetDerivedFunctionType(const CallExpr* CE) {
       return true;
     }
 
+    // Check for clad::jacobian<auto_mode>. The direction is chosen once the
+    // parameters of the function are known, see UpdateDiffParamsInfo.
+    if (clad::HasOption(bitmasked_opts_value, clad::opts::auto_mode)) {
+      if (request.Mode != DiffMode::jacobian ||
+          clad::HasOption(bitmasked_opts_value, clad::opts::sparse)) {
+        utils::diag(S, DiagnosticsEngine::Error, BeginLoc,
+                    "auto_mode option is only valid for jacobian mode");
+        return true;
+      }
+      if (RequireCladRuntime(S, BeginLoc, "auto_mode", "auto_jacobian",
+                             "clad/Differentiator/ReverseJacobian.h"))
+        return true;
+      request.AutoJacobian = true;
+    }
+
+    // Check for clad::jacobian<sparse> and clad::hessian<sparse>.
+    if (clad::HasOption(bitmasked_opts_value, clad::opts::sparse)) {
+      if (request.Mode == DiffMode::jacobian) {
+        request.CompressedJacobian = true;
+        return false;
+      }
+      if (request.Mode == DiffMode::hessian) {
+        request.Mode = DiffMode::hessian_vector_product;
+        return false;
+      }
+      utils::diag(S, DiagnosticsEngine::Error, BeginLoc,
+                  "sparse option is only valid for jacobian and hessian modes");
+      return true;
+    }
+
     if (clad::HasOption(bitmasked_opts_value, clad::opts::use_enzyme))
       request.use_enzyme = true;
 
@@ -958,6 +1219,58 @@ static QualType GetDerivedFunctionType(const CallExpr* CE) {
     });
   }
 
+  /// Chooses the direction of clad::jacobian<clad::opts::auto_mode>. If the
+  /// number of independent and output variables is known from the array types
+  /// of the parameters the choice is made here, otherwise it is left to the
+  /// runtime dispatch in clad::auto_jacobian.
+  static void ResolveAutoJacobian(DiffRequest& R) {
+    const FunctionDecl* FD = R.Function;
+    // Row by row jacobians are only built for free functions writing their
+    // outputs to arrays.
+    bool hasOutputs = false;
+    bool isSupported = !R.CompressedJacobian && !isa<CXXMethodDecl>(FD) &&
+                       FD->getReturnType()->isVoidType();
+    for (const ParmVarDecl* PVD : FD->parameters()) {
+      if (PVD->getType()->isReferenceType())
+        isSupported = false;
+      if (PVD->getName().contains("_clad_out_") &&
+          utils::isArrayOrPointerType(PVD->getType()))
+        hasOutputs = true;
+    }
+    if (!isSupported || !hasOutputs) {
+      R.AutoJacobian = false;
+      return;
+    }
+
+    std::size_t numInputs = 0;
+    std::size_t numOutputs = 0;
+    for (const ParmVarDecl* PVD : FD->parameters()) {
+      bool isOutput = PVD->getName().contains("_clad_out_");
+      bool isInput =
+          !isOutput && std::any_of(R.DVI.begin(), R.DVI.end(),
+                                   [PVD](const DiffInputVarInfo& dParam) {
+                                     return dParam.param == PVD;
+                                   });
+      if (!isInput && !isOutput)
+        continue;
+      if (!utils::isArrayOrPointerType(PVD->getType())) {
+        ++numInputs;
+        continue;
+      }
+      // Array parameters decay to pointers, their declared size is only
+      // available from the original type.
+      const auto* CAT = dyn_cast<ConstantArrayType>(
+          PVD->getOriginalType()->getUnqualifiedDesugaredType());
+      if (!CAT)
+        return;
+      std::size_t size = CAT->getSize().getZExtValue();
+      (isOutput ? numOutputs : numInputs) += size;
+    }
+    // Keep in sync with clad::prefer_reverse_jacobian.
+    R.AutoJacobian = false;
+    R.ReverseJacobian = numOutputs < numInputs;
+  }
+
   static Expr* getOverloadExpr(Sema& S, DeclContext* DC, DiffRequest& R) {
     // Error estimation only uses forward mode derivatives if they are
     // user-prodived to handle builtin derivatives. If found, we have to change
@@ -1111,6 +1424,7 @@ static QualType GetDerivedFunctionType(const CallExpr* CE) {
 
       std::string Annotation = A->getAnnotation().str();
       if (Annotation != "D" && Annotation != "G" && Annotation != "H" &&
+          Annotation != "V" && Annotation != "JVP" && Annotation != "VJP" &&
           Annotation != "J" && Annotation != "E")
         return true;
 
@@ -1129,6 +1443,8 @@ static QualType GetDerivedFunctionType(const CallExpr* CE) {
 
       request.Args = E->getArg(1);
       request.UpdateDiffParamsInfo(m_Sema);
+      if (request.AutoJacobian)
+        ResolveAutoJacobian(request);
       if (request.Mode == DiffMode::reverse && request.EnableVariedAnalysis) {
         if (request.Args)
           for (const auto& dParam : request.DVI)
@@ -1148,15 +1464,22 @@ static QualType GetDerivedFunctionType(const CallExpr* CE) {
 
       request.VerboseDiags = false;
       request.EnableTBRAnalysis = m_TopMostReq->EnableTBRAnalysis;
+      request.EnableTBRSummaries = m_TopMostReq->EnableTBRSummaries;
       request.EnableVariedAnalysis = m_TopMostReq->EnableVariedAnalysis;
       request.EnableUsefulAnalysis = m_TopMostReq->EnableUsefulAnalysis;
       request.EnableErrorEstimation = m_TopMostReq->EnableErrorEstimation;
       request.CallContext = E;
+      // Reverse jacobians derive the pullback of the function on demand.
+      if (m_TopMostReq->Mode == DiffMode::jacobian &&
+          m_TopMostReq->ReverseJacobian)
+        return true;
+      // Vector-jacobian products are computed by the pullback of the function.
+      bool isReverse = m_TopMostReq->Mode == DiffMode::reverse ||
+                       m_TopMostReq->Mode == DiffMode::vjp;
 
       const auto* MD = dyn_cast<CXXMethodDecl>(FD);
       if (MD) {
-        if (isLambdaCallOperator(MD) &&
-            m_TopMostReq->Mode == DiffMode::reverse) {
+        if (isLambdaCallOperator(MD) && isReverse) {
           request.EnableVariedAnalysis = false;
           return true;
         }
@@ -1174,18 +1497,16 @@ static QualType GetDerivedFunctionType(const CallExpr* CE) {
           allArgumentsAreLiterals(E->arguments(), m_ParentReq))
         nonDiff = true;
       // In the reverse mode, such functions don't have dfdx()
-      if (!utils::hasMemoryTypeParams(FD) && hasPointerOrRefReturn &&
-          m_TopMostReq->Mode == DiffMode::reverse)
+      if (!utils::hasMemoryTypeParams(FD) && hasPointerOrRefReturn && isReverse)
         nonDiff = true;
 
-      if (nonDiff && m_TopMostReq->Mode != DiffMode::reverse)
+      if (nonDiff && !isReverse)
         return true;
 
       request.Function = FD;
       request.CallContext = E;
       bool canUsePushforwardInRevMode =
-          m_TopMostReq->Mode == DiffMode::reverse &&
-          !request.EnableErrorEstimation &&
+          isReverse && !request.EnableErrorEstimation &&
           utils::canUsePushforwardInRevMode(FD);
 
       std::string FDName = FD->getNameAsString();
@@ -1201,9 +1522,12 @@ static QualType GetDerivedFunctionType(const CallExpr* CE) {
         request.Mode = DiffMode::unknown;
       else if (m_TopMostReq->Mode == DiffMode::forward ||
                m_TopMostReq->Mode == DiffMode::hessian ||
+               m_TopMostReq->Mode == DiffMode::hessian_vector_product ||
+               m_TopMostReq->Mode == DiffMode::hessian_packed ||
+               m_TopMostReq->Mode == DiffMode::jvp ||
                canUsePushforwardInRevMode)
         request.Mode = DiffMode::pushforward;
-      else if (m_TopMostReq->Mode == DiffMode::reverse)
+      else if (isReverse)
         request.Mode = DiffMode::pullback;
       else if (m_TopMostReq->Mode == DiffMode::vector_forward_mode ||
                m_TopMostReq->Mode == DiffMode::jacobian ||
@@ -1251,8 +1575,7 @@ static QualType GetDerivedFunctionType(const CallExpr* CE) {
       }
 
       // Warn if we find pullbacks.
-      if (canUsePushforwardInRevMode &&
-          m_TopMostReq->Mode == DiffMode::reverse) {
+      if (canUsePushforwardInRevMode && isReverse) {
         DiffRequest R = request;
         R.BaseFunctionName = utils::ComputeEffectiveFnName(R.Function);
         R.Mode = DiffMode::pullback;
@@ -1303,57 +1626,96 @@ static QualType GetDerivedFunctionType(const CallExpr* CE) {
     else if (const auto* OCE = dyn_cast<CXXOperatorCallExpr>(E))
       isNonConstMethod =
           utils::isNonConstReferenceType(OCE->getArg(0)->getType());
+    bool hasCustomDerivative = LookupCustomDerivativeDecl(request);
+    // With summaries, the callees without side-effects are analyzed too so
+    // that the caller knows which arguments their pullbacks read. Custom
+    // derivatives may read any argument.
+    bool requestSummary = request.EnableTBRSummaries &&
+                          !hasCustomDerivative && !nonDiff;
     bool requestTBR =
         request.EnableTBRAnalysis &&
         (request.Mode == DiffMode::pullback || isNonConstMethod) &&
-        utils::hasMemoryTypeParams(request.Function) && request->isDefined() &&
-        E->getDirectCallee();
+        (utils::hasMemoryTypeParams(request.Function) || requestSummary) &&
+        request->isDefined() && E->getDirectCallee();
     bool shouldUseRestoreTracker =
         utils::shouldUseRestoreTracker(request.Function);
-    if (!(LookupCustomDerivativeDecl(request) || nonDiff) || requestTBR) {
-      clang::CFG::BuildOptions Options;
-      std::unique_ptr<AnalysisDeclContext> AnalysisDC =
-          std::make_unique<AnalysisDeclContext>(
-              /*AnalysisDeclContextManager=*/nullptr, request.Function,
-              Options);
-
-      if (request.EnableVariedAnalysis && request->isDefined()) {
-        TimedAnalysisRegion R("VA " + request.BaseFunctionName);
-        VariedAnalyzer analyzer(AnalysisDC.get(), request,
-                                request.getVariedStmt());
-        analyzer.Analyze();
-      }
+    if (!(hasCustomDerivative || nonDiff) || requestTBR) {
+      if (request.EnableVariedAnalysis && request->isDefined())
+        m_AnalysisManager.runVariedAnalysis(request);
 
-      if (m_TopMostReq->EnableUsefulAnalysis) {
-        TimedAnalysisRegion R("UA " + request.BaseFunctionName);
-        UsefulAnalyzer analyzer(AnalysisDC.get(), request.getUsefulDecls());
-        analyzer.Analyze(request.Function);
-      }
+      if (m_TopMostReq->EnableUsefulAnalysis)
+        m_AnalysisManager.runUsefulAnalysis(request);
 
-      m_AllAnalysisDC.push_back(std::move(AnalysisDC));
-      request.m_AnalysisDC = m_AllAnalysisDC.back().get();
+      request.m_AnalysisDC = m_AnalysisManager.getAnalysisDC(request.Function);
 
       //  Recurse into call graph.
       TraverseFunctionDeclOnce(request.Function);
 
       if (requestTBR) {
-        TimedAnalysisRegion R("TBR " + request.BaseFunctionName);
+        m_AnalysisManager.runTBRAnalysis(request);
         ParamInfo& modifiedParams = request.getModifiedParams();
         ParamInfo& usedParams = request.getUsedParams();
-        TBRAnalyzer analyzer(request.m_AnalysisDC, request.getToBeRecorded(),
-                             &modifiedParams, &usedParams);
-        analyzer.Analyze(request);
         if (modifiedParams[FD].empty())
           shouldUseRestoreTracker = false;
         Saved.get()->addFunctionModifiedParams(FD, modifiedParams[FD]);
         Saved.get()->addFunctionUsedParams(FD, usedParams[FD]);
+        if (requestSummary)
+          Saved.get()->addFunctionNonLinearParams(
+              FD, request.getNonLinearParams()[FD]);
+      } else if (request.EnableTBRAnalysis &&
+                 (request.Mode == DiffMode::reverse ||
+                  request.Mode == DiffMode::pullback ||
+                  request.Mode == DiffMode::vjp) &&
+                 request->isDefined() &&
+                 !isLambdaCallOperator(request.Function)) {
+        // The top-level requests and the pullbacks without side-effects would
+        // otherwise run the analysis in DiffRequest::isToBeRecorded.
+        m_AnalysisManager.runTBRAnalysis(request);
+      }
+
+      if (request.Mode == DiffMode::hessian_vector_product ||
+          request.Mode == DiffMode::jvp) {
+        // Hessian-vector products are pullbacks of the pushforward of the
+        // function, the pullback is scheduled when the hessian is derived.
+        // Jacobian-vector products call the pushforward.
+        DiffRequest pushforwardRequest = request;
+        pushforwardRequest.Mode = DiffMode::pushforward;
+        pushforwardRequest.CallUpdateRequired = false;
+        pushforwardRequest.Args = nullptr;
+        pushforwardRequest.UpdateDiffParamsInfo(m_Sema);
+        LookupCustomDerivativeDecl(pushforwardRequest);
+        m_DiffRequestGraph.addNode(pushforwardRequest, /*isSource=*/true);
+      }
+
+      if (request.Mode == DiffMode::vjp) {
+        // Vector-jacobian products call the pullback of the function w.r.t.
+        // the requested parameters.
+        DiffRequest pullbackRequest = request;
+        pullbackRequest.Mode = DiffMode::pullback;
+        pullbackRequest.CallUpdateRequired = false;
+        pullbackRequest.Args = nullptr;
+        LookupCustomDerivativeDecl(pullbackRequest);
+        m_DiffRequestGraph.addNode(pullbackRequest, /*isSource=*/true);
+      }
+
+      if (request.Mode == DiffMode::jacobian && request.AutoJacobian) {
+        // The runtime dispatch of auto jacobians falls back to the forward
+        // mode jacobian, the pullback is derived on demand.
+        DiffRequest forwRequest = request;
+        forwRequest.AutoJacobian = false;
+        forwRequest.CallUpdateRequired = false;
+        LookupCustomDerivativeDecl(forwRequest);
+        m_DiffRequestGraph.addNode(forwRequest, /*isSource=*/true);
       }
 
       if (request.Mode == DiffMode::hessian ||
-          request.Mode == DiffMode::hessian_diagonal) {
+          request.Mode == DiffMode::hessian_diagonal ||
+          request.Mode == DiffMode::hessian_packed) {
         DiffRequest forwRequest = request;
         forwRequest.Mode = DiffMode::forward;
         forwRequest.CallUpdateRequired = false;
+        // The columns themselves are the same for parallel hessians.
+        forwRequest.ParallelColumns = false;
         if (request.Mode == DiffMode::hessian_diagonal)
           forwRequest.RequestedDerivativeOrder = 2;
         for (const auto& dParam : request.DVI) {
@@ -1472,6 +1834,7 @@ static QualType GetDerivedFunctionType(const CallExpr* CE) {
     request.Mode = DiffMode::pullback;
     request.VerboseDiags = false;
     request.EnableTBRAnalysis = m_TopMostReq->EnableTBRAnalysis;
+    request.EnableTBRSummaries = m_TopMostReq->EnableTBRSummaries;
     request.EnableVariedAnalysis = m_TopMostReq->EnableVariedAnalysis;
 
     for (const auto* paramDecl : CD->parameters())
@@ -1493,20 +1856,10 @@ static QualType GetDerivedFunctionType(const CallExpr* CE) {
       return true;
 
     if (!LookupCustomDerivativeDecl(request)) {
-      clang::CFG::BuildOptions Options;
-      std::unique_ptr<AnalysisDeclContext> AnalysisDC =
-          std::make_unique<AnalysisDeclContext>(
-              /*AnalysisDeclContextManager=*/nullptr, request.Function,
-              Options);
-      if (request.EnableVariedAnalysis) {
-        TimedAnalysisRegion R("VA " + request.BaseFunctionName);
-        VariedAnalyzer analyzer(AnalysisDC.get(), request,
-                                request.getVariedStmt());
-        analyzer.Analyze();
-      }
+      if (request.EnableVariedAnalysis)
+        m_AnalysisManager.runVariedAnalysis(request);
       // FIXME: Add proper support for objects in VA and UA.
-      m_AllAnalysisDC.push_back(std::move(AnalysisDC));
-      request.m_AnalysisDC = m_AllAnalysisDC.back().get();
+      request.m_AnalysisDC = m_AnalysisManager.getAnalysisDC(request.Function);
 
       // Recurse into call graph.
       TraverseFunctionDeclOnce(request.Function);
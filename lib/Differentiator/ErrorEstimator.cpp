@@ -5,6 +5,8 @@
 #include "clad/Differentiator/DiffPlanner.h"
 #include "clad/Differentiator/ReverseModeVisitor.h"
 
+#include "ConstantFolder.h"
+
 #include "clang/AST/Decl.h"
 #include "clang/AST/DeclarationName.h"
 #include "clang/AST/Expr.h"
@@ -17,6 +19,7 @@
 
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
 
 #include <limits>
 #include <string>
@@ -47,14 +50,48 @@ void ErrorEstimationHandler::BuildReturnErrorStmt() {
                                 m_RMV->m_Context.DoubleTy, noLoc);
     Expr* finExpr = AssignError(StmtDiff(m_RetErrorExpr, flitr), "return_expr");
     m_RMV->addToCurrentBlock(
-        m_RMV->BuildOp(BO_AddAssign, BuildFinalErrorExpr(), finExpr),
+        BuildAddErrorStmt(finExpr, /*VD=*/nullptr, "return_expr"),
         direction::forward);
   }
 }
 
-void ErrorEstimationHandler::AddErrorStmtToBlock(Expr* errorExpr) {
-  Expr* FinalError = BuildFinalErrorExpr();
-  Stmt* errorStmt = m_RMV->BuildOp(BO_AddAssign, FinalError, errorExpr);
+unsigned ErrorEstimationHandler::GetSlot(const VarDecl* VD,
+                                         const std::string& name) {
+  unsigned newSlot = m_SlotNames.size();
+  unsigned slot = VD ? m_VarSlots.try_emplace(VD, newSlot).first->second
+                     : m_NamedSlots.try_emplace(name, newSlot).first->second;
+  if (slot == newSlot)
+    m_SlotNames.push_back(name);
+  return slot;
+}
+
+Stmt* ErrorEstimationHandler::BuildAddErrorStmt(Expr* errorExpr,
+                                                const VarDecl* VD,
+                                                const std::string& name) {
+  if (!m_UseAccumulator)
+    return m_RMV->BuildOp(BO_AddAssign, BuildFinalErrorExpr(), errorExpr);
+  ASTContext& C = m_RMV->m_Context;
+  auto buildSlot = [&]() {
+    return ConstantFolder::synthesizeLiteral(C.IntTy, C, GetSlot(VD, name));
+  };
+  // Only loops are sampled, the other statements run once per call anyway.
+  bool sampled = m_RMV->isInsideLoop || m_RMV->m_IsInsideCheckpointedLoop;
+  llvm::SmallVector<Expr*, 2> addArgs{buildSlot(), errorExpr};
+  Stmt* addStmt = m_RMV->BuildCallExprToMemFn(
+      BuildFinalErrorExpr(), sampled ? "add_sample" : "add", addArgs);
+  if (!sampled)
+    return addStmt;
+  llvm::SmallVector<Expr*, 1> sampleArgs{buildSlot()};
+  Expr* cond =
+      m_RMV->BuildCallExprToMemFn(BuildFinalErrorExpr(), "sample", sampleArgs);
+  return clad_compat::IfStmt_Create(C, noLoc, /*IsConstexpr=*/false,
+                                    /*Init=*/nullptr, /*Var=*/nullptr, cond,
+                                    noLoc, noLoc, addStmt);
+}
+
+void ErrorEstimationHandler::AddErrorStmtToBlock(Expr* errorExpr,
+                                                 const VarDecl* VD) {
+  Stmt* errorStmt = BuildAddErrorStmt(errorExpr, VD, VD->getNameAsString());
   auto& block = m_RMV->getCurrentBlock(direction::reverse);
   block.insert(block.begin(), errorStmt);
 }
@@ -104,11 +141,10 @@ void ErrorEstimationHandler::EmitNestedFunctionParamError(
     // if (utils::IsReferenceOrPointerType(fnDecl->getParamDecl(i)->getType()))
     //   continue;
     auto* derefExpr = m_RMV->BuildOp(UO_Deref, ArgResult[i]);
-    Expr* errorExpr = AssignError({derivedCallArgs[i], derefExpr},
-                                  fnDecl->getNameInfo().getAsString() +
-                                      "_param_" + std::to_string(i));
-    Expr* FinalError = BuildFinalErrorExpr();
-    Expr* errorStmt = m_RMV->BuildOp(BO_AddAssign, FinalError, errorExpr);
+    std::string name =
+        fnDecl->getNameInfo().getAsString() + "_param_" + std::to_string(i);
+    Expr* errorExpr = AssignError({derivedCallArgs[i], derefExpr}, name);
+    Stmt* errorStmt = BuildAddErrorStmt(errorExpr, /*VD=*/nullptr, name);
     m_ReverseErrorStmts.push_back(errorStmt);
   }
 }
@@ -174,7 +210,7 @@ void ErrorEstimationHandler::EmitFinalErrorStmts(
         auto* errorExpr = GetError(paramClone, m_RMV->m_Variables[decl],
                                    params[i]->getNameAsString());
         m_RMV->addToCurrentBlock(
-            m_RMV->BuildOp(BO_AddAssign, BuildFinalErrorExpr(), errorExpr));
+            BuildAddErrorStmt(errorExpr, decl, params[i]->getNameAsString()));
       } else {
         auto LdiffExpr = m_RMV->m_Variables[decl];
         Expr* size = getSizeExpr(decl);
@@ -192,8 +228,8 @@ void ErrorEstimationHandler::EmitFinalErrorStmts(
         auto* LRepl = m_RMV->BuildArraySubscript(paramClone, m_IdxExpr);
         // Build the loop to put in reverse mode.
         Expr* errorExpr = GetError(LRepl, Ldiff, params[i]->getNameAsString());
-        Expr* finalAssignExpr =
-            m_RMV->BuildOp(BO_AddAssign, BuildFinalErrorExpr(), errorExpr);
+        Stmt* finalAssignExpr =
+            BuildAddErrorStmt(errorExpr, decl, params[i]->getNameAsString());
         Expr* conditionExpr = m_RMV->BuildOp(BO_LE, m_IdxExpr, size);
         Expr* incExpr = m_RMV->BuildOp(UO_PostInc, m_IdxExpr);
         Stmt* ArrayParamLoop = new (m_RMV->m_Context)
@@ -222,10 +258,10 @@ void ErrorEstimationHandler::EmitUnaryOpErrorStmts(StmtDiff var,
   if (DeclRefExpr* DRE = GetUnderlyingDeclRefOrNull(var.getExpr())) {
     // First check if it was registered.
     // If not, we don't care about it.
-    if (ShouldEstimateErrorFor(cast<VarDecl>(DRE->getDecl()))) {
-      Expr* erroExpr =
-          GetError(DRE, var.getExpr_dx(), DRE->getDecl()->getNameAsString());
-      AddErrorStmtToBlock(erroExpr);
+    auto* VD = cast<VarDecl>(DRE->getDecl());
+    if (ShouldEstimateErrorFor(VD)) {
+      Expr* erroExpr = GetError(DRE, var.getExpr_dx(), VD->getNameAsString());
+      AddErrorStmtToBlock(erroExpr, VD);
     }
   }
 }
@@ -233,13 +269,13 @@ void ErrorEstimationHandler::EmitUnaryOpErrorStmts(StmtDiff var,
 void ErrorEstimationHandler::EmitBinaryOpErrorStmts(Expr* LExpr,
                                                     Expr* oldValue) {
   // Assign the error.
-  auto decl = GetUnderlyingDeclRefOrNull(LExpr)->getDecl();
-  if (!ShouldEstimateErrorFor(cast<VarDecl>(decl)))
+  auto* decl = cast<VarDecl>(GetUnderlyingDeclRefOrNull(LExpr)->getDecl());
+  if (!ShouldEstimateErrorFor(decl))
     return;
   if (m_ErrorFromFunctionCall)
     return;
   Expr* errorExpr = GetError(LExpr, oldValue, decl->getNameAsString());
-  AddErrorStmtToBlock(errorExpr);
+  AddErrorStmtToBlock(errorExpr, decl);
   // If there are assign statements to emit in reverse, do that.
   EmitErrorEstimationStmts(direction::reverse);
 }
@@ -260,13 +296,14 @@ void ErrorEstimationHandler::EmitDeclErrorStmts(DeclDiff<VarDecl> VDDiff,
       Expr* errorExpr =
           GetError(VDRef, m_RMV->BuildDeclRef(VDDiff.getDecl_dx()),
                    VD->getNameAsString());
-      AddErrorStmtToBlock(errorExpr);
+      AddErrorStmtToBlock(errorExpr, VD);
     }
   }
 }
 
 void ErrorEstimationHandler::InitialiseRMV(ReverseModeVisitor& RMV) {
   m_RMV = &RMV;
+  m_UseAccumulator = RMV.m_DiffReq.UseErrorAccumulator;
   LookupCustomErrorFunction();
 }
 
@@ -283,7 +320,10 @@ void ErrorEstimationHandler::ActAfterCreatingDerivedFnParams(
   // If in error estimation mode, create the error parameter
   ASTContext& C = m_RMV->m_Context;
   // Repeat the above but for the error ouput var "_final_error"
-  QualType LastParamTy = C.getLValueReferenceType(C.DoubleTy);
+  QualType errorTy = m_UseAccumulator
+                         ? utils::GetErrorAccumulatorType(m_RMV->m_Sema)
+                         : C.DoubleTy;
+  QualType LastParamTy = C.getLValueReferenceType(errorTy);
   ParmVarDecl* errorVarDecl = ParmVarDecl::Create(
       C, m_RMV->m_Derivative, noLoc, noLoc, &C.Idents.get("_final_error"),
       LastParamTy, C.getTrivialTypeSourceInfo(LastParamTy, noLoc),
@@ -297,6 +337,14 @@ void ErrorEstimationHandler::ActOnEndOfDerivedFnBody() {
   // Since 'return' is not an assignment, add its error to _final_error
   // given it is not a DeclRefExpr.
   EmitFinalErrorStmts(*m_Params, m_RMV->m_DiffReq->getNumParams());
+  if (!m_UseAccumulator || m_SlotNames.empty())
+    return;
+  // Name the slots so that the accumulator can report the variables.
+  std::string names = llvm::join(m_SlotNames, ",");
+  llvm::SmallVector<Expr*, 1> args{
+      utils::CreateStringLiteral(m_RMV->m_Context, names)};
+  m_RMV->addToCurrentBlock(
+      m_RMV->BuildCallExprToMemFn(BuildFinalErrorExpr(), "set_names", args));
 }
 
 void ErrorEstimationHandler::ActBeforeDifferentiatingStmtInVisitCompoundStmt() {
@@ -450,7 +498,18 @@ void ErrorEstimationHandler::ActBeforeFinalizingDifferentiateSingleExpr(
 void ErrorEstimationHandler::ActBeforeDifferentiatingCallExpr(
     llvm::SmallVectorImpl<clang::Expr*>& pullbackArgs) {
   m_ErrorFromFunctionCall = true;
-  pullbackArgs.push_back(BuildFinalErrorExpr());
+  if (!m_UseAccumulator) {
+    pullbackArgs.push_back(BuildFinalErrorExpr());
+    return;
+  }
+  // The callees estimate their errors into a double, here into the slot of
+  // the calls of the accumulator.
+  ASTContext& C = m_RMV->m_Context;
+  unsigned slot = GetSlot(/*VD=*/nullptr, "function_calls");
+  llvm::SmallVector<Expr*, 1> args{
+      ConstantFolder::synthesizeLiteral(C.IntTy, C, slot)};
+  pullbackArgs.push_back(
+      m_RMV->BuildCallExprToMemFn(BuildFinalErrorExpr(), "at", args));
 }
 
 void ErrorEstimationHandler::LookupCustomErrorFunction() {
@@ -6,6 +6,8 @@
 
 #include "clad/Differentiator/HessianModeVisitor.h"
 
+#include "ConstantFolder.h"
+
 #include "clad/Differentiator/CladUtils.h"
 #include "clad/Differentiator/Compatibility.h"
 #include "clad/Differentiator/DiffPlanner.h"
@@ -46,6 +48,7 @@ static FunctionDecl* DeriveUsingForwardAndReverseMode(
   IndependentArgRequest.Args = ForwardModeArgs;
   IndependentArgRequest.Mode = DiffMode::forward;
   IndependentArgRequest.CallUpdateRequired = false;
+  IndependentArgRequest.ParallelColumns = false;
   // FIXME: Find a way to do this without accessing plugin namespace functions
   IndependentArgRequest.UpdateDiffParamsInfo(SemaRef);
   FunctionDecl* firstDerivative =
@@ -83,6 +86,24 @@ static FunctionDecl* DeriveUsingForwardModeTwice(
 
 DerivativeAndOverload HessianModeVisitor::Derive() {
   const FunctionDecl* FD = m_DiffReq.Function;
+  // Hessian-vector products differentiate the pushforward of the function
+  // once instead of one derivative per column.
+  bool usesPushforwardPullback =
+      m_DiffReq.Mode == DiffMode::hessian_vector_product;
+  // Parallel hessians pass the columns to clad::parallel_columns as plain
+  // function pointers.
+  if (usesPushforwardPullback || m_DiffReq.ParallelColumns) {
+    if (const auto* MD = dyn_cast<CXXMethodDecl>(FD)) {
+      if (MD->isInstance()) {
+        SourceLocation L = MD->getLocation();
+        diag(DiagnosticsEngine::Error, L,
+             "%select{hessian-vector products|parallel hessians}0 of "
+             "non-static member functions are not supported yet")
+            << m_DiffReq.ParallelColumns << L;
+        return {};
+      }
+    }
+  }
   DiffParams args{};
   IndexIntervalTable indexIntervalTable{};
   if (m_DiffReq.Args)
@@ -100,6 +121,12 @@ DerivativeAndOverload HessianModeVisitor::Derive() {
   std::string hessianFuncName = m_DiffReq.BaseFunctionName + "_hessian";
   if (m_DiffReq.Mode == DiffMode::hessian_diagonal)
     hessianFuncName += "_diagonal";
+  else if (m_DiffReq.Mode == DiffMode::hessian_vector_product)
+    hessianFuncName += "_vector_product";
+  else if (m_DiffReq.ParallelColumns)
+    hessianFuncName += "_parallel";
+  else if (m_DiffReq.Mode == DiffMode::hessian_packed)
+    hessianFuncName += "_packed";
   // To be consistent with older tests, nothing is appended to 'f_hessian' if
   // we differentiate w.r.t. all the parameters at once.
   if (args.size() != FD->getNumParams() ||
@@ -120,6 +147,39 @@ DerivativeAndOverload HessianModeVisitor::Derive() {
   // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
   auto* DC = const_cast<DeclContext*>(m_DiffReq->getDeclContext());
 
+  // Packed hessians only store the entries of a row from the diagonal on, so
+  // the reverse pass of a row is restricted to the requested parameters
+  // starting from the one of the row.
+  auto getReverseModeArgs = [&](const ParmVarDecl* rowPVD) -> const Expr* {
+    if (m_DiffReq.Mode != DiffMode::hessian_packed)
+      return m_DiffReq.Args;
+    std::string reverseModeArgs;
+    bool isTail = false;
+    bool isFirst = true;
+    for (const ParmVarDecl* PVD : FD->parameters()) {
+      auto it = std::find(args.begin(), args.end(), PVD);
+      if (it == args.end())
+        continue;
+      isTail |= PVD == rowPVD;
+      if (!isTail) {
+        isFirst = false;
+        continue;
+      }
+      if (!reverseModeArgs.empty())
+        reverseModeArgs += ", ";
+      reverseModeArgs += PVD->getNameAsString();
+      if (isArrayOrPointerType(PVD->getType())) {
+        const IndexInterval& interval = indexIntervalTable[it - args.begin()];
+        reverseModeArgs += "[" + std::to_string(interval.Start) + ":" +
+                           std::to_string(interval.Finish - 1) + "]";
+      }
+    }
+    // The first row shares its reverse pass with the full hessian.
+    if (isFirst)
+      return m_DiffReq.Args;
+    return utils::CreateStringLiteral(m_Context, reverseModeArgs);
+  };
+
   // Ascertains the independent arguments and differentiates the function
   // in forward and reverse mode by calling ProcessDiffRequest twice each
   // iteration, storing each generated second derivative function
@@ -169,6 +229,8 @@ DerivativeAndOverload HessianModeVisitor::Derive() {
 
         IndependentArgsSize.push_back(indexIntervalTable[argIndex].size());
         TotalIndependentArgsSize += indexIntervalTable[argIndex].size();
+        if (usesPushforwardPullback)
+          continue;
 
         // Derive the function w.r.t. to each requested index of the current
         // array in forward mode and then in reverse mode w.r.t to all
@@ -187,12 +249,14 @@ DerivativeAndOverload HessianModeVisitor::Derive() {
           else
             DFD = DeriveUsingForwardAndReverseMode(
                 m_Sema, m_CladPlugin, m_Builder, m_DiffReq, ForwardModeIASL,
-                m_DiffReq.Args, m_Builder.m_DFC);
+                getReverseModeArgs(PVD), m_Builder.m_DFC);
           secondDerivativeFuncs.push_back(DFD);
         }
       } else {
         IndependentArgsSize.push_back(1);
         TotalIndependentArgsSize++;
+        if (usesPushforwardPullback)
+          continue;
         // Derive the function w.r.t. to the current arg in forward mode and
         // then in reverse mode w.r.t to all requested args
         auto ForwardModeIASL =
@@ -205,16 +269,286 @@ DerivativeAndOverload HessianModeVisitor::Derive() {
         else
           DFD = DeriveUsingForwardAndReverseMode(
               m_Sema, m_CladPlugin, m_Builder, m_DiffReq, ForwardModeIASL,
-              m_DiffReq.Args, m_Builder.m_DFC);
+              getReverseModeArgs(PVD), m_Builder.m_DFC);
         secondDerivativeFuncs.push_back(DFD);
       }
     }
   }
+  if (m_DiffReq.Mode == DiffMode::hessian_vector_product)
+    return DeriveHessianVectorProduct(args, indexIntervalTable,
+                                      hessianFuncName, DC, hessianFunctionType);
   return Merge(secondDerivativeFuncs, IndependentArgsSize,
                TotalIndependentArgsSize, hessianFuncName, DC,
                hessianFunctionType);
 }
 
+FunctionDecl*
+HessianModeVisitor::DerivePushforwardPullback(const DiffParams& args) {
+  const FunctionDecl* FD = m_DiffReq.Function;
+  // The pushforward of f along the direction is scheduled by the planner.
+  DiffRequest pushforwardRequest = m_DiffReq;
+  pushforwardRequest.Mode = DiffMode::pushforward;
+  pushforwardRequest.CallUpdateRequired = false;
+  pushforwardRequest.Args = nullptr;
+  pushforwardRequest.UpdateDiffParamsInfo(m_Sema);
+  FunctionDecl* pushforwardFD =
+      m_Builder.FindDerivedFunction(pushforwardRequest);
+  if (!pushforwardFD)
+    return nullptr;
+
+  // The pullback of the pushforward w.r.t. the requested primal parameters
+  // seeded with {0, 1} yields H * v.
+  DiffRequest pullbackRequest{};
+  pullbackRequest.Mode = DiffMode::pullback;
+  pullbackRequest.Function = pushforwardFD;
+  pullbackRequest.BaseFunctionName = pushforwardFD->getNameAsString();
+  for (unsigned i = 0, e = FD->getNumParams(); i < e; ++i)
+    if (std::find(args.begin(), args.end(), FD->getParamDecl(i)) != args.end())
+      pullbackRequest.DVI.push_back(pushforwardFD->getParamDecl(i));
+  return m_Builder.HandleNestedDiffRequest(pullbackRequest);
+}
+
+DerivativeAndOverload HessianModeVisitor::DeriveHessianVectorProduct(
+    const DiffParams& args, const IndexIntervalTable& indexIntervalTable,
+    const std::string& hvpFuncName, DeclContext* DC, QualType hvpFuncType) {
+  const FunctionDecl* FD = m_DiffReq.Function;
+  // The direction of an array parameter which is not requested in full is
+  // masked in a local array, so its size has to be known at compile time.
+  for (const ParmVarDecl* PVD : FD->parameters()) {
+    if (!utils::IsDifferentiableType(PVD->getType()) ||
+        !utils::isArrayOrPointerType(PVD->getType()) ||
+        isa<ConstantArrayType>(PVD->getOriginalType()))
+      continue;
+    auto it = std::find(args.begin(), args.end(), PVD);
+    if (it != args.end() && indexIntervalTable[it - args.begin()].Start == 0)
+      continue;
+    diag(DiagnosticsEngine::Error, PVD->getBeginLoc(),
+         "hessian-vector products need the size of the array '%0' to restrict "
+         "the direction to the requested parameters; request '%0' from index "
+         "0 or declare it as an array of constant size")
+        << PVD->getNameAsString();
+    return {};
+  }
+
+  FunctionDecl* pullbackFD = DerivePushforwardPullback(args);
+  if (!pullbackFD)
+    return {};
+
+  llvm::SaveAndRestore<DeclContext*> SaveContext(m_Sema.CurContext);
+  llvm::SaveAndRestore<Scope*> SaveScope(getCurrentScope(),
+                                         getEnclosingNamespaceOrTUScope());
+  m_Sema.CurContext = DC;
+
+  IdentifierInfo* II = &m_Context.Idents.get(hvpFuncName);
+  DeclarationNameInfo name(II, noLoc);
+  DeclWithContext result =
+      m_Builder.cloneFunction(FD, *this, DC, noLoc, name, hvpFuncType);
+  FunctionDecl* hvpFD = result.first;
+
+  beginScope(Scope::FunctionPrototypeScope | Scope::FunctionDeclarationScope |
+             Scope::DeclScope);
+  m_Sema.PushFunctionScope();
+  m_Sema.PushDeclContext(getCurrentScope(), hvpFD);
+
+  // f_hessian_vector_product(params..., _d_params..., hvp)
+  llvm::SmallVector<ParmVarDecl*, 8> params;
+  llvm::SmallVector<ParmVarDecl*, 8> dParams;
+  for (const ParmVarDecl* PVD : FD->parameters()) {
+    params.push_back(CloneParmVarDecl(PVD, PVD->getIdentifier(),
+                                      /*pushOnScopeChains=*/false,
+                                      /*cloneDefaultArg=*/false));
+    IdentifierInfo* dII = &m_Context.Idents.get("_d_" + PVD->getNameAsString());
+    dParams.push_back(utils::BuildParmVarDecl(m_Sema, hvpFD, dII,
+                                              PVD->getType(),
+                                              PVD->getStorageClass()));
+  }
+  QualType outputTy =
+      cast<FunctionProtoType>(hvpFuncType)->getParamTypes().back();
+  ParmVarDecl* hvpPVD = utils::BuildParmVarDecl(
+      m_Sema, hvpFD, &m_Context.Idents.get("hvp"), outputTy);
+  llvm::SmallVector<ParmVarDecl*, 16> allParams(params.begin(), params.end());
+  allParams.append(dParams.begin(), dParams.end());
+  allParams.push_back(hvpPVD);
+  for (ParmVarDecl* PVD : allParams)
+    if (PVD->getIdentifier())
+      m_Sema.PushOnScopeChains(PVD, getCurrentScope(), /*AddToContext=*/false);
+  hvpFD->setParams(allParams);
+
+  beginScope(Scope::FnScope | Scope::DeclScope);
+  m_DerivativeFnScope = getCurrentScope();
+
+  QualType sizeTy = m_Context.getSizeType();
+  auto buildSizeLiteral = [&](size_t val) -> Expr* {
+    llvm::APInt value(m_Context.getIntWidth(sizeTy), val);
+    return IntegerLiteral::Create(m_Context, value, sizeTy, noLoc);
+  };
+
+  // The direction of the parameters which are not requested is zero, and so
+  // are the entries of arrays outside of the requested interval. Arrays which
+  // are not requested in full get a masked copy of their direction and a
+  // local adjoint, whose requested interval is added to hvp afterwards.
+  llvm::SmallVector<Stmt*, 16> stmts;
+  llvm::SmallVector<Expr*, 8> directions;
+  llvm::SmallVector<Expr*, 8> adjoints;
+  llvm::SmallVector<Stmt*, 4> updates;
+  size_t offset = 0;
+  for (unsigned i = 0, e = params.size(); i < e; ++i) {
+    const ParmVarDecl* PVD = FD->getParamDecl(i);
+    if (!utils::IsDifferentiableType(PVD->getType()))
+      continue;
+    auto it = std::find(args.begin(), args.end(), PVD);
+    bool isRequested = it != args.end();
+    QualType valueTy = utils::GetNonConstValueType(PVD->getType());
+    if (!utils::isArrayOrPointerType(PVD->getType())) {
+      if (!isRequested) {
+        directions.push_back(
+            ConstantFolder::synthesizeLiteral(valueTy, m_Context, /*val=*/0));
+        continue;
+      }
+      directions.push_back(BuildDeclRef(dParams[i]));
+      adjoints.push_back(BuildOp(BO_Add, BuildDeclRef(hvpPVD),
+                                 buildSizeLiteral(offset)));
+      offset += 1;
+      continue;
+    }
+
+    IndexInterval interval;
+    if (isRequested)
+      interval = indexIntervalTable[it - args.begin()];
+    const auto* CAT = dyn_cast<ConstantArrayType>(PVD->getOriginalType());
+    bool isFull = isRequested && interval.Start == 0 &&
+                  (!CAT || interval.Finish == CAT->getSize().getZExtValue());
+    if (isFull) {
+      directions.push_back(BuildDeclRef(dParams[i]));
+      adjoints.push_back(BuildOp(BO_Add, BuildDeclRef(hvpPVD),
+                                 buildSizeLiteral(offset)));
+      offset += interval.size();
+      continue;
+    }
+
+    size_t arraySize = CAT->getSize().getZExtValue();
+    QualType arrayTy = utils::GetCladArrayOfType(m_Sema, valueTy);
+    auto buildZeroVector = [&]() {
+      llvm::SmallVector<Expr*, 1> zeroArgs = {buildSizeLiteral(arraySize)};
+      return BuildCallExprToCladFunction("zero_vector", zeroArgs, {valueTy},
+                                         noLoc);
+    };
+
+    // clad::array<T> _v_x = clad::masked_vector(_d_x, size, start, finish);
+    Expr* direction = nullptr;
+    if (isRequested) {
+      llvm::SmallVector<Expr*, 4> maskArgs = {
+          BuildDeclRef(dParams[i]), buildSizeLiteral(arraySize),
+          buildSizeLiteral(interval.Start), buildSizeLiteral(interval.Finish)};
+      direction = BuildCallExprToCladFunction("masked_vector", maskArgs,
+                                              {valueTy}, noLoc);
+    } else {
+      direction = buildZeroVector();
+    }
+    VarDecl* directionVD =
+        BuildVarDecl(arrayTy, "_v_" + PVD->getNameAsString(), direction);
+    stmts.push_back(BuildDeclStmt(directionVD));
+    directions.push_back(BuildDeclRef(directionVD));
+    if (!isRequested)
+      continue;
+
+    // clad::array<T> _h_x = clad::zero_vector(size);
+    VarDecl* adjointVD = BuildVarDecl(
+        arrayTy, "_h_" + PVD->getNameAsString(), buildZeroVector());
+    stmts.push_back(BuildDeclStmt(adjointVD));
+    adjoints.push_back(BuildDeclRef(adjointVD));
+
+    // clad::add_interval(hvp + offset, _h_x, start, finish);
+    llvm::SmallVector<Expr*, 4> addArgs = {
+        BuildOp(BO_Add, BuildDeclRef(hvpPVD), buildSizeLiteral(offset)),
+        BuildDeclRef(adjointVD), buildSizeLiteral(interval.Start),
+        buildSizeLiteral(interval.Finish)};
+    updates.push_back(
+        BuildCallExprToCladFunction("add_interval", addArgs, {valueTy}, noLoc));
+    offset += interval.size();
+  }
+
+  // Primal arguments and the direction, as expected by the pushforward.
+  llvm::SmallVector<Expr*, 16> callArgs;
+  for (ParmVarDecl* PVD : params)
+    callArgs.push_back(BuildDeclRef(PVD));
+  callArgs.append(directions.begin(), directions.end());
+
+  // The seed {0, 1} selects the pushforward component of the result.
+  QualType returnTy = FD->getReturnType();
+  llvm::SmallVector<Expr*, 2> seed = {
+      ConstantFolder::synthesizeLiteral(returnTy, m_Context, /*val=*/0),
+      ConstantFolder::synthesizeLiteral(returnTy, m_Context, /*val=*/1)};
+  callArgs.push_back(m_Sema.ActOnInitList(noLoc, seed, noLoc).get());
+
+  // The adjoints of the requested parameters are accumulated into
+  // consecutive slices of hvp.
+  callArgs.append(adjoints.begin(), adjoints.end());
+  stmts.push_back(BuildCallExprToFunction(pullbackFD, callArgs));
+  stmts.append(updates.begin(), updates.end());
+
+  CompoundStmt* CS = clad_compat::CompoundStmt_Create(
+      m_Context, stmts /**/ CLAD_COMPAT_CLANG15_CompoundStmt_Create_ExtraParam2(
+                     clang::FPOptionsOverride()),
+      noLoc, noLoc);
+  hvpFD->setBody(CS);
+  endScope(); // Function body scope
+  m_Sema.PopFunctionScopeInfo();
+  m_Sema.PopDeclContext();
+  endScope(); // Function decl scope
+
+  return DerivativeAndOverload{hvpFD, /*OverloadFunctionDecl=*/nullptr};
+}
+
+void HessianModeVisitor::BuildParallelColumnsDispatch(
+    llvm::ArrayRef<FunctionDecl*> columns,
+    llvm::ArrayRef<size_t> IndependentArgsSize,
+    llvm::ArrayRef<ParmVarDecl*> params, std::vector<Stmt*>& stmts) {
+  // All the columns share the signature (params..., slices...), so they are
+  // collected in an array of function pointers.
+  llvm::SmallVector<Expr*, 16> columnRefs;
+  for (FunctionDecl* column : columns)
+    columnRefs.push_back(BuildDeclRef(column));
+  QualType columnTy = m_Context.getPointerType(columns.front()->getType());
+  auto buildArrayType = [&](QualType elemTy, size_t size) {
+    Expr* sizeExpr =
+        ConstantFolder::synthesizeLiteral(m_Context.IntTy, m_Context, size);
+    return clad_compat::getConstantArrayType(
+        m_Context, elemTy,
+        llvm::APInt(m_Context.getTargetInfo().getIntWidth(), size),
+        /*SizeExpr=*/sizeExpr,
+        /*ASM=*/clad_compat::ArraySizeModifier_Normal,
+        /*IndexTypeQuals*/ 0);
+  };
+  VarDecl* columnsVD =
+      BuildVarDecl(buildArrayType(columnTy, columns.size()), "_columns",
+                   m_Sema.ActOnInitList(noLoc, columnRefs, noLoc).get());
+  stmts.push_back(BuildDeclStmt(columnsVD));
+
+  // The offsets of the slices of each requested parameter within a row.
+  QualType sizeTy = m_Context.getSizeType();
+  llvm::SmallVector<Expr*, 8> offsets;
+  size_t offset = 0;
+  for (size_t argSize : IndependentArgsSize) {
+    llvm::APInt offsetValue(m_Context.getIntWidth(sizeTy), offset);
+    offsets.push_back(
+        IntegerLiteral::Create(m_Context, offsetValue, sizeTy, noLoc));
+    offset += argSize;
+  }
+  VarDecl* offsetsVD =
+      BuildVarDecl(buildArrayType(sizeTy, offsets.size()), "_offsets",
+                   m_Sema.ActOnInitList(noLoc, offsets, noLoc).get());
+  stmts.push_back(BuildDeclStmt(offsetsVD));
+
+  // clad::parallel_columns(_columns, hessianMatrix, _offsets, params...)
+  llvm::SmallVector<Expr*, 16> callArgs = {BuildDeclRef(columnsVD),
+                                           BuildDeclRef(params.back()),
+                                           BuildDeclRef(offsetsVD)};
+  for (ParmVarDecl* PVD : params.drop_back())
+    callArgs.push_back(BuildDeclRef(PVD));
+  stmts.push_back(GetFunctionCall("parallel_columns", "clad", callArgs));
+}
+
   // Combines all generated second derivative functions into a
   // single hessian function by creating CallExprs to each individual
   // secon derivative function in FunctionBody.
@@ -275,6 +609,8 @@ DerivativeAndOverload HessianModeVisitor::Derive() {
     std::string outputParamName = "hessianMatrix";
     if (m_DiffReq.Mode == DiffMode::hessian_diagonal)
       outputParamName = "diagonalHessianVector";
+    else if (m_DiffReq.Mode == DiffMode::hessian_packed)
+      outputParamName = "packedHessian";
     params.back() = ParmVarDecl::Create(
         m_Context, hessianFD, noLoc, noLoc,
         &m_Context.Idents.get(outputParamName), paramTypes.back(),
@@ -296,6 +632,35 @@ DerivativeAndOverload HessianModeVisitor::Derive() {
     beginScope(Scope::FnScope | Scope::DeclScope);
     m_DerivativeFnScope = getCurrentScope();
 
+    // Parallel hessians hand all the columns to clad::parallel_columns instead
+    // of calling them one after another.
+    if (m_DiffReq.ParallelColumns) {
+      BuildParallelColumnsDispatch(secDerivFuncs, IndependentArgsSize, params,
+                                   CompStmtSave);
+      secDerivFuncs.clear();
+    }
+
+    // Packed hessians compute each row into a temporary and only keep its
+    // upper part.
+    VarDecl* rowVD = nullptr;
+    if (m_DiffReq.Mode == DiffMode::hessian_packed) {
+      QualType elemTy = utils::GetNonConstValueType(paramTypes.back());
+      Expr* size = ConstantFolder::synthesizeLiteral(
+          m_Context.IntTy, m_Context, TotalIndependentArgsSize);
+      QualType rowTy = clad_compat::getConstantArrayType(
+          m_Context, elemTy,
+          llvm::APInt(m_Context.getTargetInfo().getIntWidth(),
+                      TotalIndependentArgsSize),
+          /*SizeExpr=*/size,
+          /*ASM=*/clad_compat::ArraySizeModifier_Normal,
+          /*IndexTypeQuals*/ 0);
+      llvm::SmallVector<Expr*, 1> zero = {
+          ConstantFolder::synthesizeLiteral(elemTy, m_Context, /*val=*/0)};
+      rowVD = BuildVarDecl(rowTy, "_row",
+                           m_Sema.ActOnInitList(noLoc, zero, noLoc).get());
+      CompStmtSave.push_back(BuildDeclStmt(rowVD));
+    }
+
     // Creates callExprs to the second derivative functions genereated
     // and creates maps array elements to input array.
     for (size_t i = 0, e = secDerivFuncs.size(); i < e; ++i) {
@@ -357,6 +722,37 @@ DerivativeAndOverload HessianModeVisitor::Derive() {
         Expr* DerefExpr = BuildOp(UO_Deref, BuildParens(SliceExprLHS));
         Expr* AssignExpr = BuildOp(BO_Assign, DerefExpr, call);
         CompStmtSave.push_back(AssignExpr);
+      } else if (m_DiffReq.Mode == DiffMode::hessian_packed) {
+        // The reverse pass of the row i only has the adjoints of the requested
+        // parameters from the one of the row on.
+        size_t firstArg = 0;
+        size_t columnIndex = 0;
+        while (columnIndex + IndependentArgsSize[firstArg] <= i)
+          columnIndex += IndependentArgsSize[firstArg++];
+        for (size_t j = firstArg, e = IndependentArgsSize.size(); j < e; ++j) {
+          llvm::APInt offsetValue(size_type_bits, columnIndex);
+          Expr* OffsetArg =
+              IntegerLiteral::Create(m_Context, offsetValue, size_type, noLoc);
+          DeclRefToParams.push_back(
+              BuildOp(BO_Add, BuildDeclRef(rowVD), OffsetArg));
+          columnIndex += IndependentArgsSize[j];
+        }
+        Expr* call = BuildCallExprToFunction(secDerivFuncs[i], DeclRefToParams,
+                                             /*CUDAExecConfig=*/nullptr,
+                                             /*UseRefQualifiedThisObj=*/true);
+        CompStmtSave.push_back(call);
+
+        // clad::pack_upper_row(packedHessian, _row, n, i)
+        llvm::SmallVector<Expr*, 4> packArgs = {
+            BuildDeclRef(params.back()), BuildDeclRef(rowVD),
+            IntegerLiteral::Create(
+                m_Context,
+                llvm::APInt(size_type_bits, TotalIndependentArgsSize),
+                size_type, noLoc),
+            IntegerLiteral::Create(m_Context, llvm::APInt(size_type_bits, i),
+                                   size_type, noLoc)};
+        CompStmtSave.push_back(
+            GetFunctionCall("pack_upper_row", "clad", packArgs));
       } else {
         const size_t HessianMatrixStartIndex = i * TotalIndependentArgsSize;
         size_t columnIndex = 0;
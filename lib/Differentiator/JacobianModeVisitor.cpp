@@ -2,9 +2,16 @@
 
 #include "ConstantFolder.h"
 #include "clad/Differentiator/CladUtils.h"
+#include "clad/Differentiator/Compatibility.h"
 #include "clad/Differentiator/DerivativeBuilder.h"
+#include "clad/Differentiator/DiffPlanner.h"
 
 #include "llvm/Support/SaveAndRestore.h"
+#include "llvm/Support/TimeProfiler.h"
+
+#include <algorithm>
+#include <iterator>
+#include <string>
 
 using namespace clang;
 
@@ -17,12 +24,32 @@ DerivativeAndOverload JacobianModeVisitor::Derive() {
   const FunctionDecl* FD = m_DiffReq.Function;
   assert(m_DiffReq.Mode == DiffMode::jacobian);
 
+  if (m_DiffReq.ReverseJacobian || m_DiffReq.AutoJacobian)
+    return DeriveReverseJacobian();
+
   DiffParams args{};
   for (const DiffInputVarInfo& dParam : m_DiffReq.DVI)
     args.push_back(dParam.param);
 
+  // The compressed jacobian takes its seed directions from the matrices of the
+  // independent arrays, there is no way to seed scalar parameters.
+  if (m_DiffReq.CompressedJacobian) {
+    for (const ValueDecl* arg : args) {
+      if (utils::isArrayOrPointerType(arg->getType()))
+        continue;
+      SourceLocation L = arg->getLocation();
+      diag(DiagnosticsEngine::Error, L,
+           "sparse jacobians support only array or pointer independent "
+           "parameters; '%0' is a scalar")
+          << arg->getName() << L;
+      return {};
+    }
+  }
+
   // Generate name for the derivative function.
   std::string derivedFnName = m_DiffReq.BaseFunctionName + "_jac";
+  if (m_DiffReq.CompressedJacobian)
+    derivedFnName += "_compressed";
   if (args.size() != FD->getNumParams()) {
     for (const ValueDecl* arg : args) {
       const auto* it = std::find(FD->param_begin(), FD->param_end(), arg);
@@ -96,7 +123,14 @@ DerivativeAndOverload JacobianModeVisitor::Derive() {
       Expr* getSize = BuildCallExprToMemFn(BuildDeclRef(derivedPVD),
                                            /*MemberFunctionName=*/"rows", {});
       llvm::StringRef PVDName = PVD->getName();
-      if (!PVDName.contains("_clad_out_")) {
+      if (m_DiffReq.CompressedJacobian) {
+        // The number of seed directions is the number of columns of the
+        // caller-provided seed matrices.
+        if (!PVDName.contains("_clad_out_") && !m_IndVarCountExpr)
+          m_IndVarCountExpr =
+              BuildCallExprToMemFn(BuildDeclRef(derivedPVD),
+                                   /*MemberFunctionName=*/"cols", {});
+      } else if (!PVDName.contains("_clad_out_")) {
         if (!m_IndVarCountExpr)
           m_IndVarCountExpr = getSize;
         else
@@ -135,7 +169,7 @@ DerivativeAndOverload JacobianModeVisitor::Derive() {
       m_Context.UnsignedLongTy, m_Context, nonArrayIndVarCount);
   if (!m_IndVarCountExpr) {
     m_IndVarCountExpr = nonArrayIndVarCountExpr;
-  } else if (nonArrayIndVarCount != 0) {
+  } else if (nonArrayIndVarCount != 0 && !m_DiffReq.CompressedJacobian) {
     m_IndVarCountExpr = BuildOp(BinaryOperatorKind::BO_Add, m_IndVarCountExpr,
                                 nonArrayIndVarCountExpr);
   }
@@ -189,7 +223,20 @@ DerivativeAndOverload JacobianModeVisitor::Derive() {
         offsetExpr = BuildOp(BinaryOperatorKind::BO_Add, offsetExpr,
                              nonArrayIndVarCountExpr);
 
-      if (is_array) {
+      if (is_array && m_DiffReq.CompressedJacobian) {
+        // The seed matrix of an independent array is provided by the caller.
+        if (!param->getName().contains("_clad_out_")) {
+          ++independentVarIndex;
+          continue;
+        }
+        // The derivatives of the outputs start from zero.
+        Expr* base = cast<UnaryOperator>(paramDiff)->getSubExpr();
+        Expr* getSize = BuildCallExprToMemFn(Clone(base),
+                                             /*MemberFunctionName=*/"rows", {});
+        llvm::SmallVector<Expr*, 2> args = {getSize, m_IndVarCountExpr};
+        dVectorParam = BuildCallExprToCladFunction("zero_matrix", args,
+                                                   {dParamType}, loc);
+      } else if (is_array) {
         Expr* base = cast<UnaryOperator>(paramDiff)->getSubExpr();
         // Get size of the array.
         Expr* getSize = BuildCallExprToMemFn(Clone(base),
@@ -245,9 +292,13 @@ DerivativeAndOverload JacobianModeVisitor::Derive() {
   }
 
   // Traverse the function body and generate the derivative.
-  Stmt* BodyDiff = Visit(FD->getBody()).getStmt();
-  for (Stmt* S : cast<CompoundStmt>(BodyDiff)->body())
-    addToCurrentBlock(S);
+  {
+    llvm::TimeTraceScope TS("Differentiate body",
+                            [this]() { return (std::string)m_DiffReq; });
+    Stmt* BodyDiff = Visit(FD->getBody()).getStmt();
+    for (Stmt* S : cast<CompoundStmt>(BodyDiff)->body())
+      addToCurrentBlock(S);
+  }
 
   Stmt* vectorDiffBody = endBlock();
   m_Derivative->setBody(vectorDiffBody);
@@ -260,6 +311,139 @@ DerivativeAndOverload JacobianModeVisitor::Derive() {
   return DerivativeAndOverload{vectorDiffFD, overloadFD};
 }
 
+DerivativeAndOverload JacobianModeVisitor::DeriveReverseJacobian() {
+  const FunctionDecl* FD = m_DiffReq.Function;
+  auto isIndependent = [this](const ParmVarDecl* PVD) {
+    return std::any_of(m_DiffReq.DVI.begin(), m_DiffReq.DVI.end(),
+                       [PVD](const DiffInputVarInfo& dParam) {
+                         return dParam.param == PVD;
+                       });
+  };
+
+  // The rows are the adjoints of the independent variables in the pullback
+  // seeded with one entry of the outputs.
+  DiffRequest pullbackRequest{};
+  pullbackRequest.Mode = DiffMode::pullback;
+  pullbackRequest.Function = FD;
+  pullbackRequest.BaseFunctionName = m_DiffReq.BaseFunctionName;
+  for (const ParmVarDecl* PVD : FD->parameters())
+    if (isIndependent(PVD) || PVD->getName().contains("_clad_out_"))
+      pullbackRequest.DVI.push_back(PVD);
+  FunctionDecl* pullbackFD = m_Builder.HandleNestedDiffRequest(pullbackRequest);
+  if (!pullbackFD)
+    return {};
+
+  // The runtime dispatch falls back to the forward mode jacobian scheduled by
+  // the planner.
+  FunctionDecl* jacobianFD = nullptr;
+  if (m_DiffReq.AutoJacobian) {
+    DiffRequest jacobianRequest = m_DiffReq;
+    jacobianRequest.AutoJacobian = false;
+    jacobianRequest.CallUpdateRequired = false;
+    jacobianFD = FindDerivedFunction(jacobianRequest);
+    if (!jacobianFD)
+      return {};
+  }
+
+  std::string derivedFnName = m_DiffReq.BaseFunctionName + "_jac" +
+                              (m_DiffReq.AutoJacobian ? "_auto" : "_reverse");
+  if (m_DiffReq.DVI.size() != FD->getNumParams()) {
+    for (const DiffInputVarInfo& dParam : m_DiffReq.DVI) {
+      const auto* it =
+          std::find(FD->param_begin(), FD->param_end(), dParam.param);
+      derivedFnName +=
+          '_' + std::to_string(std::distance(FD->param_begin(), it));
+    }
+  }
+
+  // FIXME: We should not use const_cast to get the decl context here.
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+  auto* DC = const_cast<DeclContext*>(m_DiffReq->getDeclContext());
+  llvm::SaveAndRestore<DeclContext*> SaveContext(m_Sema.CurContext);
+  llvm::SaveAndRestore<Scope*> SaveScope(getCurrentScope(),
+                                         getEnclosingNamespaceOrTUScope());
+  m_Sema.CurContext = DC;
+
+  SourceLocation loc{m_DiffReq->getLocation()};
+  IdentifierInfo* II = &m_Context.Idents.get(derivedFnName);
+  DeclarationNameInfo name(II, loc);
+  DeclWithContext result =
+      m_Builder.cloneFunction(FD, *this, DC, loc, name, GetDerivativeType());
+  FunctionDecl* derivedFD = result.first;
+  m_Derivative = derivedFD;
+
+  beginScope(Scope::FunctionPrototypeScope | Scope::FunctionDeclarationScope |
+             Scope::DeclScope);
+  m_Sema.PushFunctionScope();
+  m_Sema.PushDeclContext(getCurrentScope(), derivedFD);
+
+  // The signature is the one of the forward mode jacobian.
+  llvm::SmallVector<ParmVarDecl*, 16> params;
+  llvm::SmallVector<ParmVarDecl*, 16> derivedParams;
+  llvm::SmallVector<ParmVarDecl*, 16> matrices;
+  for (const ParmVarDecl* PVD : FD->parameters()) {
+    params.push_back(CloneParmVarDecl(PVD, PVD->getIdentifier(),
+                                      /*pushOnScopeChains=*/true,
+                                      /*cloneDefaultArg=*/false));
+    ParmVarDecl* derivedPVD = nullptr;
+    if (utils::IsDifferentiableType(PVD->getType()) &&
+        utils::isArrayOrPointerType(PVD->getType())) {
+      IdentifierInfo* derivedPVDII =
+          CreateUniqueIdentifier("_d_vector_" + PVD->getNameAsString());
+      derivedPVD = utils::BuildParmVarDecl(
+          m_Sema, derivedFD, derivedPVDII,
+          utils::GetParameterDerivativeType(m_Sema, m_DiffReq.Mode,
+                                            PVD->getType()),
+          PVD->getStorageClass());
+      derivedParams.push_back(derivedPVD);
+    }
+    matrices.push_back(derivedPVD);
+  }
+  llvm::SmallVector<ParmVarDecl*, 16> allParams(params.begin(), params.end());
+  allParams.append(derivedParams.begin(), derivedParams.end());
+  derivedFD->setParams(
+      clad_compat::makeArrayRef(allParams.data(), allParams.size()));
+
+  beginScope(Scope::FnScope | Scope::DeclScope);
+  m_DerivativeFnScope = getCurrentScope();
+
+  // clad::reverse_jacobian(f_pullback, <params>...) or
+  // clad::auto_jacobian(f_jac, f_pullback, <params>...)
+  llvm::SmallVector<Expr*, 16> callArgs;
+  if (jacobianFD)
+    callArgs.push_back(BuildDeclRef(jacobianFD));
+  callArgs.push_back(BuildDeclRef(pullbackFD));
+  for (size_t i = 0, e = params.size(); i < e; ++i) {
+    const ParmVarDecl* PVD = FD->getParamDecl(i);
+    llvm::SmallVector<Expr*, 2> tagArgs{BuildDeclRef(params[i])};
+    if (matrices[i])
+      tagArgs.push_back(BuildDeclRef(matrices[i]));
+    std::string tag = "jacobian_constant";
+    if (matrices[i] && PVD->getName().contains("_clad_out_"))
+      tag = "jacobian_output";
+    else if (isIndependent(PVD) &&
+             (matrices[i] || !utils::isArrayOrPointerType(PVD->getType())))
+      tag = "jacobian_input";
+    callArgs.push_back(GetFunctionCall(tag, "clad", tagArgs));
+  }
+  Expr* call = GetFunctionCall(
+      jacobianFD ? "auto_jacobian" : "reverse_jacobian", "clad", callArgs);
+
+  Stmt* body[] = {call};
+  CompoundStmt* CS = clad_compat::CompoundStmt_Create(
+      m_Context, body /**/ CLAD_COMPAT_CLANG15_CompoundStmt_Create_ExtraParam2(
+                     clang::FPOptionsOverride()),
+      noLoc, noLoc);
+  derivedFD->setBody(CS);
+  endScope(); // Function body scope
+  m_Sema.PopFunctionScopeInfo();
+  m_Sema.PopDeclContext();
+  endScope(); // Function decl scope
+
+  FunctionDecl* overloadFD = CreateDerivativeOverload();
+  return DerivativeAndOverload{derivedFD, overloadFD};
+}
+
 StmtDiff JacobianModeVisitor::VisitReturnStmt(const clang::ReturnStmt* RS) {
   // If there is no return value, we must not attempt to differentiate
   if (!RS->getRetValue())
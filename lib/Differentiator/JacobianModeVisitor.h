@@ -14,6 +14,12 @@ public:
 
   DerivativeAndOverload Derive() override;
 
+  /// Builds the jacobian of clad::jacobian<clad::opts::auto_mode> as a call to
+  /// clad::reverse_jacobian, which computes it row by row with the pullback
+  /// of the function, or to clad::auto_jacobian, which picks between that and
+  /// the forward mode jacobian once the sizes of the arrays are known.
+  DerivativeAndOverload DeriveReverseJacobian();
+
   StmtDiff VisitReturnStmt(const clang::ReturnStmt* RS) override;
 };
 } // end namespace clad
@@ -0,0 +1,295 @@
+//--------------------------------------------------------------------*- C++ -*-
+// clad - the C++ Clang-based Automatic Differentiator
+//
+// Builds the matrix-free jacobian-vector and vector-jacobian products on top
+// of the pushforward and the pullback of a function.
+//------------------------------------------------------------------------------
+
+#include "ProductModeVisitor.h"
+
+#include "clad/Differentiator/CladUtils.h"
+#include "clad/Differentiator/Compatibility.h"
+#include "clad/Differentiator/DiffPlanner.h"
+
+#include "clang/AST/Decl.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/Expr.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Sema/Scope.h"
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Casting.h"
+#include "llvm/Support/SaveAndRestore.h"
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+
+using namespace clang;
+
+namespace {
+/// Collects the parameters of a function through which its body writes to the
+/// memory of the caller, i.e. its output parameters.
+class WrittenParamsFinder : public RecursiveASTVisitor<WrittenParamsFinder> {
+public:
+  llvm::SmallPtrSet<const ParmVarDecl*, 4> Params;
+
+  bool VisitBinaryOperator(BinaryOperator* BO) {
+    if (BO->isAssignmentOp())
+      markBase(BO->getLHS());
+    return true;
+  }
+
+  bool VisitUnaryOperator(UnaryOperator* UO) {
+    if (UO->isIncrementDecrementOp())
+      markBase(UO->getSubExpr());
+    return true;
+  }
+
+  bool VisitCallExpr(CallExpr* CE) {
+    // Arguments passed as non-const pointers or references may be written by
+    // the callee.
+    const FunctionDecl* callee = CE->getDirectCallee();
+    for (unsigned i = 0, e = CE->getNumArgs(); i < e; ++i) {
+      if (callee && i < callee->getNumParams()) {
+        QualType T = callee->getParamDecl(i)->getType();
+        if (!utils::isNonConstReferenceType(T) &&
+            !(T->isPointerType() && !T->getPointeeType().isConstQualified()))
+          continue;
+      }
+      markBase(CE->getArg(i), /*throughMemory=*/true);
+    }
+    return true;
+  }
+
+private:
+  /// Marks the parameter \p E is based on if the written memory belongs to
+  /// the caller: the parameter is a reference or is dereferenced.
+  void markBase(const Expr* E, bool throughMemory = false) {
+    while (true) {
+      E = E->IgnoreParenImpCasts();
+      if (const auto* ASE = dyn_cast<ArraySubscriptExpr>(E)) {
+        E = ASE->getBase();
+        throughMemory = true;
+      } else if (const auto* UO = dyn_cast<UnaryOperator>(E)) {
+        if (UO->getOpcode() == UO_Deref)
+          throughMemory = true;
+        else if (!UO->isIncrementDecrementOp())
+          return;
+        E = UO->getSubExpr();
+      } else if (const auto* BO = dyn_cast<BinaryOperator>(E)) {
+        // Pointer arithmetic, e.g. *(out + 1).
+        if (!BO->isAdditiveOp())
+          return;
+        E = BO->getLHS()->getType()->isPointerType() ? BO->getLHS()
+                                                      : BO->getRHS();
+      } else {
+        break;
+      }
+    }
+    const auto* DRE = dyn_cast<DeclRefExpr>(E);
+    if (!DRE)
+      return;
+    const auto* PVD = dyn_cast<ParmVarDecl>(DRE->getDecl());
+    if (PVD && (throughMemory || PVD->getType()->isReferenceType()))
+      Params.insert(PVD);
+  }
+};
+} // namespace
+
+namespace clad {
+ProductModeVisitor::ProductModeVisitor(DerivativeBuilder& builder,
+                                       const DiffRequest& request)
+    : VisitorBase(builder, request) {}
+
+DerivativeAndOverload ProductModeVisitor::Derive() {
+  const FunctionDecl* FD = m_DiffReq.Function;
+  bool isVJP = m_DiffReq.Mode == DiffMode::vjp;
+  if (const auto* MD = dyn_cast<CXXMethodDecl>(FD)) {
+    if (MD->isInstance()) {
+      SourceLocation L = MD->getLocation();
+      diag(DiagnosticsEngine::Error, L,
+           "%select{jacobian-vector|vector-jacobian}0 products of non-static "
+           "member functions are not supported yet")
+          << isVJP << L;
+      return {};
+    }
+  }
+  // The pushforward takes a direction for every parameter.
+  if (!isVJP && m_DiffReq.Args && !isa<CXXDefaultArgExpr>(m_DiffReq.Args)) {
+    SourceLocation L = m_DiffReq.Args->getBeginLoc();
+    diag(DiagnosticsEngine::Error, L,
+         "jacobian-vector products are computed w.r.t. all the parameters, "
+         "the independent parameters cannot be specified")
+        << L;
+    return {};
+  }
+
+  // The pushforward (jvp) or the pullback (vjp) of f is scheduled by the
+  // planner, the product only forwards its arguments to it.
+  DiffRequest productRequest = m_DiffReq;
+  productRequest.CallUpdateRequired = false;
+  productRequest.Args = nullptr;
+  if (isVJP) {
+    productRequest.Mode = DiffMode::pullback;
+  } else {
+    productRequest.Mode = DiffMode::pushforward;
+    productRequest.UpdateDiffParamsInfo(m_Sema);
+  }
+  FunctionDecl* productFD = FindDerivedFunction(productRequest);
+  if (!productFD)
+    return {};
+
+  std::string productFuncName =
+      m_DiffReq.BaseFunctionName + (isVJP ? "_vjp" : "_jvp");
+  // Nothing is appended if the product is computed w.r.t. all the parameters.
+  if (isVJP && m_DiffReq.DVI.size() != FD->getNumParams()) {
+    for (const DiffInputVarInfo& dParam : m_DiffReq.DVI) {
+      const auto* it =
+          std::find(FD->param_begin(), FD->param_end(), dParam.param);
+      productFuncName +=
+          "_" + std::to_string(std::distance(FD->param_begin(), it));
+    }
+  }
+
+  QualType productFuncType = GetDerivativeType();
+  llvm::ArrayRef<QualType> paramTypes =
+      cast<FunctionProtoType>(productFuncType)->getParamTypes();
+
+  // FIXME: We should not use const_cast to get the decl context here.
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+  auto* DC = const_cast<DeclContext*>(m_DiffReq->getDeclContext());
+  llvm::SaveAndRestore<DeclContext*> SaveContext(m_Sema.CurContext);
+  llvm::SaveAndRestore<Scope*> SaveScope(getCurrentScope(),
+                                         getEnclosingNamespaceOrTUScope());
+  m_Sema.CurContext = DC;
+
+  IdentifierInfo* II = &m_Context.Idents.get(productFuncName);
+  DeclarationNameInfo name(II, noLoc);
+  DeclWithContext result =
+      m_Builder.cloneFunction(FD, *this, DC, noLoc, name, productFuncType);
+  FunctionDecl* derivedFD = result.first;
+
+  beginScope(Scope::FunctionPrototypeScope | Scope::FunctionDeclarationScope |
+             Scope::DeclScope);
+  m_Sema.PushFunctionScope();
+  m_Sema.PushDeclContext(getCurrentScope(), derivedFD);
+
+  // f_jvp(params..., _d_params...) or f_vjp(params..., _d_y, _d_params...)
+  llvm::SmallVector<ParmVarDecl*, 8> params;
+  for (const ParmVarDecl* PVD : FD->parameters())
+    params.push_back(CloneParmVarDecl(PVD, PVD->getIdentifier(),
+                                      /*pushOnScopeChains=*/false,
+                                      /*cloneDefaultArg=*/false));
+  size_t numParams = params.size();
+  llvm::SmallVector<ParmVarDecl*, 8> allParams(params.begin(), params.end());
+
+  // The seed of the return value is named like in pullbacks.
+  ParmVarDecl* seedPVD = nullptr;
+  if (paramTypes.size() > 2 * numParams) {
+    std::string identifier = "y";
+    for (unsigned idx = 0;; ++idx) {
+      if (idx)
+        identifier = "y" + std::to_string(idx - 1);
+      if (std::none_of(params.begin(), params.end(), [&](ParmVarDecl* PVD) {
+            return PVD->getName() == identifier;
+          }))
+        break;
+    }
+    seedPVD = utils::BuildParmVarDecl(
+        m_Sema, derivedFD, &m_Context.Idents.get("_d_" + identifier),
+        paramTypes[numParams]);
+    allParams.push_back(seedPVD);
+  }
+
+  llvm::SmallVector<ParmVarDecl*, 8> dParams;
+  for (size_t i = 0; i < numParams; ++i) {
+    IdentifierInfo* dII =
+        &m_Context.Idents.get("_d_" + params[i]->getNameAsString());
+    dParams.push_back(utils::BuildParmVarDecl(
+        m_Sema, derivedFD, dII, paramTypes[paramTypes.size() - numParams + i]));
+  }
+  allParams.append(dParams.begin(), dParams.end());
+  for (ParmVarDecl* PVD : allParams)
+    if (PVD->getIdentifier())
+      m_Sema.PushOnScopeChains(PVD, getCurrentScope(), /*AddToContext=*/false);
+  derivedFD->setParams(allParams);
+
+  beginScope(Scope::FnScope | Scope::DeclScope);
+  m_DerivativeFnScope = getCurrentScope();
+
+  // The pullback consumes the adjoints of the output parameters, which hold
+  // the vector of the product and must be left untouched for the caller.
+  WrittenParamsFinder finder;
+  if (isVJP && FD->hasBody())
+    finder.TraverseStmt(FD->getBody());
+
+  llvm::SmallVector<Stmt*, 8> body;
+  llvm::SmallVector<Expr*, 16> callArgs;
+  for (ParmVarDecl* PVD : params)
+    callArgs.push_back(BuildDeclRef(PVD));
+  if (seedPVD)
+    callArgs.push_back(BuildDeclRef(seedPVD));
+  for (size_t i = 0; i < numParams; ++i) {
+    // The pushforward takes the direction of every differentiable parameter,
+    // the pullback only the adjoints of the requested ones. The clad::array_ref
+    // buffers decay to the pointers the derivatives expect.
+    bool isPassed = false;
+    if (isVJP)
+      isPassed = std::any_of(m_DiffReq.DVI.begin(), m_DiffReq.DVI.end(),
+                             [&](const DiffInputVarInfo& dParam) {
+                               return dParam.param == FD->getParamDecl(i);
+                             });
+    else
+      isPassed = utils::IsDifferentiableType(params[i]->getType());
+    if (!isPassed)
+      continue;
+    Expr* dParam = BuildDeclRef(dParams[i]);
+    QualType paramTy = FD->getParamDecl(i)->getType();
+    if (finder.Params.count(FD->getParamDecl(i))) {
+      std::string name = "_u_" + params[i]->getNameAsString();
+      QualType valueTy = utils::GetNonConstValueType(paramTy);
+      if (utils::isArrayOrPointerType(paramTy)) {
+        // clad::array<T> _u_out(_d_out);
+        VarDecl* seedCopy =
+            BuildVarDecl(utils::GetCladArrayOfType(m_Sema, valueTy), name,
+                         dParam, /*DirectInit=*/true);
+        body.push_back(BuildDeclStmt(seedCopy));
+        dParam = BuildDeclRef(seedCopy);
+      } else if (paramTy->isReferenceType()) {
+        // T _u_y = *_d_y;
+        VarDecl* seedCopy = BuildVarDecl(valueTy.getNonReferenceType(), name,
+                                         BuildOp(UO_Deref, dParam));
+        body.push_back(BuildDeclStmt(seedCopy));
+        dParam = BuildOp(UO_AddrOf, BuildDeclRef(seedCopy));
+      }
+    }
+    callArgs.push_back(dParam);
+  }
+  Expr* call = BuildCallExprToFunction(productFD, callArgs);
+
+  if (!isVJP && !FD->getReturnType()->isVoidType()) {
+    Expr* pushforward =
+        utils::BuildMemberExpr(m_Sema, getCurrentScope(), call, "pushforward");
+    body.push_back(
+        m_Sema.ActOnReturnStmt(noLoc, pushforward, getCurrentScope()).get());
+  } else {
+    body.push_back(call);
+  }
+
+  CompoundStmt* CS = clad_compat::CompoundStmt_Create(
+      m_Context, body /**/ CLAD_COMPAT_CLANG15_CompoundStmt_Create_ExtraParam2(
+                     clang::FPOptionsOverride()),
+      noLoc, noLoc);
+  derivedFD->setBody(CS);
+  endScope(); // Function body scope
+  m_Sema.PopFunctionScopeInfo();
+  m_Sema.PopDeclContext();
+  endScope(); // Function decl scope
+
+  return DerivativeAndOverload{derivedFD, /*OverloadFunctionDecl=*/nullptr};
+}
+} // end namespace clad
@@ -0,0 +1,26 @@
+//--------------------------------------------------------------------*- C++ -*-
+// clad - the C++ Clang-based Automatic Differentiator
+//
+// Builds the matrix-free jacobian-vector and vector-jacobian products on top
+// of the pushforward and the pullback of a function.
+//------------------------------------------------------------------------------
+
+#ifndef CLAD_DIFFERENTIATOR_PRODUCTMODEVISITOR_H
+#define CLAD_DIFFERENTIATOR_PRODUCTMODEVISITOR_H
+
+#include "clad/Differentiator/DerivativeBuilder.h"
+#include "clad/Differentiator/VisitorBase.h"
+
+namespace clad {
+/// Builds the matrix-free jacobian products f_jvp and f_vjp requested by
+/// clad::jvp and clad::vjp. They forward to the pushforward and the pullback
+/// of the function respectively, so the jacobian is never formed.
+class ProductModeVisitor : public VisitorBase {
+public:
+  ProductModeVisitor(DerivativeBuilder& builder, const DiffRequest& request);
+
+  DerivativeAndOverload Derive() override;
+};
+} // end namespace clad
+
+#endif // CLAD_DIFFERENTIATOR_PRODUCTMODEVISITOR_H
@@ -58,6 +58,7 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/SaveAndRestore.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include <algorithm>
@@ -338,11 +339,15 @@ Expr* ReverseModeVisitor::getStdInitListSizeExpr(const Expr* E) {
       if (m_ExternalSource)
         m_ExternalSource->ActOnStartOfDerivedFnBody(m_DiffReq);
 
-      if (m_DiffReq.use_enzyme) {
-        assert(m_DiffReq.Mode == DiffMode::reverse && "Not in reverse?");
-        DifferentiateWithEnzyme();
-      } else {
-        DifferentiateWithClad();
+      {
+        llvm::TimeTraceScope TS("Differentiate body",
+                                [this]() { return (std::string)m_DiffReq; });
+        if (m_DiffReq.use_enzyme) {
+          assert(m_DiffReq.Mode == DiffMode::reverse && "Not in reverse?");
+          DifferentiateWithEnzyme();
+        } else {
+          DifferentiateWithClad();
+        }
       }
 
       Stmt* fnBody = endBlock();
@@ -382,6 +387,8 @@ Expr* ReverseModeVisitor::getStdInitListSizeExpr(const Expr* E) {
     if (!shouldCreateOverload)
       return DerivativeAndOverload{result.first, /*overload=*/nullptr};
 
+    llvm::TimeTraceScope TS("Create overload",
+                            [this]() { return (std::string)m_DiffReq; });
     return DerivativeAndOverload{result.first, CreateDerivativeOverload()};
   }
 
@@ -2044,6 +2051,7 @@ Expr* ReverseModeVisitor::getStdInitListSizeExpr(const Expr* E) {
           asGrad ? DiffMode::pullback : DiffMode::pushforward;
       // Silence diag outputs in nested derivation process.
       pullbackRequest.EnableTBRAnalysis = m_DiffReq.EnableTBRAnalysis;
+      pullbackRequest.EnableTBRSummaries = m_DiffReq.EnableTBRSummaries;
       pullbackRequest.EnableVariedAnalysis = m_DiffReq.EnableVariedAnalysis;
       pullbackRequest.EnableErrorEstimation = m_DiffReq.EnableErrorEstimation;
       // Error estimation only uses forward mode derivatives if they are
@@ -2145,7 +2153,7 @@ Expr* ReverseModeVisitor::getStdInitListSizeExpr(const Expr* E) {
         revForwAdjointArgs.push_back(argDiff.getRevSweepAsExpr());
 
       CallArgDx.push_back(argDiff.getExpr_dx());
-      if (m_DiffReq.shouldBeRecorded(arg))
+      if (m_DiffReq.isToBeRecorded(arg))
         hasStoredParams = true;
     }
 
@@ -2239,7 +2247,7 @@ Expr* ReverseModeVisitor::getStdInitListSizeExpr(const Expr* E) {
         } else {
           auto CEType = utils::getNonConstType(CE->getType(), m_Sema);
           GetMultiArgCentralDiffCall(
-              Clone(CE->getCallee()), CEType.getCanonicalType(),
+              Clone(CE->getCallee()), FD, CEType.getCanonicalType(),
               CE->getNumArgs(), dfdx(), PreCallStmts, pullbackCallArgs,
               CallArgDx, CUDAExecConfig);
         }
@@ -2411,15 +2419,92 @@ Expr* ReverseModeVisitor::getStdInitListSizeExpr(const Expr* E) {
     return StmtDiff(call, getZeroInit(call->getType()));
   }
 
+  Expr* ReverseModeVisitor::BuildComplexStepCallee(const FunctionDecl* FD) {
+    FunctionTemplateDecl* FTD = FD->getPrimaryTemplate();
+    const TemplateArgumentList* TAL = FD->getTemplateSpecializationArgs();
+    if (!FTD || !TAL || TAL->size() != 1 ||
+        TAL->get(0).getKind() != TemplateArgument::Type ||
+        !TAL->get(0).getAsType()->isRealFloatingType())
+      return nullptr;
+    // The specialization for std::complex has to take and return complex
+    // numbers in place of all the scalars. The arguments are passed as
+    // temporaries, so the parameters cannot be non-const references.
+    const FunctionDecl* Pattern = FTD->getTemplatedDecl();
+    auto isTemplateParm = [](QualType T) {
+      if (T->isLValueReferenceType() &&
+          !T.getNonReferenceType().isConstQualified())
+        return false;
+      return T.getNonReferenceType()->isTemplateTypeParmType();
+    };
+    if (!isTemplateParm(Pattern->getReturnType()) ||
+        !llvm::all_of(Pattern->parameters(), [&](const ParmVarDecl* PVD) {
+          return isTemplateParm(PVD->getType());
+        }))
+      return nullptr;
+
+    // std::complex is declared by the numerical differentiation header.
+    NamespaceDecl* StdNS = utils::LookupNSD(m_Sema, "std",
+                                            /*shouldExist=*/false);
+    if (!StdNS)
+      return nullptr;
+    LookupResult R = utils::LookupQualifiedName("complex", m_Sema, StdNS);
+    auto* ComplexTD = R.getAsSingle<ClassTemplateDecl>();
+    if (!ComplexTD)
+      return nullptr;
+    SourceLocation Loc = utils::GetValidSLoc(m_Sema);
+    TemplateArgumentListInfo ComplexArgs(Loc, Loc);
+    ComplexArgs.addArgument(TemplateArgumentLoc(
+        TAL->get(0), m_Context.getTrivialTypeSourceInfo(
+                         TAL->get(0).getAsType(), Loc)));
+    QualType ComplexT =
+        m_Sema.CheckTemplateIdType(TemplateName(ComplexTD), Loc, ComplexArgs);
+    if (ComplexT.isNull())
+      return nullptr;
+    CXXScopeSpec StdSS;
+    StdSS.Extend(m_Context, StdNS, Loc, Loc);
+    ComplexT = m_Context.getElaboratedType(
+        clad_compat::ElaboratedTypeKeyword_None, StdSS.getScopeRep(),
+        ComplexT);
+
+    TemplateArgument Arg(ComplexT);
+#if CLANG_VERSION_MAJOR < 19
+    TemplateArgumentList TL(TemplateArgumentList::OnStack, Arg);
+#else
+    auto& TL = *TemplateArgumentList::CreateCopy(m_Context, Arg);
+#endif
+    FunctionDecl* ComplexFD =
+        m_Sema.InstantiateFunctionDeclaration(FTD, &TL, Loc);
+    if (!ComplexFD)
+      return nullptr;
+    m_Sema.MarkFunctionReferenced(Loc, ComplexFD);
+
+    // Spell the template argument so that the call reads f<std::complex<T>>.
+    TemplateArgumentListInfo FnArgs(Loc, Loc);
+    FnArgs.addArgument(TemplateArgumentLoc(
+        Arg, m_Context.getTrivialTypeSourceInfo(ComplexT, Loc)));
+    return DeclRefExpr::Create(m_Context, NestedNameSpecifierLoc(), Loc,
+                               ComplexFD,
+                               /*RefersToEnclosingVariableOrCapture=*/false,
+                               ComplexFD->getNameInfo(), ComplexFD->getType(),
+                               VK_LValue, ComplexFD, &FnArgs);
+  }
+
   void ReverseModeVisitor::GetMultiArgCentralDiffCall(
-      Expr* targetFuncCall, QualType retType, unsigned numArgs, Expr* dfdx,
-      llvm::SmallVectorImpl<Stmt*>& PreCallStmts,
+      Expr* targetFuncCall, const FunctionDecl* targetFD, QualType retType,
+      unsigned numArgs, Expr* dfdx, llvm::SmallVectorImpl<Stmt*>& PreCallStmts,
       llvm::SmallVectorImpl<Expr*>& args,
       llvm::SmallVectorImpl<Expr*>& outputArgs,
       Expr* CUDAExecConfig /*=nullptr*/) {
     int printErrorInf = m_Builder.shouldPrintNumDiffErrs();
+    // The complex step evaluates the function once per parameter without
+    // cancellation, but needs the function to accept complex numbers.
+    Expr* complexStepCallee = nullptr;
+    if (m_Builder.shouldUseNumDiffComplexStep() && !CUDAExecConfig &&
+        !m_Context.getLangOpts().CUDA)
+      complexStepCallee = BuildComplexStepCallee(targetFD);
     llvm::SmallVector<Expr*, 16U> NumDiffArgs = {};
-    NumDiffArgs.push_back(targetFuncCall);
+    NumDiffArgs.push_back(complexStepCallee ? complexStepCallee
+                                            : targetFuncCall);
     // build the output array declaration.
     Expr* size =
         ConstantFolder::synthesizeLiteral(m_Context.IntTy, m_Context, numArgs);
@@ -2453,12 +2538,21 @@ Expr* ReverseModeVisitor::getStdInitListSizeExpr(const Expr* E) {
       SetDeclInit(dArgVD, gradExpr);
       NumDiffArgs.push_back(args[i]);
     }
-    std::string Name = "central_difference";
+    std::string Name =
+        complexStepCallee ? "complex_step_difference" : "central_difference";
     Expr* call = m_Builder.BuildCallToCustomDerivativeOrNumericalDiff(
         Name, NumDiffArgs, getCurrentScope(),
         /*callSite=*/nullptr,
         /*forCustomDerv=*/false,
         /*namespaceShouldExist=*/false, CUDAExecConfig);
+    if (!call && complexStepCallee) {
+      NumDiffArgs[0] = targetFuncCall;
+      call = m_Builder.BuildCallToCustomDerivativeOrNumericalDiff(
+          "central_difference", NumDiffArgs, getCurrentScope(),
+          /*callSite=*/nullptr,
+          /*forCustomDerv=*/false,
+          /*namespaceShouldExist=*/false, CUDAExecConfig);
+    }
     // The call and the `_grad` declaration must go before the declarations of
     // `_r` temporaries.
     PreCallStmts.insert(PreCallStmts.begin(), call);
@@ -4571,6 +4665,7 @@ Expr* ReverseModeVisitor::getStdInitListSizeExpr(const Expr* E) {
         // Silence diag outputs in nested derivation process.
         pullbackRequest.VerboseDiags = false;
         pullbackRequest.EnableTBRAnalysis = m_DiffReq.EnableTBRAnalysis;
+        pullbackRequest.EnableTBRSummaries = m_DiffReq.EnableTBRSummaries;
         pullbackRequest.EnableVariedAnalysis = m_DiffReq.EnableVariedAnalysis;
         for (size_t i = 0, e = CD->getNumParams(); i < e; ++i)
           if (adjointArgs[i])
@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <cassert>
 #include <iterator>
+#include <map>
 #include <memory>
 #include <set>
 
@@ -19,6 +20,7 @@
 #include "clad/Differentiator/Compatibility.h"
 #include "clad/Differentiator/DiffPlanner.h"
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/Debug.h"
@@ -47,6 +49,9 @@ void TBRAnalyzer::setIsRequired(const clang::Expr* E, bool isReq) {
   // Make sure the current branch has a copy of VarDecl for VD
   auto& curBranch = getCurBlockVarsData();
   for (const VarDecl* iterVD : vars) {
+    if (m_NonLinearParams && isReq &&
+        m_ModeStack.back() == (Mode::kMarkingMode | Mode::kNonLinearMode))
+      m_NonLinearUses.insert(iterVD);
     const auto* PVD = dyn_cast_or_null<ParmVarDecl>(iterVD);
     if (m_ModifiedParams && (!iterVD || PVD)) {
       if (!isReq)
@@ -72,9 +77,169 @@ void TBRAnalyzer::setIsRequired(const clang::Expr* E, bool isReq) {
   }
 }
 
+void TBRAnalyzer::computeNonLinearParams(const FunctionDecl* FD) {
+  // Collects the variables referenced in a statement, including the indices
+  // of subscripts.
+  class VarCollector : public RecursiveASTVisitor<VarCollector> {
+  public:
+    std::set<const VarDecl*>& m_Vars;
+    VarCollector(std::set<const VarDecl*>& Vars) : m_Vars(Vars) {}
+    bool VisitDeclRefExpr(DeclRefExpr* DRE) {
+      if (const auto* VD = dyn_cast<VarDecl>(DRE->getDecl()))
+        m_Vars.insert(VD);
+      return true;
+    }
+    bool VisitCXXThisExpr(CXXThisExpr* TE) {
+      m_Vars.insert(nullptr);
+      return true;
+    }
+  };
+  // Collects, regardless of the control flow, the variables the value of each
+  // variable is computed from and the variables the control flow and the
+  // pointer arithmetic read.
+  class FlowCollector : public RecursiveASTVisitor<FlowCollector> {
+  public:
+    std::map<const VarDecl*, std::set<const VarDecl*>> m_Sources;
+    std::set<const VarDecl*> m_Reads;
+    /// Set if a local pointer or reference may alias other variables.
+    bool m_HasAliases = false;
+
+    static void collect(const Stmt* S, std::set<const VarDecl*>& vars) {
+      // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+      VarCollector(vars).TraverseStmt(const_cast<Stmt*>(S));
+    }
+    void addFlow(const std::set<const VarDecl*>& targets, const Stmt* From) {
+      std::set<const VarDecl*> sources;
+      collect(From, sources);
+      for (const VarDecl* VD : targets)
+        m_Sources[VD].insert(sources.begin(), sources.end());
+    }
+    void addFlow(const Stmt* To, const Stmt* From) {
+      std::set<const VarDecl*> targets;
+      collect(To, targets);
+      addFlow(targets, From);
+    }
+    bool VisitVarDecl(VarDecl* VD) {
+      if (isa<ParmVarDecl>(VD))
+        return true;
+      if (VD->getType()->isPointerType() || VD->getType()->isReferenceType())
+        m_HasAliases = true;
+      if (const Expr* init = VD->getInit())
+        addFlow({VD}, init);
+      return true;
+    }
+    bool VisitBinaryOperator(BinaryOperator* BinOp) {
+      if (BinOp->isAssignmentOp())
+        addFlow(BinOp->getLHS(), BinOp->getRHS());
+      else if (BinOp->isLogicalOp())
+        collect(BinOp->getLHS(), m_Reads);
+      else if (BinOp->isAdditiveOp() && BinOp->getType()->isPointerType())
+        collect(BinOp, m_Reads);
+      return true;
+    }
+    bool VisitCallExpr(CallExpr* CE) {
+      // Arguments passed by reference may be overwritten with the values of
+      // any other argument.
+      std::set<const VarDecl*> targets;
+      const FunctionDecl* FD = CE->getDirectCallee();
+      for (unsigned i = 0, e = CE->getNumArgs(); i != e; ++i)
+        if (!FD || i >= FD->getNumParams() ||
+            utils::isMemoryType(FD->getParamDecl(i)->getType()))
+          collect(CE->getArg(i), targets);
+      const auto* MD = dyn_cast_or_null<CXXMethodDecl>(FD);
+      if (MD && MD->isInstance() && !MD->isConst()) {
+        if (const auto* MCE = dyn_cast<CXXMemberCallExpr>(CE))
+          collect(MCE->getImplicitObjectArgument(), targets);
+        else if (isa<CXXOperatorCallExpr>(CE))
+          collect(CE->getArg(0), targets);
+      }
+      if (!targets.empty())
+        for (const Expr* arg : CE->arguments())
+          addFlow(targets, arg);
+      return true;
+    }
+    bool VisitIfStmt(IfStmt* If) {
+      collect(If->getCond(), m_Reads);
+      return true;
+    }
+    bool VisitForStmt(ForStmt* For) {
+      collect(For->getCond(), m_Reads);
+      return true;
+    }
+    bool VisitWhileStmt(WhileStmt* While) {
+      collect(While->getCond(), m_Reads);
+      return true;
+    }
+    bool VisitDoStmt(DoStmt* Do) {
+      collect(Do->getCond(), m_Reads);
+      return true;
+    }
+    bool VisitSwitchStmt(SwitchStmt* Switch) {
+      collect(Switch->getCond(), m_Reads);
+      return true;
+    }
+    bool VisitConditionalOperator(ConditionalOperator* CO) {
+      collect(CO->getCond(), m_Reads);
+      return true;
+    }
+  };
+
+  FlowCollector collector;
+  collector.TraverseStmt(FD->getBody());
+
+  std::set<const VarDecl*> needed = m_NonLinearUses;
+  needed.insert(collector.m_Reads.begin(), collector.m_Reads.end());
+  ParamSet& params = (*m_NonLinearParams)[FD];
+  if (collector.m_HasAliases) {
+    // The flow through aliases is not tracked, fall back to all the
+    // parameters the function uses.
+    if (m_UsedParams)
+      params = (*m_UsedParams)[FD];
+  } else {
+    llvm::SmallVector<const VarDecl*, 16> worklist(needed.begin(),
+                                                   needed.end());
+    while (!worklist.empty()) {
+      const VarDecl* VD = worklist.pop_back_val();
+      auto it = collector.m_Sources.find(VD);
+      if (it == collector.m_Sources.end())
+        continue;
+      for (const VarDecl* source : it->second)
+        if (needed.insert(source).second)
+          worklist.push_back(source);
+    }
+  }
+  // The 'this' pointer is represented with nullptr.
+  for (const VarDecl* VD : needed) {
+    const auto* PVD = dyn_cast_or_null<ParmVarDecl>(VD);
+    if (!VD || (PVD && llvm::is_contained(FD->parameters(), PVD)))
+      params.insert(PVD);
+  }
+}
+
+int TBRAnalyzer::getParamMode(const FunctionDecl* FD,
+                              const ParmVarDecl* PVD) const {
+  // Without the results of the analysis of FD, assume any use.
+  if (!m_ModifiedParams ||
+      m_ModifiedParams->find(FD) == m_ModifiedParams->end())
+    return Mode::kMarkingMode | Mode::kNonLinearMode;
+  bool isUsed = (*m_UsedParams)[FD].count(PVD);
+  if (m_NonLinearParams) {
+    auto it = m_NonLinearParams->find(FD);
+    if (it != m_NonLinearParams->end()) {
+      if (it->second.count(PVD))
+        return Mode::kMarkingMode | Mode::kNonLinearMode;
+      // The pullback does not need the value, but marking the argument keeps
+      // the parameters it comes from in the summary of the caller.
+      return isUsed ? Mode::kMarkingMode : 0;
+    }
+  }
+  return isUsed ? Mode::kMarkingMode | Mode::kNonLinearMode : 0;
+}
+
 void TBRAnalyzer::Analyze(const DiffRequest& request) {
   m_BlockData.resize(request.m_AnalysisDC->getCFG()->size());
   m_BlockPassCounter.resize(request.m_AnalysisDC->getCFG()->size(), 0);
+  m_CFGQueue.resize(request.m_AnalysisDC->getCFG()->size());
 
   // Set current block ID to the ID of entry the block.
   CFGBlock& entry = request.m_AnalysisDC->getCFG()->getEntry();
@@ -103,18 +268,19 @@ void TBRAnalyzer::Analyze(const DiffRequest& request) {
   auto paramsRef = FD->parameters();
   for (std::size_t i = 0; i < FD->getNumParams(); ++i)
     addVar(paramsRef[i], /*forceInit=*/true);
+  collectAffineLoops(FD);
   // Add the entry block to the queue.
   m_CFGQueue.insert(m_CurBlockID);
 
   // Visit CFG blocks in the queue until it's empty.
   while (!m_CFGQueue.empty()) {
-    auto IDIter = std::prev(m_CFGQueue.end());
-    m_CurBlockID = *IDIter;
-    m_CFGQueue.erase(IDIter);
+    m_CurBlockID = m_CFGQueue.pop();
 
     CFGBlock& nextBlock = *getCFGBlockByID(request.m_AnalysisDC, m_CurBlockID);
     VisitCFGBlock(nextBlock);
   }
+  if (m_NonLinearParams)
+    computeNonLinearParams(FD);
 #ifndef NDEBUG
   for (int id = m_CurBlockID; id >= 0; --id) {
     LLVM_DEBUG(llvm::dbgs() << "\n-----BLOCK" << id << "-----\n\n");
@@ -146,6 +312,7 @@ void TBRAnalyzer::VisitCFGBlock(const CFGBlock& block) {
     if (Element.getKind() == clang::CFGElement::Statement) {
       const clang::Stmt* S = Element.castAs<clang::CFGStmt>().getStmt();
       TraverseStmt(const_cast<clang::Stmt*>(S));
+      enterAffineIteration(S);
     }
   }
 
@@ -162,7 +329,7 @@ void TBRAnalyzer::VisitCFGBlock(const CFGBlock& block) {
     // current block as previous.
     if (!varsData) {
       varsData = std::unique_ptr<VarsData>(new VarsData());
-      varsData->m_Prev = m_BlockData[block.getBlockID()].get();
+      varsData->setPrev(m_BlockData[block.getBlockID()].get());
     }
 
     // If this is the third (last) pass of block, it means block represents a
@@ -242,7 +409,7 @@ bool TBRAnalyzer::TraverseConditionalOperator(clang::ConditionalOperator* CO) {
   auto elseBranch = std::move(m_BlockData[m_CurBlockID]);
 
   m_BlockData[m_CurBlockID] = std::unique_ptr<VarsData>(new VarsData());
-  m_BlockData[m_CurBlockID]->m_Prev = elseBranch.get();
+  m_BlockData[m_CurBlockID]->setPrev(elseBranch.get());
   TraverseStmt(CO->getTrueExpr());
 
   auto thenBranch = std::move(m_BlockData[m_CurBlockID]);
@@ -407,9 +574,9 @@ bool TBRAnalyzer::TraverseCallExpr(clang::CallExpr* CE) {
   // Pseudo destructors don't contribute to TBR information.
   if (isa<CXXPseudoDestructorExpr>(callee))
     return false;
-  // FIXME: Currently TBR analysis just stops here and assumes that all the
-  // variables passed by value/reference are used/used and changed. Analysis
-  // could proceed to the function to analyse data flow inside it.
+  // The callees analyzed beforehand come with the parameters they use, change
+  // and, with summaries, read non-linearly. For the others, all the variables
+  // passed by value/reference are assumed to be used/used and changed.
   FunctionDecl* FD = CE->getDirectCallee();
   // Use information about parameters assuming the analysis was performed.
   bool shouldAnalyzeParams = m_ModifiedParams && (m_ModifiedParams->find(FD) !=
@@ -426,19 +593,9 @@ bool TBRAnalyzer::TraverseCallExpr(clang::CallExpr* CE) {
     bool passByRef = false;
     if (par)
       passByRef = utils::isMemoryType(par->getType());
-    bool paramUnused = false;
-    if (shouldAnalyzeParams) {
-      auto& usedParams = (*m_UsedParams)[FD];
-      if (usedParams.find(par) == usedParams.end())
-        paramUnused = true;
-    }
-    if (nonDiff)
-      paramUnused = true;
-    if (paramUnused)
-      setMode(/*mode=*/0);
+    setMode(nonDiff ? 0 : getParamMode(FD, par));
     TraverseStmt(arg);
-    if (paramUnused)
-      resetMode();
+    resetMode();
     if (passByRef) {
       bool paramModified = true;
       if (shouldAnalyzeParams) {
@@ -464,19 +621,9 @@ bool TBRAnalyzer::TraverseCallExpr(clang::CallExpr* CE) {
   }
 
   if (base) {
-    bool paramUnused = false;
-    if (shouldAnalyzeParams) {
-      auto& usedParams = (*m_UsedParams)[FD];
-      if (usedParams.find(nullptr) == usedParams.end())
-        paramUnused = true;
-    }
-    if (nonDiff)
-      paramUnused = true;
-    if (paramUnused)
-      setMode(/*mode=*/0);
+    setMode(nonDiff ? 0 : getParamMode(FD, /*PVD=*/nullptr));
     TraverseStmt(base);
-    if (paramUnused)
-      resetMode();
+    resetMode();
     bool paramModified = true;
     if (shouldAnalyzeParams) {
       auto& modifiedParams = (*m_ModifiedParams)[FD];
@@ -41,6 +41,12 @@ class TBRAnalyzer : public clang::RecursiveASTVisitor<TBRAnalyzer>,
   std::set<const clang::Stmt*>& m_TBRLocs;
   ParamInfo* m_ModifiedParams;
   ParamInfo* m_UsedParams;
+  /// The parameters whose values the pullback reads, e.g. in a non-linear
+  /// operation or in a condition, directly or through local variables.
+  /// Callers use it to keep the arguments only used linearly off the tape.
+  ParamInfo* m_NonLinearParams;
+  /// The variables read in kMarkingMode|kNonLinearMode.
+  std::set<const clang::VarDecl*> m_NonLinearUses;
 
   /// Stores modes in a stack (used to retrieve the old mode after entering
   /// a new one).
@@ -58,6 +64,14 @@ class TBRAnalyzer : public clang::RecursiveASTVisitor<TBRAnalyzer>,
   /// markingMode and nonLinearMode. E could be DeclRefExpr,
   /// ArraySubscriptExpr or MemberExpr.
   void setIsRequired(const clang::Expr* E, bool isReq = true);
+  /// Computes the entry of m_NonLinearParams for the analyzed function from
+  /// m_NonLinearUses and the data flow of the function.
+  void computeNonLinearParams(const clang::FunctionDecl* FD);
+  /// \returns the mode to visit the argument of parameter \p PVD of the
+  /// callee \p FD in: 0 if its pullback does not use it, kMarkingMode if it
+  /// only uses it linearly.
+  int getParamMode(const clang::FunctionDecl* FD,
+                   const clang::ParmVarDecl* PVD) const;
 
   //// Modes Setters
   /// Sets the mode manually
@@ -78,9 +92,11 @@ public:
   TBRAnalyzer(clang::AnalysisDeclContext* AnalysisDC,
               std::set<const clang::Stmt*>& Locs,
               ParamInfo* ModifiedParams = nullptr,
-              ParamInfo* UsedParams = nullptr)
+              ParamInfo* UsedParams = nullptr,
+              ParamInfo* NonLinearParams = nullptr)
       : AnalysisBase(AnalysisDC), m_TBRLocs(Locs),
-        m_ModifiedParams(ModifiedParams), m_UsedParams(UsedParams) {
+        m_ModifiedParams(ModifiedParams), m_UsedParams(UsedParams),
+        m_NonLinearParams(NonLinearParams) {
     m_ModeStack.push_back(0);
   }
 
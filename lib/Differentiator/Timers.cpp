@@ -5,6 +5,7 @@
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -104,27 +105,58 @@ void InitTimers() {
   CladTimeInfo::TheTimingInfo = &*CTI;
 }
 
-TimedAnalysisRegion::TimedAnalysisRegion(llvm::StringRef Name) {
-  if (CladTimeInfo::TheTimingInfo)
-    CladTimeInfo::TheTimingInfo->StartAnalysisTimer(Name);
+/// Starts a span of the time trace, which is enabled either by clang's
+/// -ftime-trace or by clad's -ftime-trace=<file>.
+/// \returns true if the span was started.
+static bool StartTraceSpan(llvm::StringRef Name,
+                           const std::function<std::string()>& DetailProvider) {
+  if (!llvm::timeTraceProfilerEnabled())
+    return false;
+  llvm::timeTraceProfilerBegin(Name, DetailProvider ? DetailProvider() : "");
+  return true;
 }
+static void EndTraceSpan(bool Traced) {
+  // The profiler may have been written out while the region was active.
+  if (Traced && llvm::timeTraceProfilerEnabled())
+    llvm::timeTraceProfilerEnd();
+}
+
+TimedAnalysisRegion::TimedAnalysisRegion(llvm::StringRef Name)
+    : TimedAnalysisRegion(Name, nullptr) {}
 TimedAnalysisRegion::TimedAnalysisRegion(
     const std::function<std::string()>& NameProvider)
-    : TimedAnalysisRegion(CladTimeInfo::TheTimingInfo ? NameProvider() : "") {}
+    : TimedAnalysisRegion(CladTimeInfo::TheTimingInfo ||
+                                  llvm::timeTraceProfilerEnabled()
+                              ? NameProvider()
+                              : "") {}
+TimedAnalysisRegion::TimedAnalysisRegion(
+    llvm::StringRef Name, const std::function<std::string()>& DetailProvider) {
+  if (CladTimeInfo::TheTimingInfo)
+    CladTimeInfo::TheTimingInfo->StartAnalysisTimer(Name);
+  m_Traced = StartTraceSpan(Name, DetailProvider);
+}
 TimedAnalysisRegion::~TimedAnalysisRegion() {
+  EndTraceSpan(m_Traced);
   if (CladTimeInfo::TheTimingInfo)
     CladTimeInfo::TheTimingInfo->StopAnalysisTimer();
 }
 
-TimedGenerationRegion::TimedGenerationRegion(llvm::StringRef Name) {
-  if (CladTimeInfo::TheTimingInfo)
-    CladTimeInfo::TheTimingInfo->StartDiffTimer(Name);
-}
+TimedGenerationRegion::TimedGenerationRegion(llvm::StringRef Name)
+    : TimedGenerationRegion(Name, nullptr) {}
 TimedGenerationRegion::TimedGenerationRegion(
     const std::function<std::string()>& NameProvider)
-    : TimedGenerationRegion(CladTimeInfo::TheTimingInfo ? NameProvider() : "") {
+    : TimedGenerationRegion(CladTimeInfo::TheTimingInfo ||
+                                    llvm::timeTraceProfilerEnabled()
+                                ? NameProvider()
+                                : "") {}
+TimedGenerationRegion::TimedGenerationRegion(
+    llvm::StringRef Name, const std::function<std::string()>& DetailProvider) {
+  if (CladTimeInfo::TheTimingInfo)
+    CladTimeInfo::TheTimingInfo->StartDiffTimer(Name);
+  m_Traced = StartTraceSpan(Name, DetailProvider);
 }
 TimedGenerationRegion::~TimedGenerationRegion() {
+  EndTraceSpan(m_Traced);
   if (CladTimeInfo::TheTimingInfo)
     CladTimeInfo::TheTimingInfo->StopDiffTimer();
 }
@@ -7,18 +7,19 @@ namespace clad {
 void UsefulAnalyzer::Analyze(const FunctionDecl* FD) {
   // Build the CFG (control-flow graph) of FD.
   m_BlockData.resize(m_AnalysisDC->getCFG()->size());
+  m_CFGQueue.resize(m_AnalysisDC->getCFG()->size());
+  m_Vars.collect(FD);
+  m_LoopMem.resize(m_Vars.size());
   // Set current block ID to the ID of entry the block.
   CFGBlock& exit = m_AnalysisDC->getCFG()->getExit();
   m_CurBlockID = exit.getBlockID();
-  m_BlockData[m_CurBlockID] = createNewVarsData({});
+  m_BlockData[m_CurBlockID] = createNewVarsData(VarsData(m_Vars.size()));
   // Add the entry block to the queue.
   m_CFGQueue.insert(m_CurBlockID);
 
   // Visit CFG blocks in the queue until it's empty.
   while (!m_CFGQueue.empty()) {
-    auto IDIter = m_CFGQueue.begin();
-    m_CurBlockID = *IDIter;
-    m_CFGQueue.erase(IDIter);
+    m_CurBlockID = m_CFGQueue.pop();
     CFGBlock& nextBlock = *getCFGBlockByID(m_CurBlockID);
     AnalyzeCFGBlock(nextBlock);
   }
@@ -29,19 +30,19 @@ CFGBlock* UsefulAnalyzer::getCFGBlockByID(unsigned ID) {
 }
 
 bool UsefulAnalyzer::isUseful(const VarDecl* VD) const {
-  const VarsData& curBranch = getCurBlockVarsData();
-  return curBranch.find(VD) != curBranch.end();
+  unsigned Index = 0;
+  return m_Vars.lookup(VD, Index) && getCurBlockVarsData().test(Index);
 }
 
 void UsefulAnalyzer::copyVarToCurBlock(const clang::VarDecl* VD) {
-  VarsData& curBranch = getCurBlockVarsData();
-  curBranch.insert(VD);
+  unsigned Index = 0;
+  if (m_Vars.lookup(VD, Index))
+    getCurBlockVarsData().set(Index);
 }
 
-static void mergeVarsData(std::set<const clang::VarDecl*>* targetData,
-                          std::set<const clang::VarDecl*>* mergeData) {
-  for (const clang::VarDecl* i : *mergeData)
-    targetData->insert(i);
+static void mergeVarsData(llvm::BitVector* targetData,
+                          llvm::BitVector* mergeData) {
+  *targetData |= *mergeData;
   *mergeData = *targetData;
 }
 
@@ -69,8 +70,7 @@ void UsefulAnalyzer::AnalyzeCFGBlock(const CFGBlock& block) {
       if (m_LoopMem == *m_BlockData[block.getBlockID()])
         shouldPushPred = false;
 
-      for (const VarDecl* i : *m_BlockData[block.getBlockID()])
-        m_LoopMem.insert(i);
+      m_LoopMem |= *m_BlockData[block.getBlockID()];
     }
 
     if (shouldPushPred)
@@ -79,8 +79,8 @@ void UsefulAnalyzer::AnalyzeCFGBlock(const CFGBlock& block) {
     mergeVarsData(predData.get(), m_BlockData[block.getBlockID()].get());
   }
 
-  for (const VarDecl* i : *m_BlockData[block.getBlockID()])
-    m_UsefulDecls.insert(i);
+  for (unsigned i : m_BlockData[block.getBlockID()]->set_bits())
+    m_UsefulDecls.insert(m_Vars.getDecl(i));
 }
 
 bool UsefulAnalyzer::VisitBinaryOperator(BinaryOperator* BinOp) {
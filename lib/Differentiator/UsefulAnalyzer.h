@@ -4,11 +4,16 @@
 #include "clang/Analysis/AnalysisDeclContext.h"
 #include "clang/Analysis/CFG.h"
 
+#include "AnalysisBase.h"
+
 #include "clad/Differentiator/CladUtils.h"
 #include "clad/Differentiator/Compatibility.h"
 
+#include "llvm/ADT/BitVector.h"
+
 #include <algorithm>
 #include <memory>
+#include <set>
 #include <stack>
 
 namespace clad {
@@ -20,7 +25,10 @@ class UsefulAnalyzer : public clang::RecursiveASTVisitor<UsefulAnalyzer> {
 
   std::set<const clang::VarDecl*>& m_UsefulDecls;
   // std::set<const clang::VarDecl*>& m_VariedDecls;
-  using VarsData = std::set<const clang::VarDecl*>;
+  /// The useful variables of a block, indexed by m_Vars. Joins and loop
+  /// re-visits only copy and OR bit vectors.
+  using VarsData = llvm::BitVector;
+  VarNumbering m_Vars;
   /// A helper method to allocate VarsData
   /// \param toAssign - Parameter to initialize new VarsData with.
   /// \return Unique pointer to a new object of type Varsdata.
@@ -35,7 +43,7 @@ class UsefulAnalyzer : public clang::RecursiveASTVisitor<UsefulAnalyzer> {
   std::unique_ptr<clang::CFG> m_CFG;
   std::vector<std::unique_ptr<VarsData>> m_BlockData;
   unsigned m_CurBlockID{};
-  std::set<unsigned> m_CFGQueue;
+  CFGWorklist m_CFGQueue{/*Backward=*/true};
   bool isUseful(const clang::VarDecl* VD) const;
   void copyVarToCurBlock(const clang::VarDecl* VD);
   VarsData& getCurBlockVarsData() { return *m_BlockData[m_CurBlockID]; }
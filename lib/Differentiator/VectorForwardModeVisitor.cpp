@@ -10,6 +10,7 @@
 #include "clang/Sema/Lookup.h"
 
 #include "llvm/Support/SaveAndRestore.h"
+#include "llvm/Support/TimeProfiler.h"
 
 using namespace clang;
 
@@ -176,12 +177,16 @@ DerivativeAndOverload VectorForwardModeVisitor::Derive() {
   }
 
   // Traverse the function body and generate the derivative.
-  Stmt* BodyDiff = Visit(FD->getBody()).getStmt();
-  if (auto CS = dyn_cast<CompoundStmt>(BodyDiff))
-    for (Stmt* S : CS->body())
-      addToCurrentBlock(S);
-  else
-    addToCurrentBlock(BodyDiff);
+  {
+    llvm::TimeTraceScope TS("Differentiate body",
+                            [this]() { return (std::string)m_DiffReq; });
+    Stmt* BodyDiff = Visit(FD->getBody()).getStmt();
+    if (auto CS = dyn_cast<CompoundStmt>(BodyDiff))
+      for (Stmt* S : CS->body())
+        addToCurrentBlock(S);
+    else
+      addToCurrentBlock(BodyDiff);
+  }
 
   Stmt* vectorDiffBody = endBlock();
   m_Derivative->setBody(vectorDiffBody);
@@ -59,8 +59,16 @@ VectorPushForwardModeVisitor::VisitReturnStmt(const clang::ReturnStmt* RS) {
     return nullptr;
 
   StmtDiff retValDiff = Visit(RS->getRetValue());
-  llvm::SmallVector<Expr*, 2> returnValues = {retValDiff.getExpr(),
-                                              retValDiff.getExpr_dx()};
+  Expr* retDx = retValDiff.getExpr_dx();
+  // The derivative vector is usually a local clad::array. Move it into the
+  // result instead of copying its elements, as for a plain return.
+  if (const auto* DRE = dyn_cast<DeclRefExpr>(retDx->IgnoreImplicit()))
+    if (const auto* VD = dyn_cast<VarDecl>(DRE->getDecl()))
+      if (VD->hasLocalStorage() && VD->getType()->isRecordType()) {
+        llvm::SmallVector<Expr*, 1> moveArg = {retDx};
+        retDx = GetFunctionCall("move", "std", moveArg);
+      }
+  llvm::SmallVector<Expr*, 2> returnValues = {retValDiff.getExpr(), retDx};
   // This can instantiate as part of the move or copy initialization and
   // needs a fake source location.
   SourceLocation fakeLoc = utils::GetValidSLoc(m_Sema);
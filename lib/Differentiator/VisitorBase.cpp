@@ -995,7 +995,7 @@ namespace clad {
         m_Sema, m_DiffReq.Function, m_DiffReq.Mode, diffParams,
         /*forCustomDerv=*/false,
         /*shouldUseRestoreTracker=*/m_DiffReq.UseRestoreTracker,
-        m_DiffReq.EnableErrorEstimation);
+        m_DiffReq.EnableErrorEstimation, m_DiffReq.UseErrorAccumulator);
   }
 
   FunctionDecl* VisitorBase::FindDerivedFunction(DiffRequest& request) {
@@ -0,0 +1,50 @@
+// RUN: %cladclang %s -I%S/../../include -oSharedResults.out \
+// RUN:     -Xclang -print-stats 2>&1 | %filecheck -check-prefix=CHECK_TBR %s
+// RUN: ./SharedResults.out | %filecheck_exec %s
+// RUN: %cladclang %s -I%S/../../include -oSharedResults.out \
+// RUN:     -Xclang -plugin-arg-clad -Xclang -enable-va \
+// RUN:     -Xclang -print-stats 2>&1 | %filecheck -check-prefix=CHECK_VA %s
+// RUN: ./SharedResults.out | %filecheck_exec %s
+
+#include "clad/Differentiator/Differentiator.h"
+
+// The pullback of scale is needed from five call sites, its analyses are
+// computed once and reused for the other four. The gradients of f w.r.t. x
+// and w.r.t. both parameters are analyzed separately.
+void scale(double& a, double b) { a *= b; }
+
+double f(double x, double y) {
+  scale(x, y);
+  scale(x, y);
+  return x;
+}
+
+double g(double x, double y) {
+  scale(y, x);
+  return x + y;
+}
+
+// TBR runs for f, f w.r.t. x, g and the first pullback of scale.
+// CHECK_TBR: *** INFORMATION ABOUT THE ANALYSES
+// CHECK_TBR-NEXT: 4 reused, 4 computed
+
+// The varied analysis follows the same call graph.
+// CHECK_VA: *** INFORMATION ABOUT THE ANALYSES
+// CHECK_VA-NEXT: 8 reused, 8 computed
+
+int main() {
+  double dx = 0, dy = 0;
+  auto f_grad = clad::gradient(f);
+  f_grad.execute(2, 3, &dx, &dy);
+  printf("%.2f %.2f\n", dx, dy); // CHECK-EXEC: 9.00 12.00
+
+  dx = 0;
+  auto f_dx = clad::gradient(f, "x");
+  f_dx.execute(2, 3, &dx);
+  printf("%.2f\n", dx); // CHECK-EXEC: 9.00
+
+  dx = 0, dy = 0;
+  auto g_grad = clad::gradient(g);
+  g_grad.execute(2, 3, &dx, &dy);
+  printf("%.2f %.2f\n", dx, dy); // CHECK-EXEC: 4.00 2.00
+}
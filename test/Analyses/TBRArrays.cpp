@@ -0,0 +1,51 @@
+// RUN: %cladclang %s -I%S/../../include -oTBRArrays.out 2>&1 | %filecheck %s
+// RUN: ./TBRArrays.out | %filecheck_exec %s
+// RUN: %cladclang -Xclang -plugin-arg-clad -Xclang -disable-tbr %s -I%S/../../include -oTBRArrays.out
+// RUN: ./TBRArrays.out | %filecheck_exec %s
+
+#include "clad/Differentiator/Differentiator.h"
+
+// Every iteration writes and reads its own element of y, the values of the
+// previous iterations are not overwritten.
+double stencil(double* x) {
+  double y[4] = {0};
+  double s = 0;
+  for (int i = 1; i < 3; i++) {
+    y[i] = x[i - 1] * x[i + 1];
+    s += y[i] * y[i];
+  }
+  return s;
+}
+
+// CHECK: void stencil_grad(double *x, double *_d_x) {
+// CHECK-NOT: clad::push({{.*}}, y[i])
+// CHECK: _d_s += 1;
+
+// The element is read before it is overwritten in the same iteration.
+double overwrite(double* x) {
+  double y[3] = {0};
+  double s = 0;
+  for (int i = 0; i < 3; i++) {
+    y[i] = x[i];
+    s += y[i] * y[i];
+    y[i] = s;
+  }
+  return s;
+}
+
+// CHECK: void overwrite_grad(double *x, double *_d_x) {
+// CHECK: clad::push({{.*}}, y[i]);
+// CHECK: _d_s += 1;
+
+int main() {
+  double x[4] = {1, 2, 3, 4};
+  double dx[4] = {0};
+  auto stencil_grad = clad::gradient(stencil);
+  stencil_grad.execute(x, dx);
+  printf("%.2f %.2f %.2f %.2f\n", dx[0], dx[1], dx[2], dx[3]); // CHECK-EXEC: 18.00 64.00 6.00 32.00
+
+  double dx2[3] = {0};
+  auto overwrite_grad = clad::gradient(overwrite);
+  overwrite_grad.execute(x, dx2);
+  printf("%.2f %.2f %.2f\n", dx2[0], dx2[1], dx2[2]); // CHECK-EXEC: 2.00 4.00 6.00
+}
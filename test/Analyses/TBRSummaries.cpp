@@ -0,0 +1,102 @@
+// RUN: %cladclang %s -I%S/../../include -oTBRSummaries.out \
+// RUN:     -Xclang -plugin-arg-clad -Xclang -enable-tbr-summaries 2>&1 | %filecheck %s
+// RUN: ./TBRSummaries.out | %filecheck_exec %s
+// RUN: %cladclang %s -I%S/../../include -oTBRSummaries.out
+// RUN: ./TBRSummaries.out | %filecheck_exec %s
+
+#include "clad/Differentiator/Differentiator.h"
+
+// The pullback of lin does not read its parameters, x does not have to be
+// stored before it is overwritten.
+double lin(double a, double b) { return 2 * a + b; }
+
+double f1(double x, double y) {
+  double s = 0;
+  for (int i = 0; i < 3; i++) {
+    s += lin(x, y);
+    x = x + 1;
+  }
+  return s;
+}
+
+// CHECK: void f1_grad(double x, double y, double *_d_x, double *_d_y) {
+// CHECK-NOT: clad::push({{.*}}, x)
+// CHECK: _d_s += 1;
+
+// The pullback of sq reads its parameter.
+double sq(double a) { return a * a; }
+
+double f2(double x) {
+  double s = 0;
+  for (int i = 0; i < 3; i++) {
+    s += sq(x);
+    x = x + 1;
+  }
+  return s;
+}
+
+// CHECK: void f2_grad(double x, double *_d_x) {
+// CHECK: clad::push({{.*}}, x);
+// CHECK: _d_s += 1;
+
+// The parameter is used linearly but flows into a local variable which the
+// pullback reads.
+double viaLocal(double a) {
+  double t = 3 * a;
+  return t * t;
+}
+
+double f3(double x) {
+  double s = 0;
+  for (int i = 0; i < 3; i++) {
+    s += viaLocal(x);
+    x = x + 1;
+  }
+  return s;
+}
+
+// CHECK: void f3_grad(double x, double *_d_x) {
+// CHECK: clad::push({{.*}}, x);
+// CHECK: _d_s += 1;
+
+// The parameter only decides the branch, the pullback still needs it.
+double branch(double a, double b) {
+  if (a > 0)
+    return b;
+  return -b;
+}
+
+double f4(double x, double y) {
+  double s = 0;
+  for (int i = 0; i < 3; i++) {
+    s += branch(x, y);
+    x = x - 1;
+  }
+  return s;
+}
+
+// CHECK: void f4_grad(double x, double y, double *_d_x, double *_d_y) {
+// CHECK: clad::push({{.*}}, x);
+// CHECK: _d_s += 1;
+
+int main() {
+  double dx = 0, dy = 0;
+  auto f1_grad = clad::gradient(f1);
+  f1_grad.execute(2, 3, &dx, &dy);
+  printf("%.2f %.2f\n", dx, dy); // CHECK-EXEC: 6.00 3.00
+
+  dx = 0;
+  auto f2_grad = clad::gradient(f2);
+  f2_grad.execute(2, &dx);
+  printf("%.2f\n", dx); // CHECK-EXEC: 18.00
+
+  dx = 0;
+  auto f3_grad = clad::gradient(f3);
+  f3_grad.execute(2, &dx);
+  printf("%.2f\n", dx); // CHECK-EXEC: 162.00
+
+  dx = 0, dy = 0;
+  auto f4_grad = clad::gradient(f4);
+  f4_grad.execute(1, 3, &dx, &dy);
+  printf("%.2f %.2f\n", dx, dy); // CHECK-EXEC: 0.00 -1.00
+}
@@ -25,10 +25,16 @@
 #include "clang/Frontend/FrontendPluginRegistry.h"
 #include "clang/Frontend/MultiplexConsumer.h"
 #include "clang/Lex/LexDiagnostic.h"
+#include "clang/Parse/Parser.h"
 #include "clang/Sema/Lookup.h"
+#include "clang/Sema/Scope.h"
 #include "clang/Sema/Sema.h"
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SaveAndRestore.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -42,6 +48,7 @@
 #include <iostream> // for std::cerr
 #include <memory>
 #include <set>
+#include <sstream>
 
 using namespace clang;
 
@@ -143,6 +150,12 @@ void InitTimers();
       auto predefines = m_CI.getPreprocessor().getPredefines();
       predefines.append("#define __CLAD__ 1\n");
       m_CI.getPreprocessor().setPredefines(predefines);
+
+      if (!m_DO.DerivativeCachePath.empty())
+        m_DerivativeCache =
+            std::make_unique<DerivativeCache>(m_DO.DerivativeCachePath);
+      if (!m_DO.DerivativeLibraryPath.empty())
+        m_DerivativeLibrary = std::make_unique<DerivativeLibrary>();
     }
 
     CladPlugin::~CladPlugin() {}
@@ -187,13 +200,15 @@ void InitTimers();
           auto* FD = cast<FunctionDecl>(D);
           if (FD->isConstexpr() || !m_Multiplexer) {
             DiffCollector collector(DGR, CladEnabledRange, m_DiffRequestGraph,
-                                    S, opts, m_AllAnalysisDC);
+                                    S, opts, m_AnalysisManager);
             break;
           }
         }
       }
 
-      for (DiffRequest& request : m_DiffRequestGraph.getNodes()) {
+      // Processing may add nodes to the graph, iterate by index over copies.
+      for (size_t i = 0; i < m_DiffRequestGraph.getNodes().size(); ++i) {
+        DiffRequest request = m_DiffRequestGraph.getNodes()[i];
         if (request.ImmediateMode && request.Function->isConstexpr()) {
           m_DiffRequestGraph.setCurrentProcessingNode(request);
           ProcessDiffRequest(request);
@@ -208,12 +223,19 @@ void InitTimers();
         FinalizeTranslationUnit();
     }
 
-    static void printDerivative(clang::Decl* D, bool DeclarationOnly,
-                                const DifferentiationOptions& DO) {
+    /// The policy used to print derivatives as source code which can be
+    /// compiled on its own.
+    static clang::PrintingPolicy getDerivativePrintingPolicy() {
       clang::LangOptions LangOpts;
       LangOpts.CPlusPlus = true;
       clang::PrintingPolicy Policy(LangOpts);
       Policy.Bool = true;
+      return Policy;
+    }
+
+    static void printDerivative(clang::Decl* D, bool DeclarationOnly,
+                                const DifferentiationOptions& DO) {
+      clang::PrintingPolicy Policy = getDerivativePrintingPolicy();
 
       // if enabled, print source code of the derivatives
       if (DO.DumpDerivedFn) {
@@ -238,6 +260,131 @@ void InitTimers();
       }
     }
 
+    /// Parses the top-level declarations in Code at the end of the translation
+    /// unit with the parser of the main file.
+    /// \returns false if the code does not parse without errors.
+    static bool parseTopLevelDecls(CompilerInstance& CI, llvm::StringRef Code,
+                                   llvm::SmallVectorImpl<Decl*>& Decls) {
+      Preprocessor& PP = CI.getPreprocessor();
+      // The parser of the main file is alive until the consumers are done
+      // with the translation unit, it registers itself as the code completion
+      // handler. A second parser would register its pragma handlers again.
+      auto* P = static_cast<Parser*>(PP.getCodeCompletionHandler());
+      if (!P || P->getCurToken().isNot(tok::eof))
+        return false;
+
+      SourceManager& SM = CI.getSourceManager();
+      std::unique_ptr<llvm::MemoryBuffer> Buffer =
+          llvm::MemoryBuffer::getMemBufferCopy(Code, "<clad derivative cache>");
+      FileID FID = SM.createFileID(
+          std::move(Buffer), SrcMgr::C_User, /*LoadedID=*/0,
+          /*LoadedOffset=*/0, SM.getLocForEndOfFile(SM.getMainFileID()));
+      if (PP.EnterSourceFile(FID, /*Dir=*/nullptr, SourceLocation()))
+        return false;
+
+      // A stale entry must not break the compilation, the derivative is then
+      // generated as usual.
+      DiagnosticsEngine& Diags = CI.getDiagnostics();
+      bool SuppressAll = Diags.getSuppressAllDiagnostics();
+      Diags.setSuppressAllDiagnostics(true);
+      DiagnosticErrorTrap Trap(Diags);
+      Sema& S = CI.getSema();
+      llvm::SaveAndRestore<DeclContext*> SaveContext(
+          S.CurContext, S.getASTContext().getTranslationUnitDecl());
+      P->ConsumeToken();
+      // Stop before the parser sees the end of the buffer, it would act on the
+      // end of the translation unit once more.
+      while (P->getCurToken().isNot(tok::eof)) {
+        Parser::DeclGroupPtrTy DG;
+#if CLANG_VERSION_MAJOR < 15
+        P->ParseTopLevelDecl(DG);
+#else
+        Sema::ModuleImportState ImportState =
+            Sema::ModuleImportState::NotACXX20Module;
+        P->ParseTopLevelDecl(DG, ImportState);
+#endif
+        if (DG)
+          for (Decl* D : DG.get())
+            Decls.push_back(D);
+      }
+      Diags.setSuppressAllDiagnostics(SuppressAll);
+      return !Trap.hasErrorOccurred();
+    }
+
+    /// Removes declarations parsed from a broken cache entry so that they do
+    /// not clash with the derivative generated instead.
+    static void discardParsedDecls(Sema& S, llvm::ArrayRef<Decl*> Decls) {
+      for (Decl* D : Decls) {
+        D->setInvalidDecl();
+        if (auto* FD = dyn_cast<FunctionDecl>(D))
+          FD->setBody(nullptr);
+        if (auto* ND = dyn_cast<NamedDecl>(D)) {
+          S.IdResolver.RemoveDecl(ND);
+          if (S.TUScope)
+            S.TUScope->RemoveDecl(ND);
+        }
+        D->getLexicalDeclContext()->removeDecl(D);
+      }
+    }
+
+    DerivativeAndOverload
+    CladPlugin::LoadCachedDerivative(const DiffRequest& request) {
+      // Only the standard setup parses the main file with a parser we can
+      // reuse.
+      if (!m_DerivativeCache || !m_Multiplexer ||
+          !DerivativeCache::isCacheable(request))
+        return {};
+      std::string Key = m_DerivativeCache->getKey(request);
+      std::string Source;
+      if (!m_DerivativeCache->lookup(Key, Source))
+        return {};
+
+      TimedGenerationRegion R([&request]() {
+        return "Cached " + request.BaseFunctionName + " (" +
+               DiffModeToString(request.Mode) + ")";
+      });
+      // An entry holds the derivative followed by its overload, if any.
+      llvm::SmallVector<Decl*, 2> Decls;
+      bool Parsed = parseTopLevelDecls(m_CI, Source, Decls);
+      llvm::SmallVector<FunctionDecl*, 2> FDs;
+      for (Decl* D : Decls)
+        if (auto* FD = dyn_cast<FunctionDecl>(D))
+          if (FD->hasBody() && !FD->isInvalidDecl())
+            FDs.push_back(FD);
+      if (!Parsed || FDs.empty() || FDs.size() > 2 ||
+          FDs.size() != Decls.size()) {
+        discardParsedDecls(m_CI.getSema(), Decls);
+        m_DerivativeCache->erase(Key);
+        return {};
+      }
+      return {FDs[0], FDs.size() > 1 ? FDs[1] : nullptr};
+    }
+
+    void
+    CladPlugin::StoreCachedDerivative(const DiffRequest& request,
+                                      const DerivativeAndOverload& result) {
+      if (!m_DerivativeCache || !DerivativeCache::isCacheable(request) ||
+          m_CI.getDiagnostics().hasErrorOccurred())
+        return;
+      auto* FD = dyn_cast_or_null<FunctionDecl>(result.derivative);
+      if (!FD || !FD->hasBody() || FD->isInvalidDecl() ||
+          !DerivativeCache::isSelfContained(FD, m_DFC))
+        return;
+
+      // Reuse the printing of -fgenerate-source-file.
+      clang::PrintingPolicy Policy = getDerivativePrintingPolicy();
+      std::string Source;
+      llvm::raw_string_ostream OS(Source);
+      FD->print(OS, Policy);
+      OS << "\n";
+      if (result.overload) {
+        result.overload->print(OS, Policy);
+        OS << "\n";
+      }
+      OS.flush();
+      m_DerivativeCache->store(m_DerivativeCache->getKey(request), Source);
+    }
+
     static void addCladLoopCheckpoints(ASTContext& C, DiffRequest& request) {
       SourceRange range = request->getSourceRange();
       assert(range.isValid());
@@ -303,6 +450,8 @@ void InitTimers();
       if (m_DO.PrintNumDiffErrorInfo) {
         m_DerivativeBuilder->setNumDiffErrDiag(true);
       }
+      if (m_DO.NumDiffComplexStep)
+        m_DerivativeBuilder->setNumDiffComplexStep(true);
 
       // Propagate relevant pragmas to diffrequests
       addCladLoopCheckpoints(C, request);
@@ -319,9 +468,33 @@ void InitTimers();
           OverloadedDerivativeDecl = DFI.OverloadedDerivedFn();
           alreadyDerived = true;
         } else {
-          auto deriveResult = m_DerivativeBuilder->Derive(request);
+          llvm::TimeRecord StartTime;
+          size_t StartMemory = 0;
+          if (m_DO.PrintDerivativeStats) {
+            StartTime = llvm::TimeRecord::getCurrentTime(/*Start=*/true);
+            StartMemory = C.getASTAllocatedMemory();
+          }
+          DerivativeAndOverload deriveResult = LoadCachedDerivative(request);
+          if (!deriveResult.derivative) {
+            deriveResult = m_DerivativeBuilder->Derive(request);
+            StoreCachedDerivative(request, deriveResult);
+          }
           DerivativeDecl = cast_or_null<FunctionDecl>(deriveResult.derivative);
           OverloadedDerivativeDecl = deriveResult.overload;
+          if (m_DerivativeLibrary && !request.DeclarationOnly &&
+              (!request.CustomDerivative || request.CallUpdateRequired)) {
+            m_DerivativeLibrary->addDerivative(DerivativeDecl);
+            m_DerivativeLibrary->addDerivative(OverloadedDerivativeDecl);
+          }
+          if (m_DO.PrintDerivativeStats && DerivativeDecl) {
+            DerivativeStats Stats;
+            llvm::TimeRecord EndTime =
+                llvm::TimeRecord::getCurrentTime(/*Start=*/false);
+            Stats.WallTime = EndTime.getWallTime() - StartTime.getWallTime();
+            Stats.Memory = C.getASTAllocatedMemory() - StartMemory;
+            Stats.collect(request, DerivativeDecl, m_DFC);
+            m_DerivativeStats.push_back(Stats);
+          }
           // FIXME: Doing this with other function types might lead to
           // accidental numerical diff.
           if (isa<CXXConstructorDecl>(FD) &&
@@ -375,9 +548,13 @@ void InitTimers();
                                     request.RequestedDerivativeOrder);
         // If this is the last required derivative order, replace the function
         // inside a call to clad::differentiate/gradient with its derivative.
-        if (request.CallUpdateRequired && lastDerivativeOrder)
+        if (request.CallUpdateRequired && lastDerivativeOrder) {
           request.updateCall(DerivativeDecl, OverloadedDerivativeDecl,
                              m_CI.getSema());
+          if (m_DerivativeLibrary)
+            m_DerivativeLibrary->addEntry(request, DerivativeDecl,
+                                          OverloadedDerivativeDecl);
+        }
 
         if (request.DeclarationOnly)
           request.DerivedFDPrototypes.push_back(DerivativeDecl);
@@ -482,6 +659,7 @@ void InitTimers();
         opts.EnableTBRAnalysis = DO.EnableTBRAnalysis && !DO.DisableTBRAnalysis;
       else
         opts.EnableTBRAnalysis = true; // Default mode.
+      opts.EnableTBRSummaries = DO.EnableTBRSummaries;
     }
 
     static void SetActivityAnalysisOptions(const DifferentiationOptions& DO,
@@ -542,7 +720,27 @@ void InitTimers();
       GlobalInstantiations.perform();
     }
 
+    /// Writes the time trace recorded since timeTraceProfilerInitialize to
+    /// \p Path and releases the profiler.
+    static void writeTimeTrace(llvm::StringRef Path) {
+      std::error_code EC;
+      llvm::raw_fd_ostream OS(Path, EC, llvm::sys::fs::OF_Text);
+      if (EC)
+        llvm::errs() << "clad: Error: cannot write the time trace to '"
+                     << Path << "': " << EC.message() << "\n";
+      else
+        llvm::timeTraceProfilerWrite(OS);
+      llvm::timeTraceProfilerCleanup();
+    }
+
     void CladPlugin::HandleTranslationUnit(ASTContext& C) {
+      // If clang's -ftime-trace is enabled, the spans of clad end up in its
+      // trace. Otherwise, trace the work done by clad at the end of the
+      // translation unit, where the bulk of the derivatives is produced.
+      bool OwnsTimeTrace =
+          !m_DO.TimeTracePath.empty() && !llvm::timeTraceProfilerEnabled();
+      if (OwnsTimeTrace)
+        llvm::timeTraceProfilerInitialize(/*TimeTraceGranularity=*/0, "clad");
       // In case of diagnostics, don't bother, just let the compiler finish.
       if (!m_CI.getDiagnostics().hasErrorOccurred()) {
         Sema& S = m_CI.getSema();
@@ -558,7 +756,7 @@ void InitTimers();
                 continue;
             DiffCollector collector(DCI.m_DGR, CladEnabledRange,
                                     m_DiffRequestGraph, S, opts,
-                                    m_AllAnalysisDC);
+                                    m_AnalysisManager);
             break;
           }
 
@@ -570,10 +768,43 @@ void InitTimers();
 
         FinalizeTranslationUnit();
         SendToMultiplexer();
+
+        if (m_DO.PrintDerivativeStats)
+          PrintDerivativeStats();
+
+        if (m_DerivativeLibrary)
+          WriteDerivativeLibrary();
       }
+      // Write the trace before handing over to the rest of the compiler so
+      // that it contains no unfinished spans.
+      if (OwnsTimeTrace)
+        writeTimeTrace(m_DO.TimeTracePath);
       m_Multiplexer->HandleTranslationUnit(C);
     }
 
+    void CladPlugin::WriteDerivativeLibrary() {
+      const std::string& Path = m_DO.DerivativeLibraryPath;
+      std::error_code EC;
+      llvm::raw_fd_ostream OS(Path, EC, llvm::sys::fs::OF_Text);
+      if (EC) {
+        llvm::errs() << "clad: Error: cannot write the derivative library to '"
+                     << Path << "': " << EC.message() << "\n";
+        return;
+      }
+      m_DerivativeLibrary->print(OS, m_CI.getSourceManager(), m_DFC);
+    }
+
+    void CladPlugin::PrintDerivativeStats() {
+      llvm::errs() << "\n*** INFORMATION ABOUT THE DERIVED FUNCTIONS\n";
+      for (const DerivativeStats& Stats : m_DerivativeStats)
+        Stats.print(llvm::errs());
+
+      llvm::errs() << "\n*** GRAPH OF THE DIFF REQUESTS\n";
+      std::ostringstream GraphOS;
+      m_DiffRequestGraph.printDOT(GraphOS, "DiffRequests");
+      llvm::errs() << GraphOS.str();
+    }
+
     void CladPlugin::PrintStats() {
       llvm::errs() << "*** INFORMATION ABOUT THE DELAYED CALLS\n";
       for (const DelayedCallInfo& DCI : m_DelayedCalls) {
@@ -630,6 +861,18 @@ void InitTimers();
         llvm::errs() << "\n";
       }
 
+      llvm::errs() << "*** INFORMATION ABOUT THE ANALYSES\n";
+      llvm::errs() << "   " << m_AnalysisManager.getNumHits() << " reused, "
+                   << m_AnalysisManager.getNumMisses() << " computed\n";
+
+      if (m_DerivativeCache) {
+        llvm::errs() << "*** INFORMATION ABOUT THE DERIVATIVE CACHE\n";
+        llvm::errs() << "   " << m_DerivativeCache->getNumHits() << " hits, "
+                     << m_DerivativeCache->getNumMisses() << " misses, "
+                     << m_DerivativeCache->getNumStores() << " stores, "
+                     << m_DerivativeCache->getNumDiscarded() << " discarded\n";
+      }
+
       m_Multiplexer->PrintStats();
     }
 
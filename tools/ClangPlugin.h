@@ -8,6 +8,9 @@
 #define CLAD_CLANG_PLUGIN
 
 #include "clad/Differentiator/DerivativeBuilder.h"
+#include "clad/Differentiator/DerivativeCache.h"
+#include "clad/Differentiator/DerivativeLibrary.h"
+#include "clad/Differentiator/DerivativeStats.h"
 #include "clad/Differentiator/DerivedFnCollector.h"
 #include "clad/Differentiator/DiffMode.h"
 #include "clad/Differentiator/DiffPlanner.h"
@@ -31,6 +34,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 namespace clang {
   class ASTContext;
@@ -51,9 +55,11 @@ struct DifferentiationOptions {
       : DumpSourceFn(false), DumpSourceFnAST(false), DumpDerivedFn(false),
         DumpDerivedAST(false), GenerateSourceFile(false),
         ValidateClangVersion(true), EnableTBRAnalysis(false),
-        DisableTBRAnalysis(false), EnableVariedAnalysis(false),
+        DisableTBRAnalysis(false), EnableTBRSummaries(false),
+        EnableVariedAnalysis(false),
         DisableVariedAnalysis(false), EnableUsefulAnalysis(false),
-        DisableUsefulAnalysis(false), PrintNumDiffErrorInfo(false) {}
+        DisableUsefulAnalysis(false), PrintNumDiffErrorInfo(false),
+        NumDiffComplexStep(false), PrintDerivativeStats(false) {}
 
   bool DumpSourceFn : 1;
   bool DumpSourceFnAST : 1;
@@ -63,11 +69,20 @@ struct DifferentiationOptions {
   bool ValidateClangVersion : 1;
   bool EnableTBRAnalysis : 1;
   bool DisableTBRAnalysis : 1;
+  bool EnableTBRSummaries : 1;
   bool EnableVariedAnalysis : 1;
   bool DisableVariedAnalysis : 1;
   bool EnableUsefulAnalysis : 1;
   bool DisableUsefulAnalysis : 1;
   bool PrintNumDiffErrorInfo : 1;
+  bool NumDiffComplexStep : 1;
+  bool PrintDerivativeStats : 1;
+  /// The directory of the on-disk derivative cache, empty if disabled.
+  std::string DerivativeCachePath;
+  /// The file the Chrome trace of clad is written to, empty if disabled.
+  std::string TimeTracePath;
+  /// The file the derivative library is written to, empty if disabled.
+  std::string DerivativeLibraryPath;
 };
 
     class CladExternalSource : public clang::ExternalSemaSource {
@@ -102,7 +117,12 @@ struct DifferentiationOptions {
     bool m_HasRuntime = false;
     DerivedFnCollector m_DFC;
     DynamicGraph<DiffRequest> m_DiffRequestGraph;
-    OwnedAnalysisContexts m_AllAnalysisDC;
+    AnalysisManager m_AnalysisManager;
+    std::unique_ptr<DerivativeCache> m_DerivativeCache;
+    /// The derivatives written with -fderivative-library.
+    std::unique_ptr<DerivativeLibrary> m_DerivativeLibrary;
+    /// The statistics of the derived functions, collected with -stats.
+    std::vector<DerivativeStats> m_DerivativeStats;
     enum class CallKind {
       HandleCXXStaticMemberVarInstantiation,
       HandleTopLevelDecl,
@@ -266,6 +286,18 @@ struct DifferentiationOptions {
     void SendToMultiplexer();
     bool CheckBuiltins();
     void SetRequestOptions(RequestOptions& opts) const;
+    /// Re-parses the derivative of the request from the derivative cache.
+    /// \returns the derivative and its overload, or nothing if there is no
+    /// usable entry.
+    DerivativeAndOverload LoadCachedDerivative(const DiffRequest& request);
+    /// Stores the source of a freshly generated derivative in the cache.
+    void StoreCachedDerivative(const DiffRequest& request,
+                               const DerivativeAndOverload& result);
+    /// Prints the statistics collected with -stats.
+    void PrintDerivativeStats();
+    /// Writes the derivatives of the translation unit and their registry to
+    /// the file given with -fderivative-library.
+    void WriteDerivativeLibrary();
 
     void ProcessTopLevelDecl(clang::Decl* D) {
       DelayedCallInfo DCI{CallKind::HandleTopLevelDecl, D};
@@ -315,6 +347,8 @@ struct DifferentiationOptions {
             m_DO.EnableTBRAnalysis = true;
           } else if (args[i] == "-disable-tbr") {
             m_DO.DisableTBRAnalysis = true;
+          } else if (args[i] == "-enable-tbr-summaries") {
+            m_DO.EnableTBRSummaries = true;
           } else if (args[i] == "-enable-va") {
             m_DO.EnableVariedAnalysis = true;
           } else if (args[i] == "-disable-va") {
@@ -329,6 +363,35 @@ struct DifferentiationOptions {
             return false;
           } else if (args[i] == "-fprint-num-diff-errors") {
             m_DO.PrintNumDiffErrorInfo = true;
+          } else if (args[i] == "-fnum-diff-complex-step") {
+            m_DO.NumDiffComplexStep = true;
+          } else if (args[i] == "-stats") {
+            m_DO.PrintDerivativeStats = true;
+          } else if (llvm::StringRef(args[i]).starts_with(
+                         "-fderivative-cache=")) {
+            m_DO.DerivativeCachePath =
+                llvm::StringRef(args[i]).split('=').second.str();
+            if (m_DO.DerivativeCachePath.empty()) {
+              llvm::errs() << "clad: Error: -fderivative-cache requires a "
+                              "directory.\n";
+              return false;
+            }
+          } else if (llvm::StringRef(args[i]).starts_with("-ftime-trace=")) {
+            m_DO.TimeTracePath =
+                llvm::StringRef(args[i]).split('=').second.str();
+            if (m_DO.TimeTracePath.empty()) {
+              llvm::errs() << "clad: Error: -ftime-trace requires a file.\n";
+              return false;
+            }
+          } else if (llvm::StringRef(args[i]).starts_with(
+                         "-fderivative-library=")) {
+            m_DO.DerivativeLibraryPath =
+                llvm::StringRef(args[i]).split('=').second.str();
+            if (m_DO.DerivativeLibraryPath.empty()) {
+              llvm::errs() << "clad: Error: -fderivative-library requires a "
+                              "file.\n";
+              return false;
+            }
           } else if (args[i] == "-help") {
             // Print some help info.
             // CI.getFrontendOpts().ShowHelp does not give us control.
@@ -352,11 +415,34 @@ struct DifferentiationOptions {
                 << "-disable-tbr - Ensures that TBR analysis is disabled "
                    "during reverse-mode differentiation unless explicitly "
                    "specified in an individual request.\n"
+                << "-enable-tbr-summaries - Summarizes which parameters the "
+                   "pullbacks of called functions read so that TBR analysis "
+                   "does not store the arguments they only use linearly.\n"
                 << "-fcustom-estimation-model - allows user to send in a "
                    "shared object to use as the custom estimation model.\n"
                 << "-fprint-num-diff-errors - allows users to print the "
                    "calculated numerical diff errors, this flag is overriden "
-                   "by -DCLAD_NO_NUM_DIFF.\n";
+                   "by -DCLAD_NO_NUM_DIFF.\n"
+                << "-fnum-diff-complex-step - Differentiates functions "
+                   "templated on their scalar type numerically with the "
+                   "complex step instead of central differences. Their "
+                   "bodies must compile for std::complex, e.g. must not "
+                   "compare the arguments, otherwise compilation fails.\n"
+                << "-fderivative-cache=<dir> - Stores the generated "
+                   "derivatives in <dir> and re-parses them in later "
+                   "compilations instead of deriving them again, as long as "
+                   "the function, its callees and the records and variables "
+                   "they use are unchanged.\n"
+                << "-ftime-trace=<file> - Writes a Chrome trace (see clang's "
+                   "-ftime-trace) of the differentiation requests, analyses "
+                   "and visitor phases to <file>.\n"
+                << "-fderivative-library=<file> - Writes the derivatives "
+                   "and a registry of the differentiation calls to <file>, "
+                   "to be compiled separately and linked into builds "
+                   "without clad that define CLAD_DERIVATIVE_LIBRARY.\n"
+                << "-stats - Prints the size, the tapes, the nested derivative "
+                   "calls and the cost of every derived function, followed by "
+                   "the graph of the differentiation requests in DOT format.\n";
 
             llvm::errs() << "-help - Prints out this screen.\n\n";
           } else if (args[i] == "-version" || args[i] == "-v") {
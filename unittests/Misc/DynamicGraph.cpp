@@ -1,18 +1,24 @@
 #include "clad/Differentiator/DynamicGraph.h"
 #include "clad/Differentiator/Differentiator.h"
 
+#include <cstddef>
 #include <iostream>
 #include <string>
 
 #include "gtest/gtest.h"
 
+// The number of node comparisons, i.e. of the work done by the lookups.
+static std::size_t NumNodeComparisons = 0;
+
 struct Node {
   std::string name;
-  int id;
+  int id = 0;
 
+  Node() = default;
   Node(std::string name, int id) : name(name), id(id) {}
 
   bool operator==(const Node& other) const {
+    ++NumNodeComparisons;
     return name == other.name && id == other.id;
   }
 
@@ -66,3 +72,55 @@ TEST(DynamicGraphTest, Printing) {
                                "5 -> 6\n";
   EXPECT_EQ(ss.str(), expectedOutput);
 }
+
+TEST(DynamicGraphTest, PrintingDOT) {
+  clad::DynamicGraph<Node> G;
+  Node a("\"a\"", 0);
+  Node b("b", 1);
+  G.addNode(a, /*isSource=*/true);
+  G.addEdge(a, b);
+  G.setCurrentProcessingNode(a);
+  G.markCurrentNodeProcessed();
+
+  std::stringstream ss;
+  G.printDOT(ss, "Requests");
+  std::string expectedOutput = "digraph Requests {\n"
+                               "  n0 [label=\"\\\"a\\\"0\", peripheries=2];\n"
+                               "  n1 [label=\"b1\", style=dashed];\n"
+                               "  n0 -> n1;\n"
+                               "}\n";
+  EXPECT_EQ(ss.str(), expectedOutput);
+}
+
+// Builds graphs shaped like the request graphs of generated code: many source
+// requests, each calling a few shared helpers. Processing must stay linear in
+// the number of nodes, so a lookup may only compare a bounded number of nodes.
+TEST(DynamicGraphTest, Scaling) {
+  for (int n : {1000, 10000, 50000}) {
+    NumNodeComparisons = 0;
+    clad::DynamicGraph<Node> G;
+    for (int i = 0; i < n; i++)
+      G.addNode(Node("source", i), /*isSource=*/true);
+    int numProcessed = 0;
+    for (Node node = G.getNextToProcessNode(); !node.name.empty();
+         node = G.getNextToProcessNode()) {
+      G.setCurrentProcessingNode(node);
+      if (node.name == "source") {
+        G.addEdgeToCurrentNode(Node("helper", node.id % 100));
+        G.addEdgeToCurrentNode(Node("helper", (node.id + 1) % 100));
+      }
+      G.markCurrentNodeProcessed();
+      numProcessed++;
+    }
+
+    EXPECT_EQ(G.getNodes().size(), n + 100);
+    // Every helper is queued once by each of its callers.
+    EXPECT_GE(numProcessed, n + 100);
+    // A source is looked up six times: when it is added, when it is processed
+    // and when each of its two edges is added. A helper is looked up when it
+    // is processed. Only nodes with colliding hashes are compared beyond the
+    // match, a scan of all the nodes would compare O(n^2) of them.
+    std::size_t numLookups = 6 * n + numProcessed;
+    EXPECT_LE(NumNodeComparisons, 2 * numLookups);
+  }
+}